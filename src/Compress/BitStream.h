@@ -0,0 +1,208 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <inttypes.h>
+#include <vector>
+
+// bit level access to byte buffers, using the same bit order as BitFiFo: the first bit is the lsb of
+// the first byte.
+//   BitReader : reads from a buffer through a 64 bit reservoir which is refilled a word at a time
+//   BitWriter : appends to a byte vector through a 64 bit accumulator which is stored a word at a time
+
+class BitReader
+{
+public:
+    // start reading 'position' bits into data
+    BitReader(const unsigned char* data, const size_t size, const size_t position = 0)
+        : m_data(data)
+        , m_size(size)
+        , m_next(position / 8)
+        , m_bits(0)
+        , m_count(0)
+    {
+        assert(position <= 8 * size);
+        Refill();
+        Skip(position % 8);
+    }
+
+    // bits read so far, counted from the start of the buffer
+    size_t Position() const
+    {
+        return 8 * m_next - m_count;
+    }
+    // bits left in the buffer
+    size_t Available() const
+    {
+        return 8 * (m_size - m_next) + m_count;
+    }
+
+    // make sure at least 56 bits are in the reservoir, or everything which is left
+    void Refill()
+    {
+        if (m_next + 8 <= m_size)
+        {
+            // load a whole word, the bits which were already there are loaded again
+            m_bits |= Load(m_data + m_next) << m_count;
+            m_next += (63 - m_count) / 8;
+            m_count |= 56;
+        }
+        else
+        {
+            while (m_count <= 56 && m_next < m_size)
+            {
+                m_bits |= static_cast<uint64_t>(m_data[m_next]) << m_count;
+                ++m_next;
+                m_count += 8;
+            }
+        }
+    }
+
+    // the next 'bits' bits, without reading them. call Refill first.
+    uint64_t Peek(const unsigned int bits) const
+    {
+        assert(bits <= 56);
+        return m_bits & ((1ull << bits) - 1);
+    }
+    void Skip(const unsigned int bits)
+    {
+        assert(bits <= m_count);
+        m_bits >>= bits;
+        m_count -= bits;
+    }
+    uint64_t Pop(const unsigned int bits)
+    {
+        if (m_count < bits)
+        {
+            Refill();
+        }
+        assert(bits <= m_count);
+        const uint64_t res = Peek(bits);
+        Skip(bits);
+        return res;
+    }
+
+private:
+    static uint64_t Load(const unsigned char* data)
+    {
+        uint64_t value;
+        memcpy(&value, data, sizeof(value));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        value = __builtin_bswap64(value);
+#endif
+        return value;
+    }
+
+    const unsigned char* m_data;
+    size_t m_size;
+    // next byte to load into the reservoir
+    size_t m_next;
+    // reservoir, the lowest m_count bits are valid
+    uint64_t m_bits;
+    unsigned int m_count;
+};
+
+class BitWriter
+{
+public:
+    BitWriter()
+        : m_output(nullptr)
+        , m_data(nullptr)
+        , m_size(0)
+        , m_next(0)
+        , m_bits(0)
+        , m_count(0)
+    {}
+
+    // start appending to output. bits which were left over by End are written first.
+    void Begin(std::vector<unsigned char>& output)
+    {
+        assert(m_output == nullptr);
+        m_output = &output;
+        m_next = output.size();
+        Attach();
+    }
+    // stop appending, the output is trimmed to the bytes written. the last bits which don't fill a
+    // byte are kept for the next Begin, unless they are padded with zeros.
+    void End(const bool pad = false)
+    {
+        assert(m_output != nullptr);
+        Flush();
+        if (pad && m_count > 0)
+        {
+            m_data[m_next] = static_cast<unsigned char>(m_bits);
+            ++m_next;
+            m_bits = 0;
+            m_count = 0;
+        }
+        m_output->resize(m_next);
+        m_output = nullptr;
+    }
+
+    // make room for at least 'bits' more bits
+    void Reserve(const size_t bits)
+    {
+        assert(m_output != nullptr);
+        if (m_next + bits / 8 + 16 > m_size)
+        {
+            // the vector grows its capacity geometrically, only the part in use is resized
+            m_output->resize(std::max(m_next + bits / 8 + 16, m_size + 4096));
+            Attach();
+        }
+    }
+
+    // add bits to the accumulator without storing them, at most 56 bits can be added between Flushes
+    void Add(const uint64_t value, const unsigned int bits)
+    {
+        assert(m_count + bits <= 64);
+        assert(bits == 64 || (value >> bits) == 0);
+        m_bits |= value << m_count;
+        m_count += bits;
+    }
+    // store the whole bytes in the accumulator
+    void Flush()
+    {
+        assert(m_output != nullptr);
+        if (m_next + 8 > m_size)
+        {
+            Reserve(64);
+        }
+        Store(m_data + m_next, m_bits);
+        m_next += m_count / 8;
+        m_bits = (m_count & ~7u) == 64 ? 0 : m_bits >> (m_count & ~7u);
+        m_count &= 7;
+    }
+    void Write(const uint64_t value, const unsigned int bits)
+    {
+        assert(bits <= 56);
+        Add(value, bits);
+        Flush();
+    }
+
+private:
+    void Attach()
+    {
+        m_size = m_output->size();
+        m_data = m_output->data();
+        Reserve(64);
+    }
+
+    static void Store(unsigned char* data, uint64_t value)
+    {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        value = __builtin_bswap64(value);
+#endif
+        memcpy(data, &value, sizeof(value));
+    }
+
+    std::vector<unsigned char>* m_output;
+    unsigned char* m_data;
+    // usable size of m_data, the output is trimmed by End
+    size_t m_size;
+    // next byte to store the accumulator at
+    size_t m_next;
+    // accumulator, the lowest m_count bits are valid
+    uint64_t m_bits;
+    unsigned int m_count;
+};
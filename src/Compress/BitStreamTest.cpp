@@ -0,0 +1,123 @@
+#include <random>
+#include <vector>
+
+#include "CommonTestFunctionality.h"
+
+#include "BitFiFo.h"
+#include "BitStream.h"
+
+class BitStreamTest : public Test
+{
+protected:
+    virtual void SetUp()
+    {
+    }
+
+    virtual void TearDown()
+    {
+    }
+
+    // random values with random sizes, returns the sizes
+    std::vector<std::pair<unsigned int, unsigned int>> GetValues(const size_t count) const
+    {
+        std::mt19937 rng;
+        rng.seed(0);
+        std::uniform_int_distribution<unsigned int> bits(1, 32);
+        std::vector<std::pair<unsigned int, unsigned int>> res;
+        for (size_t i = 0; i < count; ++i)
+        {
+            const unsigned int size = bits(rng);
+            res.emplace_back(static_cast<unsigned int>(rng() & (0xFFFFFFFFu >> (32 - size))), size);
+        }
+        return res;
+    }
+};
+
+TEST_F(BitStreamTest, ReaderMatchesBitFiFo)
+{
+    const auto values = GetValues(10000);
+    BitFiFo bits;
+    for (const auto& value : values)
+    {
+        bits.Push(value.first, value.second);
+    }
+    std::vector<unsigned char> buffer;
+    bits.Pop(buffer, true);
+
+    BitReader reader(buffer.data(), buffer.size());
+    size_t position = 0;
+    for (const auto& value : values)
+    {
+        EXPECT_EQ(position, reader.Position());
+        ASSERT_EQ(value.first, reader.Pop(value.second));
+        position += value.second;
+    }
+    EXPECT_LT(reader.Available(), 8u);
+}
+
+TEST_F(BitStreamTest, ReaderStartPosition)
+{
+    std::vector<unsigned char> buffer = { 0x12, 0x34, 0x56, 0x78, 0x9A, 0xBC, 0xDE, 0xF0, 0x11 };
+    for (size_t position = 0; position <= 8 * buffer.size(); ++position)
+    {
+        BitReader reader(buffer.data(), buffer.size(), position);
+        EXPECT_EQ(position, reader.Position());
+        EXPECT_EQ(8 * buffer.size() - position, reader.Available());
+        if (position + 8 <= 8 * buffer.size())
+        {
+            const unsigned int expected = (buffer[position / 8] | (position / 8 + 1 < buffer.size() ? buffer[position / 8 + 1] << 8 : 0)) >> (position % 8);
+            EXPECT_EQ(expected & 0xFF, reader.Pop(8));
+        }
+    }
+}
+
+TEST_F(BitStreamTest, WriterMatchesBitFiFo)
+{
+    const auto values = GetValues(10000);
+    BitFiFo bits;
+    for (const auto& value : values)
+    {
+        bits.Push(value.first, value.second);
+    }
+    std::vector<unsigned char> expected;
+    bits.Pop(expected, true);
+
+    std::vector<unsigned char> buffer;
+    BitWriter writer;
+    writer.Begin(buffer);
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+        if (i % 3 == 0 && i + 1 < values.size() && values[i].second + values[i + 1].second <= 56)
+        {
+            writer.Add(values[i].first, values[i].second);
+            writer.Add(values[i + 1].first, values[i + 1].second);
+            writer.Flush();
+            ++i;
+        }
+        else
+        {
+            writer.Write(values[i].first, values[i].second);
+        }
+    }
+    writer.End(true);
+    EXPECT_EQ(expected, buffer);
+}
+
+TEST_F(BitStreamTest, WriterKeepsPartialBytes)
+{
+    std::vector<unsigned char> buffer = { 0x55 };
+    BitWriter writer;
+    writer.Begin(buffer);
+    writer.Write(0x3, 3);
+    writer.End();
+    EXPECT_EQ(std::vector<unsigned char>({ 0x55 }), buffer);
+    std::vector<unsigned char> next;
+    writer.Begin(next);
+    writer.Write(0x1F, 6);
+    writer.End();
+    EXPECT_EQ(std::vector<unsigned char>({ 0xFB }), next);
+    writer.Begin(next);
+    writer.Write(0x1, 2);
+    writer.End(true);
+    EXPECT_EQ(std::vector<unsigned char>({ 0xFB, 0x02 }), next);
+}
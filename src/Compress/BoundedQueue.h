@@ -0,0 +1,88 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+// queue between a producer and a consumer thread, which holds at most 'capacity' values. a full
+// queue blocks the producer, so a fast producer can't run ahead of a slow consumer.
+// either side can close the queue: the producer at the end of the data, the consumer when it stops.
+
+template<typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(const size_t capacity)
+        : m_capacity(capacity)
+        , m_values()
+        , m_closed(false)
+        , m_mutex()
+        , m_notEmpty()
+        , m_notFull()
+    {}
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator = (const BoundedQueue&) = delete;
+
+    // blocks while the queue is full, returns false when the queue is closed
+    bool Push(T&& value)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_notFull.wait(lock, [this]() { return m_closed || m_values.size() < m_capacity; });
+        if (m_closed)
+        {
+            return false;
+        }
+        m_values.emplace_back(std::move(value));
+        lock.unlock();
+        m_notEmpty.notify_one();
+        return true;
+    }
+
+    // blocks while the queue is empty, returns false when the queue is closed and empty
+    bool Pop(T& value)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_notEmpty.wait(lock, [this]() { return m_closed || !m_values.empty(); });
+        return PopFront(lock, value);
+    }
+
+    // returns false when the queue is empty
+    bool TryPop(T& value)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        return PopFront(lock, value);
+    }
+
+    // values in the queue can still be popped
+    void Close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_closed = true;
+        }
+        m_notEmpty.notify_all();
+        m_notFull.notify_all();
+    }
+
+private:
+    bool PopFront(std::unique_lock<std::mutex>& lock, T& value)
+    {
+        if (m_values.empty())
+        {
+            return false;
+        }
+        value = std::move(m_values.front());
+        m_values.pop_front();
+        lock.unlock();
+        m_notFull.notify_one();
+        return true;
+    }
+
+    const size_t m_capacity;
+    std::deque<T> m_values;
+    bool m_closed;
+    std::mutex m_mutex;
+    std::condition_variable m_notEmpty;
+    std::condition_variable m_notFull;
+};
@@ -1,21 +1,24 @@
-﻿#include <memory>
+﻿#include <algorithm>
+#include <functional>
+#include <memory>
 #include <random>
 #include <vector>
 #include <map>
 #include <cassert>
 #include <sstream>
+#include <stdexcept>
+#include <string>
 #include <iostream>
 
 #include "CommonTestFunctionality.h"
 
-enum class InputType
-{
-    Random,       // random values [0..256)
-    RandomRange,  // random values [0..10)
-    Sequence,     // repeat sequence (1,2,3,4,5,6)
-    Sawtooth,     // sawtooth 1-50 times values (1,2,3,4,5,6)
-    Single,       // one value (42)
-};
+#include "Corpus.h"
+#include "DynamicHuffman.h"
+#include "HuffmanCode.h"
+#include "PipeLine.h"
+#include "RLE.h"
+#include "Window.h"
+#include "XXHash.h"
 
 class CompressTest : public testing::TestWithParam<CompressionAlgo>
 {
@@ -36,124 +39,29 @@ protected:
     {
     }
 
-    std::vector<unsigned char> GetInputData(InputType type)
+    std::vector<unsigned char> GetInputData(CorpusType type)
     {
-        static const std::vector<unsigned char> alternating_values = {1,2,3,4,5,6};
-        static std::map<InputType, std::vector<unsigned char >> inputs;
+        static std::map<CorpusType, std::vector<unsigned char >> inputs;
         auto iter = inputs.find(type);
         if (iter == inputs.end())
         {
-            std::vector<unsigned char> res;
-            switch (type)
-            {
-            case InputType::Random:
-                {
-                    std::mt19937 rng;
-                    rng.seed(0); // make test repeatable
-                    std::uniform_int_distribution<unsigned int> dist(0, 256);
-                    for (size_t i = 0; i < m_size; ++i)
-                    {
-                        res.emplace_back(static_cast<unsigned char>(dist(rng)));
-                    }
-                }
-                break;
-            case InputType::RandomRange:
-                {
-                    std::mt19937 rng;
-                    rng.seed(0); // make test repeatable
-                    std::uniform_int_distribution<unsigned int> dist(0, 10);
-                    for (size_t i = 0; i < m_size; ++i)
-                    {
-                        res.emplace_back(static_cast<unsigned char>(dist(rng)));
-                    }
-                }
-                break;
-            case InputType::Sawtooth:
-                {
-                    auto alternating_values_iter = alternating_values.begin();
-                    size_t max = 0;
-                    size_t cur = 0;
-                    while (res.size()<m_size)
-                    {
-                        if (cur >= max)
-                        {
-                            max++;
-                            if (max >= 50)
-                            {
-                                max = 1;
-                            }
-                            cur = 0;
-                            ++alternating_values_iter;
-                            if (alternating_values_iter == alternating_values.end())
-                            {
-                                alternating_values_iter = alternating_values.begin();
-                            }
-                        }
-                        cur++;
-                        res.emplace_back(*alternating_values_iter);
-                    }
-                    break;
-                }
-                case InputType::Sequence:
-                {
-                    auto alternating_values_iter = alternating_values.end();
-                    while (res.size()<m_size)
-                    {
-                        if (alternating_values_iter == alternating_values.end())
-                        {
-                            alternating_values_iter = alternating_values.begin();
-                        }
-                        res.emplace_back(*alternating_values_iter);
-                        ++alternating_values_iter;
-                    }
-                    break;
-                }
-                case InputType::Single:
-                {
-                    while (res.size()<m_size)
-                    {
-                        res.emplace_back((unsigned char)42);
-                    }
-                    break;
-                }
-                default:
-                assert(false);
-                break;
-            }
-            iter = inputs.emplace(type,res).first;
+            iter = inputs.emplace(type, Corpus::Generate(type, m_size)).first;
         }
         return iter->second;
     }
 
-    std::vector<InputType> GetInputTypes() const
+    const std::vector<CorpusType>& GetInputTypes() const
     {
-        return
-        {
-            InputType::Random,
-            InputType::RandomRange,
-            InputType::Sequence,
-            InputType::Sawtooth,
-            InputType::Single,
-        };
+        return Corpus::All();
     }
 };
 
-inline std::string to_string(InputType const& it)
+inline std::string to_string(CorpusType const& it)
 {
-    switch (it)
-    {
-    case InputType::Random:      return "Random";
-    case InputType::RandomRange: return "RandomRange";
-    case InputType::Sequence:    return "Sequence";
-    case InputType::Sawtooth:    return "Sawtooth";
-    case InputType::Single:      return "Single";
-    default:
-        assert(false);
-        return "Unknown(" + std::to_string(static_cast<int>(it)) + ")";
-    }
+    return Corpus::Name(it);
 }
 
-inline std::ostream& operator<<(std::ostream& stream, InputType const& it)
+inline std::ostream& operator<<(std::ostream& stream, CorpusType const& it)
 {
     return stream << to_string(it);
 }
@@ -175,7 +83,7 @@ TEST_P(CompressTest, Ratio)
         long long m_msDeCompres;
     };
     StopWatch sw;
-    std::map<InputType, Data> info;
+    std::map<CorpusType, Data> info;
     for (auto inputType : GetInputTypes())
     {
         std::vector<unsigned char> input = GetInputData(inputType);
@@ -208,7 +116,7 @@ TEST_P(CompressTest, Ratio)
     {
         size_t l = to_string(it.first).size();
         auto r = std::to_string(static_cast<int>(it.second.m_ratio * 100));
-        s << std::string(l-r.size()-2, ' ') << r << " %  ";
+        s << std::string(l > r.size() + 2 ? l - r.size() - 2 : 0, ' ') << r << " %  ";
         t0 += it.second.m_msCompres;
         t1 += it.second.m_msDeCompres;
     }
@@ -217,6 +125,37 @@ TEST_P(CompressTest, Ratio)
     //std::cout << s.str() << std::endl;
 }
 
+TEST_P(CompressTest, Levels)
+{
+    CompressionAlgo ca = GetParam();
+    std::map<std::pair<CorpusType, CompressionLevel>, size_t> sizes;
+    for (auto level : { CompressionLevel::Fast, CompressionLevel::Normal, CompressionLevel::Max })
+    {
+        for (auto inputType : GetInputTypes())
+        {
+            std::vector<unsigned char> input = GetInputData(inputType);
+            input.resize(std::min<size_t>(input.size(), 1000000));
+            auto compressor = CompressorFactory::Create(ca, level);
+            auto deCompressor = DeCompressorFactory::Create(ca);
+            auto compressed = input;
+            compressor->Finish(compressed);
+            sizes[std::make_pair(inputType, level)] = compressed.size();
+            auto deCompressed = compressed;
+            deCompressor->Finish(deCompressed);
+            ASSERT_EQ(input, deCompressed) << "InputType: " << inputType << ", Level: " << static_cast<int>(level);
+        }
+    }
+    // the window searches harder at Max, which pays off on repetitive inputs
+    const auto windows = { CompressionAlgo::Window, CompressionAlgo::Window_DynamicHuffman, CompressionAlgo::Window_RLE_DynamicHuffman, CompressionAlgo::Window_Range };
+    if (std::find(windows.begin(), windows.end(), ca) != windows.end())
+    {
+        for (auto inputType : { CorpusType::Text, CorpusType::Logs, CorpusType::Sawtooth })
+        {
+            EXPECT_LE(sizes[std::make_pair(inputType, CompressionLevel::Max)], sizes[std::make_pair(inputType, CompressionLevel::Fast)]) << "InputType: " << inputType;
+        }
+    }
+}
+
 TEST_P(CompressTest, DISABLED_RatioOri)
 {
     for (auto inputType : GetInputTypes())
@@ -234,6 +173,414 @@ TEST_P(CompressTest, DISABLED_RatioOri)
     }
 }
 
+TEST_P(CompressTest, BlockBoundaries)
+{
+    CompressionAlgo ca = GetParam();
+    // sizes around the block size of the block based algorithms
+    std::mt19937 rng;
+    rng.seed(0);
+    for (size_t size : { 0, 1, 16383, 16384, 16385, 32768 })
+    {
+        std::vector<unsigned char> input;
+        while (input.size() < size)
+        {
+            input.emplace_back(static_cast<unsigned char>(rng() % 20));
+        }
+        auto compressor = CompressorFactory::Create(ca);
+        auto deCompressor = DeCompressorFactory::Create(ca);
+        auto compressed = input;
+        compressor->Finish(compressed);
+        auto deCompressed = compressed;
+        deCompressor->Finish(deCompressed);
+        ASSERT_EQ(input, deCompressed) << "Size: " << input.size();
+    }
+}
+
+TEST_P(CompressTest, Chunks)
+{
+    CompressionAlgo ca = GetParam();
+    // the data is passed in pieces of random size, down to a single byte
+    std::mt19937 rng;
+    rng.seed(0);
+    std::vector<unsigned char> input;
+    while (input.size() < 100000)
+    {
+        const unsigned char value = static_cast<unsigned char>(rng() % 20);
+        input.insert(input.end(), 1 + rng() % 10, value);
+    }
+    auto Process = [&rng](const std::vector<unsigned char>& data, std::function<void(std::vector<unsigned char>&)> process, std::function<void(std::vector<unsigned char>&)> finish)
+    {
+        std::vector<unsigned char> res;
+        std::vector<unsigned char> chunk;
+        for (size_t offset = 0; offset < data.size(); )
+        {
+            const size_t size = std::min<size_t>(data.size() - offset, rng() % 3 == 0 ? 1 : rng() % 40000);
+            chunk.assign(data.begin() + offset, data.begin() + offset + size);
+            process(chunk);
+            res.insert(res.end(), chunk.begin(), chunk.end());
+            offset += size;
+        }
+        chunk.clear();
+        finish(chunk);
+        res.insert(res.end(), chunk.begin(), chunk.end());
+        return res;
+    };
+    auto compressor = CompressorFactory::Create(ca);
+    auto deCompressor = DeCompressorFactory::Create(ca);
+    auto compressed = Process(input,
+        [&compressor](std::vector<unsigned char>& buffer) { compressor->Compress(buffer); },
+        [&compressor](std::vector<unsigned char>& buffer) { compressor->Finish(buffer); });
+    auto deCompressed = Process(compressed,
+        [&deCompressor](std::vector<unsigned char>& buffer) { deCompressor->DeCompress(buffer); },
+        [&deCompressor](std::vector<unsigned char>& buffer) { deCompressor->Finish(buffer); });
+    ASSERT_EQ(input, deCompressed);
+}
+
+TEST_P(CompressTest, Spans)
+{
+    CompressionAlgo ca = GetParam();
+    // the input is used in place, the output goes to small buffers
+    std::mt19937 rng;
+    rng.seed(0);
+    std::vector<unsigned char> input;
+    while (input.size() < 100000)
+    {
+        const unsigned char value = static_cast<unsigned char>(rng() % 20);
+        input.insert(input.end(), 1 + rng() % 10, value);
+    }
+    typedef std::function<CodecStatus(const unsigned char*, size_t, unsigned char*, size_t, size_t&)> Process;
+    typedef std::function<CodecStatus(unsigned char*, size_t, size_t&)> Finish;
+    auto Run = [&rng](const std::vector<unsigned char>& data, Process process, Finish finish)
+    {
+        std::vector<unsigned char> res;
+        std::vector<unsigned char> output;
+        auto Space = [&rng, &output]()
+        {
+            output.resize(rng() % 3 == 0 ? 1 : 1 + rng() % 5000);
+            return output.size();
+        };
+        size_t written;
+        for (size_t offset = 0; offset < data.size(); )
+        {
+            const size_t size = std::min<size_t>(data.size() - offset, 1 + rng() % 20000);
+            auto status = process(data.data() + offset, size, output.data(), Space(), written);
+            res.insert(res.end(), output.begin(), output.begin() + written);
+            while (status == CodecStatus::NeedsSpace)
+            {
+                status = process(nullptr, 0, output.data(), Space(), written);
+                res.insert(res.end(), output.begin(), output.begin() + written);
+            }
+            offset += size;
+        }
+        CodecStatus status;
+        do
+        {
+            status = finish(output.data(), Space(), written);
+            res.insert(res.end(), output.begin(), output.begin() + written);
+        } while (status == CodecStatus::NeedsSpace);
+        return res;
+    };
+    auto compressor = CompressorFactory::Create(ca);
+    auto deCompressor = DeCompressorFactory::Create(ca);
+    auto compressed = Run(input,
+        [&compressor](const unsigned char* in, size_t inSize, unsigned char* out, size_t outSize, size_t& written) { return compressor->Compress(in, inSize, out, outSize, written); },
+        [&compressor](unsigned char* out, size_t outSize, size_t& written) { return compressor->Finish(out, outSize, written); });
+    auto deCompressed = Run(compressed,
+        [&deCompressor](const unsigned char* in, size_t inSize, unsigned char* out, size_t outSize, size_t& written) { return deCompressor->DeCompress(in, inSize, out, outSize, written); },
+        [&deCompressor](unsigned char* out, size_t outSize, size_t& written) { return deCompressor->Finish(out, outSize, written); });
+    ASSERT_EQ(input, deCompressed);
+}
+
+TEST(StaticHuffmanTest, OriginalFormat)
+{
+    // written before the version marker and canonical codes were added
+    const std::string expected = "static huffman, original format";
+    std::vector<unsigned char> data =
+    {
+        0x60, 0x9D, 0x00, 0x83, 0x90, 0xC5, 0x30, 0x1C, 0xD3, 0x8C, 0x67, 0xA2,
+        0xC1, 0x34, 0xD9, 0xD8, 0xA6, 0x1B, 0xBE, 0x29, 0xC7, 0x39, 0xE9, 0xDC,
+        0xF3, 0x87, 0xA0, 0x03, 0xD5, 0xE2, 0x26, 0x9C, 0x0D, 0x8B, 0xE6, 0x44,
+        0x9D, 0x2D, 0x7E, 0x08,
+    };
+    auto deCompressor = DeCompressorFactory::Create(CompressionAlgo::StaticHuffman);
+    deCompressor->Finish(data);
+    EXPECT_EQ(expected, std::string(data.begin(), data.end()));
+}
+
+TEST(StaticHuffmanTest, Version1Format)
+{
+    // written before blocks were split in segments
+    const std::string expected = "static huffman, version 1 with blocks of 16384 keys";
+    std::vector<unsigned char> data =
+    {
+        0xF3, 0x1F, 0x37, 0x5E, 0xE1, 0xCC, 0x0F, 0x5C, 0x39, 0x70, 0x86, 0x03,
+        0x67, 0x0E, 0x9C, 0xF9, 0x93, 0x2B, 0xED, 0xC0, 0x95, 0x1D, 0xB8, 0xB2,
+        0x03, 0x57, 0xCC, 0x3E, 0xE0, 0xCA, 0x48, 0x1C, 0xB8, 0xF2, 0x85, 0x57,
+        0xD4, 0xBC, 0x71, 0x40, 0x1A, 0x44, 0xD5, 0xB7, 0x0B, 0x33, 0x76, 0x65,
+        0x69, 0x70, 0x58, 0x6C, 0x09, 0x7F, 0x91, 0x90, 0x15, 0x42, 0x70, 0xEF,
+        0xFD, 0x3D, 0xC8, 0x71, 0xEB, 0x01,
+    };
+    auto deCompressor = DeCompressorFactory::Create(CompressionAlgo::StaticHuffman);
+    deCompressor->Finish(data);
+    EXPECT_EQ(expected, std::string(data.begin(), data.end()));
+}
+
+TEST(StaticHuffmanTest, ChangingData)
+{
+    // the alphabet changes every 2 segments, blocks of 4 segments mix two alphabets. only Max tries
+    // smaller blocks.
+    std::mt19937 rng;
+    rng.seed(0);
+    std::vector<unsigned char> input;
+    while (input.size() < 200000)
+    {
+        const unsigned char first = (input.size() / 8192) % 2 == 0 ? 'a' : 'A';
+        input.emplace_back(static_cast<unsigned char>(first + rng() % 16));
+    }
+    std::map<CompressionLevel, std::vector<unsigned char>> compressed;
+    for (auto level : { CompressionLevel::Fast, CompressionLevel::Normal, CompressionLevel::Max })
+    {
+        auto data = input;
+        CompressorFactory::Create(CompressionAlgo::StaticHuffman, level)->Finish(data);
+        compressed[level] = data;
+        DeCompressorFactory::Create(CompressionAlgo::StaticHuffman)->Finish(data);
+        EXPECT_EQ(input, data);
+    }
+    EXPECT_LT(compressed[CompressionLevel::Max].size() * 9, compressed[CompressionLevel::Fast].size() * 8);
+    EXPECT_LE(compressed[CompressionLevel::Max].size(), compressed[CompressionLevel::Normal].size());
+    EXPECT_LE(compressed[CompressionLevel::Normal].size(), compressed[CompressionLevel::Fast].size());
+}
+
+TEST(DynamicHuffmanTest, OriginalFormat)
+{
+    // written before the tree was kept in flat arrays, the codes follow from the same updates
+    const std::string input = "abracadabra, dynamic huffman keeps its format: aaaaabbbbcccdde";
+    const std::vector<unsigned char> expected =
+    {
+        0xC2, 0x8A, 0x95, 0xC3, 0x31, 0x26, 0x03, 0x02, 0x61, 0x01, 0x64, 0xC8,
+        0xC3, 0x0D, 0xDB, 0x48, 0x13, 0x0D, 0x1A, 0x75, 0x98, 0x19, 0xAF, 0x50,
+        0xAC, 0x51, 0x96, 0x81, 0x63, 0xAE, 0x3A, 0x74, 0x3B, 0x1C, 0x6F, 0x39,
+        0xD5, 0x40, 0x47, 0x6B, 0x1B, 0x99, 0x6F, 0xB4, 0x74, 0x33, 0xAF, 0x15,
+    };
+    std::vector<unsigned char> data(input.begin(), input.end());
+    CompressorFactory::Create(CompressionAlgo::DynamicHuffman)->Finish(data);
+    EXPECT_EQ(expected, data);
+    DeCompressorFactory::Create(CompressionAlgo::DynamicHuffman)->Finish(data);
+    EXPECT_EQ(input, std::string(data.begin(), data.end()));
+
+    // past HuffmanCode::MaxTotalCount(32) symbols, where the counts once were halved. the size and
+    // hash are from the original coder.
+    std::mt19937 rng;
+    rng.seed(0);
+    std::vector<unsigned char> large(10000000);
+    for (auto& value : large)
+    {
+        value = static_cast<unsigned char>('0' + rng() % 40);
+    }
+    ASSERT_GT(large.size(), HuffmanCode::MaxTotalCount(32));
+    data = large;
+    CompressorFactory::Create(CompressionAlgo::DynamicHuffman)->Finish(data);
+    EXPECT_EQ(6781215u, data.size());
+    EXPECT_EQ(0x58EEF1E9u, XXHash32(data.data(), data.size()));
+    DeCompressorFactory::Create(CompressionAlgo::DynamicHuffman)->Finish(data);
+    EXPECT_EQ(large, data);
+}
+
+TEST(DynamicHuffmanTest, LongCodes)
+{
+    // fibonacci counts give the deepest tree, key 0 gets a code of 34 bits. the count of keyNew takes
+    // the place of 34. the output is pinned to the original coder, which never scaled its counts.
+    std::vector<unsigned char> input;
+    uint64_t a = 1;
+    uint64_t b = 2;
+    for (unsigned int key = 0; key < 33; )
+    {
+        if (a != 34)
+        {
+            input.insert(input.end(), static_cast<size_t>(a), static_cast<unsigned char>(key));
+            ++key;
+        }
+        const uint64_t c = a + b;
+        a = b;
+        b = c;
+    }
+    for (unsigned int key = 0; key < 33; ++key)
+    {
+        input.emplace_back(static_cast<unsigned char>(key));
+    }
+    ASSERT_GT(input.size(), HuffmanCode::MaxTotalCount(32));
+    std::vector<unsigned char> data = input;
+    CompressorFactory::Create(CompressionAlgo::DynamicHuffman)->Finish(data);
+    EXPECT_EQ(7905802u, data.size());
+    EXPECT_EQ(0x8A722D0Fu, XXHash32(data.data(), data.size()));
+    DeCompressorFactory::Create(CompressionAlgo::DynamicHuffman)->Finish(data);
+    EXPECT_EQ(input, data);
+}
+
+TEST(RLETest, OriginalFormat)
+{
+    // written before runs were found a word at a time, in one piece and a byte at a time
+    const std::string input = "abccc\xff" "dd\xff\xff" + std::string(300, 'e') + std::string(3, '\xff') + std::string(255, 'f') + std::string(256, '\xff') + "g";
+    const std::vector<unsigned char> expected =
+    {
+        0x61, 0x62, 0xFF, 0x03, 0x63, 0xFF, 0xFF, 0x64, 0x64, 0xFF, 0x02, 0xFF,
+        0xFF, 0xFE, 0x65, 0xFF, 0x2E, 0x65, 0xFF, 0x03, 0xFF, 0xFF, 0xFE, 0x66,
+        0x66, 0xFF, 0xFE, 0xFF, 0xFF, 0x02, 0xFF, 0x67,
+    };
+    std::vector<unsigned char> data(input.begin(), input.end());
+    RLECompressor().Finish(data);
+    EXPECT_EQ(expected, data);
+    RLECompressor compressor;
+    std::vector<unsigned char> compressed;
+    for (auto c : input)
+    {
+        data.assign(1, static_cast<unsigned char>(c));
+        compressor.Compress(data);
+        compressed.insert(compressed.end(), data.begin(), data.end());
+    }
+    data.clear();
+    compressor.Finish(data);
+    compressed.insert(compressed.end(), data.begin(), data.end());
+    EXPECT_EQ(expected, compressed);
+    RLEDeCompressor().Finish(compressed);
+    EXPECT_EQ(input, std::string(compressed.begin(), compressed.end()));
+}
+
+TEST(RangeTest, SkewedData)
+{
+    // one byte in 20 differs, huffman needs at least a bit for each byte
+    std::mt19937 rng;
+    rng.seed(0);
+    std::vector<unsigned char> input;
+    while (input.size() < 200000)
+    {
+        input.emplace_back(rng() % 20 == 0 ? static_cast<unsigned char>(rng() % 4) : 7);
+    }
+    auto range = input;
+    CompressorFactory::Create(CompressionAlgo::Range)->Finish(range);
+    auto huffman = input;
+    CompressorFactory::Create(CompressionAlgo::StaticHuffman)->Finish(huffman);
+    EXPECT_LT(range.size() * 2, huffman.size());
+    auto deCompressed = range;
+    DeCompressorFactory::Create(CompressionAlgo::Range)->Finish(deCompressed);
+    EXPECT_EQ(input, deCompressed);
+
+    for (size_t position : { size_t(8), range.size() / 2 })
+    {
+        auto invalid = range;
+        invalid[position] ^= 0x55;
+        auto deCompressor = DeCompressorFactory::Create(CompressionAlgo::Range);
+        EXPECT_ANY_THROW(deCompressor->Finish(invalid)) << "Position: " << position;
+    }
+    auto incomplete = range;
+    incomplete.pop_back();
+    EXPECT_THROW(DeCompressorFactory::Create(CompressionAlgo::Range)->Finish(incomplete), std::runtime_error);
+}
+
+TEST(TANSTest, SkewedData)
+{
+    // one byte in 20 differs, huffman needs at least a bit for each byte
+    std::mt19937 rng;
+    rng.seed(0);
+    std::vector<unsigned char> input;
+    while (input.size() < 200000)
+    {
+        input.emplace_back(rng() % 20 == 0 ? static_cast<unsigned char>(rng() % 4) : 7);
+    }
+    auto tans = input;
+    CompressorFactory::Create(CompressionAlgo::TANS)->Finish(tans);
+    auto huffman = input;
+    CompressorFactory::Create(CompressionAlgo::StaticHuffman)->Finish(huffman);
+    EXPECT_LT(tans.size() * 2, huffman.size());
+    auto deCompressed = tans;
+    DeCompressorFactory::Create(CompressionAlgo::TANS)->Finish(deCompressed);
+    EXPECT_EQ(input, deCompressed);
+
+    // the frequencies don't add up
+    auto invalid = tans;
+    invalid[2] ^= 0x55;
+    EXPECT_THROW(DeCompressorFactory::Create(CompressionAlgo::TANS)->Finish(invalid), std::runtime_error);
+    auto incomplete = tans;
+    incomplete.pop_back();
+    EXPECT_THROW(DeCompressorFactory::Create(CompressionAlgo::TANS)->Finish(incomplete), std::runtime_error);
+}
+
+TEST(SemiAdaptiveHuffmanTest, ChangingData)
+{
+    // 8 bytes in the first half and 8 others in the second, the codes have to follow
+    std::mt19937 rng;
+    rng.seed(0);
+    std::vector<unsigned char> input;
+    while (input.size() < 200000)
+    {
+        input.emplace_back(static_cast<unsigned char>((input.size() < 100000 ? 'a' : 'A') + rng() % 8));
+    }
+    auto semi = input;
+    CompressorFactory::Create(CompressionAlgo::SemiAdaptiveHuffman)->Finish(semi);
+    auto dynamic = input;
+    CompressorFactory::Create(CompressionAlgo::DynamicHuffman)->Finish(dynamic);
+    EXPECT_LT(semi.size(), dynamic.size());
+    // 3 bits per byte, and some for adapting
+    EXPECT_LT(semi.size(), input.size() * 3 / 8 * 12 / 10);
+    auto deCompressed = semi;
+    DeCompressorFactory::Create(CompressionAlgo::SemiAdaptiveHuffman)->Finish(deCompressed);
+    EXPECT_EQ(input, deCompressed);
+
+    auto incomplete = semi;
+    incomplete.pop_back();
+    EXPECT_THROW(DeCompressorFactory::Create(CompressionAlgo::SemiAdaptiveHuffman)->Finish(incomplete), std::runtime_error);
+    auto extra = semi;
+    extra.emplace_back(0);
+    EXPECT_THROW(DeCompressorFactory::Create(CompressionAlgo::SemiAdaptiveHuffman)->Finish(extra), std::runtime_error);
+}
+
+TEST(CompressionAlgoNamesTest, Names)
+{
+    for (auto ca : CompressionAlgoNames::All())
+    {
+        EXPECT_EQ(ca, CompressionAlgoNames::Parse(CompressionAlgoNames::Name(ca)));
+    }
+    EXPECT_EQ("Window_RLE_DynamicHuffman", CompressionAlgoNames::Name(CompressionAlgo::Window_RLE_DynamicHuffman));
+    EXPECT_THROW(CompressionAlgoNames::Parse("Unknown"), std::runtime_error);
+}
+
+TEST(PipeLineTest, FusedMatchesStages)
+{
+    // more than one chunk, with runs for RLE and repeats for Window
+    std::mt19937 rng;
+    rng.seed(0);
+    std::vector<unsigned char> input;
+    while (input.size() < 300000)
+    {
+        if (input.size() > 100 && rng() % 2 == 0)
+        {
+            const size_t offset = input.size() - 1 - rng() % 100;
+            const size_t length = std::min<size_t>(input.size() - offset, 1 + rng() % 50);
+            const std::vector<unsigned char> repeat(input.begin() + offset, input.begin() + offset + length);
+            input.insert(input.end(), repeat.begin(), repeat.end());
+        }
+        else
+        {
+            input.insert(input.end(), 1 + rng() % 10, static_cast<unsigned char>(rng() % 20));
+        }
+    }
+
+    PipeLineCompressor<WindowCompressor, RLECompressor, DynamicHuffmanCompressor> pipeLine;
+    auto fused = input;
+    pipeLine.Finish(fused);
+
+    // the stages one after the other, on whole buffers
+    auto staged = input;
+    DynamicHuffmanCompressor().Finish(staged);
+    RLECompressor().Finish(staged);
+    WindowCompressor().Finish(staged);
+    ASSERT_EQ(staged, fused);
+
+    PipeLineDeCompressor<WindowDeCompressor, RLEDeCompressor, DynamicHuffmanDeCompressor> deCompressor;
+    deCompressor.Finish(fused);
+    ASSERT_EQ(input, fused);
+}
+
 INSTANTIATE_TEST_CASE_P(InterestingAlgorithms, CompressTest,
     testing::Values(
         CompressionAlgo::DynamicHuffman,
@@ -243,4 +590,10 @@ INSTANTIATE_TEST_CASE_P(InterestingAlgorithms, CompressTest,
         CompressionAlgo::RLE_DynamicHuffman,
         CompressionAlgo::RLE_StaticHuffman,
         CompressionAlgo::Window_DynamicHuffman,
-        CompressionAlgo::Window_RLE_DynamicHuffman));
\ No newline at end of file
+        CompressionAlgo::Window_RLE_DynamicHuffman,
+        CompressionAlgo::StaticHuffman4,
+        CompressionAlgo::Range,
+        CompressionAlgo::RLE_Range,
+        CompressionAlgo::Window_Range,
+        CompressionAlgo::TANS,
+        CompressionAlgo::SemiAdaptiveHuffman));
\ No newline at end of file
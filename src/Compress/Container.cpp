@@ -0,0 +1,356 @@
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+#include "Container.h"
+#include "XXHash.h"
+
+const unsigned char ContainerCommon::headerMagic[4] = { 'F', 'u', 'n', 'C' };
+const unsigned char ContainerCommon::trailerMagic[4] = { 'F', 'u', 'n', 'X' };
+const size_t ContainerCommon::defaultBlockSize;
+const size_t ContainerCommon::headerSize;
+const size_t ContainerCommon::blockHeaderSize;
+const size_t ContainerCommon::indexEntrySize;
+const size_t ContainerCommon::trailerSize;
+
+void ContainerCommon::Store32(unsigned char* data, const uint32_t value)
+{
+    for (unsigned int i = 0; i < 4; ++i)
+    {
+        data[i] = static_cast<unsigned char>(value >> (8 * i));
+    }
+}
+
+void ContainerCommon::Store64(unsigned char* data, const uint64_t value)
+{
+    Store32(data, static_cast<uint32_t>(value));
+    Store32(data + 4, static_cast<uint32_t>(value >> 32));
+}
+
+uint32_t ContainerCommon::Load32(const unsigned char* data)
+{
+    return data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<uint32_t>(data[3]) << 24);
+}
+
+uint64_t ContainerCommon::Load64(const unsigned char* data)
+{
+    return Load32(data) | (static_cast<uint64_t>(Load32(data + 4)) << 32);
+}
+
+CompressionAlgo ContainerCommon::LoadAlgo(const unsigned char value)
+{
+    const auto& algos = CompressionAlgoNames::All();
+    const auto algo = std::find(algos.begin(), algos.end(), static_cast<CompressionAlgo>(value));
+    if (algo == algos.end())
+    {
+        throw std::runtime_error("Invalid data");
+    }
+    return *algo;
+}
+
+void ContainerCommon::DeCompressBlock(const CompressionAlgo algo, const Block& block, const unsigned char* data, std::vector<unsigned char>& output)
+{
+    output.assign(data, data + block.compressedSize);
+    DeCompressorFactory::Create(algo)->Finish(output);
+    if (output.size() != block.size || XXHash32(output.data(), output.size()) != block.checksum)
+    {
+        throw std::runtime_error("Checksum mismatch");
+    }
+}
+
+
+
+ContainerCompressor::ContainerCompressor(const CompressionAlgo algo, const size_t blockSize)
+    : m_algo(algo)
+    , m_level(CompressionLevel::Normal)
+    , m_blockSize(blockSize)
+    , m_headerWritten(false)
+    , m_offset(0)
+    , m_totalSize(0)
+    , m_blocks()
+    , m_inBuffer()
+    , m_block()
+{
+    if (blockSize == 0 || blockSize > 0xFFFFFFFFu)
+    {
+        throw std::runtime_error("Invalid block size");
+    }
+}
+
+void ContainerCompressor::SetLevel(CompressionLevel level)
+{
+    m_level = level;
+}
+
+void ContainerCompressor::WriteHeader(ByteOutput& output)
+{
+    if (!m_headerWritten)
+    {
+        unsigned char header[headerSize];
+        memcpy(header, headerMagic, 4);
+        header[4] = version;
+        header[5] = static_cast<unsigned char>(m_algo);
+        Store32(header + 6, static_cast<uint32_t>(m_blockSize));
+        output.Put(header, headerSize);
+        m_offset = headerSize;
+        m_headerWritten = true;
+    }
+}
+
+void ContainerCompressor::WriteBlock(const unsigned char* data, const size_t size, ByteOutput& output)
+{
+    m_block.assign(data, data + size);
+    CompressorFactory::Create(m_algo, m_level)->Finish(m_block);
+    if (m_block.size() > 0xFFFFFFFFu)
+    {
+        throw std::runtime_error("Block too large");
+    }
+    const Block block = { m_offset, static_cast<uint32_t>(size), static_cast<uint32_t>(m_block.size()), XXHash32(data, size) };
+    unsigned char header[blockHeaderSize];
+    Store32(header, block.size);
+    Store32(header + 4, block.compressedSize);
+    Store32(header + 8, block.checksum);
+    output.Put(header, blockHeaderSize);
+    output.Put(m_block.data(), m_block.size());
+    m_blocks.emplace_back(block);
+    m_offset += blockHeaderSize + m_block.size();
+    m_totalSize += size;
+}
+
+void ContainerCompressor::CompressBytes(const unsigned char* data, const size_t size, ByteOutput& output)
+{
+    WriteHeader(output);
+    const unsigned char* end = data + size;
+    if (!m_inBuffer.empty())
+    {
+        const size_t fill = std::min<size_t>(m_blockSize - m_inBuffer.size(), end - data);
+        m_inBuffer.insert(m_inBuffer.end(), data, data + fill);
+        data += fill;
+        if (m_inBuffer.size() < m_blockSize)
+        {
+            return;
+        }
+        WriteBlock(m_inBuffer.data(), m_inBuffer.size(), output);
+        m_inBuffer.clear();
+    }
+    // whole blocks are compressed from the input
+    for (; static_cast<size_t>(end - data) >= m_blockSize; data += m_blockSize)
+    {
+        WriteBlock(data, m_blockSize, output);
+    }
+    m_inBuffer.assign(data, end);
+}
+
+void ContainerCompressor::FinishBytes(ByteOutput& output)
+{
+    WriteHeader(output);
+    if (!m_inBuffer.empty())
+    {
+        WriteBlock(m_inBuffer.data(), m_inBuffer.size(), output);
+        m_inBuffer.clear();
+    }
+    unsigned char buffer[trailerSize];
+    Store32(buffer, 0);
+    output.Put(buffer, 4);
+    const uint64_t indexOffset = m_offset + 4;
+    for (const auto& block : m_blocks)
+    {
+        Store64(buffer, block.offset);
+        Store32(buffer + 8, block.size);
+        Store32(buffer + 12, block.compressedSize);
+        Store32(buffer + 16, block.checksum);
+        output.Put(buffer, indexEntrySize);
+    }
+    if (m_blocks.size() > 0xFFFFFFFFu)
+    {
+        throw std::runtime_error("Too many blocks");
+    }
+    Store32(buffer, static_cast<uint32_t>(m_blocks.size()));
+    Store64(buffer + 4, indexOffset);
+    Store64(buffer + 12, m_totalSize);
+    memcpy(buffer + 20, trailerMagic, 4);
+    output.Put(buffer, trailerSize);
+}
+
+
+
+ContainerDeCompressor::ContainerDeCompressor()
+    : m_state(State::Header)
+    , m_algo(CompressionAlgo::StaticHuffman)
+    , m_offset(0)
+    , m_totalSize(0)
+    , m_blocks()
+    , m_inBuffer()
+    , m_position(0)
+    , m_block()
+{
+}
+
+bool ContainerDeCompressor::ReadHeader()
+{
+    if (m_inBuffer.size() - m_position < headerSize)
+    {
+        return false;
+    }
+    const unsigned char* data = m_inBuffer.data() + m_position;
+    if (memcmp(data, headerMagic, 4) != 0 || data[4] != version)
+    {
+        throw std::runtime_error("Invalid data");
+    }
+    m_algo = LoadAlgo(data[5]);
+    m_position += headerSize;
+    m_offset = headerSize;
+    m_state = State::Blocks;
+    return true;
+}
+
+bool ContainerDeCompressor::ReadBlock(ByteOutput& output)
+{
+    const unsigned char* data = m_inBuffer.data() + m_position;
+    const size_t size = m_inBuffer.size() - m_position;
+    if (size < 4)
+    {
+        return false;
+    }
+    const Block block = { m_offset, Load32(data), size >= 8 ? Load32(data + 4) : 0, size >= 12 ? Load32(data + 8) : 0 };
+    if (block.size == 0)
+    {
+        // the index follows, it is checked at the end
+        m_position += 4;
+        m_offset += 4;
+        m_state = State::Index;
+        return true;
+    }
+    if (size < blockHeaderSize || size - blockHeaderSize < block.compressedSize)
+    {
+        return false;
+    }
+    DeCompressBlock(m_algo, block, data + blockHeaderSize, m_block);
+    output.Take(m_block);
+    m_blocks.emplace_back(block);
+    m_position += blockHeaderSize + block.compressedSize;
+    m_offset += blockHeaderSize + block.compressedSize;
+    m_totalSize += block.size;
+    return true;
+}
+
+void ContainerDeCompressor::DeCompressBytes(const unsigned char* data, const size_t size, ByteOutput& output)
+{
+    m_inBuffer.insert(m_inBuffer.end(), data, data + size);
+    bool more = true;
+    while (more)
+    {
+        switch (m_state)
+        {
+        case State::Header:
+            more = ReadHeader();
+            break;
+        case State::Blocks:
+            more = ReadBlock(output);
+            break;
+        case State::Index:
+            more = false;
+            break;
+        }
+    }
+    if (m_state != State::Index)
+    {
+        m_inBuffer.erase(m_inBuffer.begin(), m_inBuffer.begin() + m_position);
+        m_position = 0;
+    }
+}
+
+void ContainerDeCompressor::FinishBytes(ByteOutput&)
+{
+    if (m_state != State::Index)
+    {
+        throw std::runtime_error("Incomplete data");
+    }
+    // the index has to match the blocks
+    const unsigned char* data = m_inBuffer.data() + m_position;
+    if (m_inBuffer.size() - m_position != m_blocks.size() * indexEntrySize + trailerSize)
+    {
+        throw std::runtime_error("Invalid data");
+    }
+    for (const auto& block : m_blocks)
+    {
+        if (Load64(data) != block.offset || Load32(data + 8) != block.size || Load32(data + 12) != block.compressedSize || Load32(data + 16) != block.checksum)
+        {
+            throw std::runtime_error("Invalid data");
+        }
+        data += indexEntrySize;
+    }
+    if (Load32(data) != m_blocks.size() || Load64(data + 4) != m_offset || Load64(data + 12) != m_totalSize || memcmp(data + 20, trailerMagic, 4) != 0)
+    {
+        throw std::runtime_error("Invalid data");
+    }
+}
+
+
+
+ContainerReader::ContainerReader(const unsigned char* data, const size_t size)
+    : m_data(data)
+    , m_algo(CompressionAlgo::StaticHuffman)
+    , m_totalSize(0)
+    , m_blocks()
+    , m_positions()
+{
+    if (size < headerSize + 4 + trailerSize || memcmp(data, headerMagic, 4) != 0 || data[4] != version)
+    {
+        throw std::runtime_error("Invalid data");
+    }
+    m_algo = LoadAlgo(data[5]);
+    const unsigned char* trailer = data + size - trailerSize;
+    const uint64_t count = Load32(trailer);
+    const uint64_t indexOffset = Load64(trailer + 4);
+    m_totalSize = Load64(trailer + 12);
+    if (memcmp(trailer + 20, trailerMagic, 4) != 0 || indexOffset < headerSize + 4 || indexOffset > size - trailerSize || (size - trailerSize - indexOffset) != count * indexEntrySize)
+    {
+        throw std::runtime_error("Invalid data");
+    }
+    // the blocks follow each other, up to the end marker before the index
+    uint64_t offset = headerSize;
+    uint64_t position = 0;
+    const unsigned char* entry = data + indexOffset;
+    for (uint64_t i = 0; i < count; ++i, entry += indexEntrySize)
+    {
+        const Block block = { Load64(entry), Load32(entry + 8), Load32(entry + 12), Load32(entry + 16) };
+        if (block.offset != offset || block.size == 0 || offset + blockHeaderSize + block.compressedSize > indexOffset - 4)
+        {
+            throw std::runtime_error("Invalid data");
+        }
+        m_blocks.emplace_back(block);
+        m_positions.emplace_back(position);
+        offset += blockHeaderSize + block.compressedSize;
+        position += block.size;
+    }
+    if (offset != indexOffset - 4 || position != m_totalSize)
+    {
+        throw std::runtime_error("Invalid data");
+    }
+    m_positions.emplace_back(position);
+}
+
+void ContainerReader::Read(const uint64_t offset, const size_t size, std::vector<unsigned char>& output) const
+{
+    if (offset > m_totalSize || size > m_totalSize - offset)
+    {
+        throw std::runtime_error("Read past the end");
+    }
+    output.clear();
+    output.reserve(size);
+    const uint64_t end = offset + size;
+    // the last block which starts at or before offset
+    size_t index = std::upper_bound(m_positions.begin(), m_positions.end() - 1, offset) - m_positions.begin() - 1;
+    std::vector<unsigned char> block;
+    for (; output.size() < size; ++index)
+    {
+        assert(index < m_blocks.size());
+        DeCompressBlock(m_algo, m_blocks[index], m_data + m_blocks[index].offset + blockHeaderSize, block);
+        const uint64_t position = m_positions[index];
+        const size_t begin = static_cast<size_t>(std::max(offset, position) - position);
+        const size_t last = static_cast<size_t>(std::min(end, m_positions[index + 1]) - position);
+        output.insert(output.end(), block.begin() + begin, block.begin() + last);
+    }
+}
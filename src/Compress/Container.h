@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstdint>
+
+#include "SpanCodec.h"
+
+// self describing container around any CompressionAlgo. the data is split in blocks, which are
+// compressed independently and have a checksum. a block index at the end allows decompressing a
+// range of the data without reading the blocks before it.
+//
+// byte stream format (numbers are lsb first):
+//   - header: magic 'F','u','n','C', version:8, algo:8, block size:32
+//   - repeat for each block:
+//     - size:32, compressed size:32, checksum:32 (XXHash32 of the uncompressed block)
+//     - the compressed block
+//   - end: size:32 = 0
+//   - index, for each block: offset:64 (of the block, from the start), size:32, compressed size:32, checksum:32
+//   - trailer: block count:32, index offset:64, total size:64, magic 'F','u','n','X'
+//
+// all blocks have 'block size' bytes, except the last one.
+
+class ContainerCommon
+{
+public:
+    static const size_t defaultBlockSize = 1 << 20;
+
+protected:
+    static const unsigned char version = 1;
+    static const size_t headerSize = 10;
+    static const size_t blockHeaderSize = 12;
+    static const size_t indexEntrySize = 20;
+    static const size_t trailerSize = 24;
+    static const unsigned char headerMagic[4];
+    static const unsigned char trailerMagic[4];
+
+    struct Block
+    {
+        // of the block header in the container
+        uint64_t offset;
+        uint32_t size;
+        uint32_t compressedSize;
+        uint32_t checksum;
+    };
+
+    static void Store32(unsigned char* data, const uint32_t value);
+    static void Store64(unsigned char* data, const uint64_t value);
+    static uint32_t Load32(const unsigned char* data);
+    static uint64_t Load64(const unsigned char* data);
+    // the algorithm stored in a header, rejects unknown ids
+    static CompressionAlgo LoadAlgo(const unsigned char value);
+
+    // decompress a block and check its size and checksum
+    static void DeCompressBlock(const CompressionAlgo algo, const Block& block, const unsigned char* data, std::vector<unsigned char>& output);
+};
+
+class ContainerCompressor : public SpanCompressor, public ContainerCommon
+{
+public:
+    explicit ContainerCompressor(const CompressionAlgo algo, const size_t blockSize = defaultBlockSize);
+
+    void SetLevel(CompressionLevel level) override;
+    void CompressBytes(const unsigned char* data, const size_t size, ByteOutput& output) override;
+    void FinishBytes(ByteOutput& output) override;
+
+private:
+    void WriteHeader(ByteOutput& output);
+    void WriteBlock(const unsigned char* data, const size_t size, ByteOutput& output);
+
+    CompressionAlgo m_algo;
+    CompressionLevel m_level;
+    size_t m_blockSize;
+    bool m_headerWritten;
+    // bytes written so far
+    uint64_t m_offset;
+    uint64_t m_totalSize;
+    std::vector<Block> m_blocks;
+    // start of the next block, when less than a block is given
+    std::vector<unsigned char> m_inBuffer;
+    std::vector<unsigned char> m_block;
+};
+
+// the algorithm is read from the container
+class ContainerDeCompressor : public SpanDeCompressor, public ContainerCommon
+{
+public:
+    ContainerDeCompressor();
+
+    void DeCompressBytes(const unsigned char* data, const size_t size, ByteOutput& output) override;
+    void FinishBytes(ByteOutput& output) override;
+
+private:
+    enum class State
+    {
+        Header,
+        Blocks,
+        Index,
+    };
+
+    // returns false when more data is needed
+    bool ReadHeader();
+    bool ReadBlock(ByteOutput& output);
+
+    State m_state;
+    CompressionAlgo m_algo;
+    uint64_t m_offset;
+    uint64_t m_totalSize;
+    std::vector<Block> m_blocks;
+    std::vector<unsigned char> m_inBuffer;
+    // bytes used from the start of m_inBuffer
+    size_t m_position;
+    std::vector<unsigned char> m_block;
+};
+
+// random access to a container in memory, which has to stay there while the reader is used
+class ContainerReader : public ContainerCommon
+{
+public:
+    ContainerReader(const unsigned char* data, const size_t size);
+
+    CompressionAlgo Algo() const { return m_algo; }
+    // of the uncompressed data
+    uint64_t Size() const { return m_totalSize; }
+    size_t BlockCount() const { return m_blocks.size(); }
+
+    // the bytes [offset, offset + size) of the uncompressed data, only the blocks which hold them are
+    // decompressed. reading past the end is an error.
+    void Read(const uint64_t offset, const size_t size, std::vector<unsigned char>& output) const;
+
+private:
+    const unsigned char* m_data;
+    CompressionAlgo m_algo;
+    uint64_t m_totalSize;
+    std::vector<Block> m_blocks;
+    // uncompressed offset of each block, and the total size at the end
+    std::vector<uint64_t> m_positions;
+};
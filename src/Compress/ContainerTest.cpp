@@ -0,0 +1,174 @@
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "CommonTestFunctionality.h"
+
+#include "Container.h"
+#include "XXHash.h"
+
+class ContainerTest : public Test
+{
+protected:
+    virtual void SetUp()
+    {
+    }
+
+    virtual void TearDown()
+    {
+    }
+
+    static std::vector<unsigned char> GetInput(const size_t size)
+    {
+        std::mt19937 rng;
+        rng.seed(0);
+        std::vector<unsigned char> res;
+        while (res.size() < size)
+        {
+            const unsigned char value = static_cast<unsigned char>(rng() % 20);
+            res.insert(res.end(), 1 + rng() % 10, value);
+        }
+        res.resize(size);
+        return res;
+    }
+};
+
+TEST_F(ContainerTest, XXHash32)
+{
+    const auto hash = [](const std::string& text)
+    {
+        return XXHash32(reinterpret_cast<const unsigned char*>(text.data()), text.size());
+    };
+    EXPECT_EQ(0x02CC5D05u, hash(""));
+    EXPECT_EQ(0x550D7456u, hash("a"));
+    EXPECT_EQ(0x32D153FFu, hash("abc"));
+    EXPECT_EQ(0xE2293B2Fu, hash("Nobody inspects the spammish repetition"));
+}
+
+TEST_F(ContainerTest, Algorithms)
+{
+    const auto input = GetInput(200000);
+    for (auto ca : { CompressionAlgo::StaticHuffman, CompressionAlgo::Window_RLE_DynamicHuffman, CompressionAlgo::StaticHuffman4 })
+    {
+        for (size_t size : { size_t(0), size_t(1), size_t(65536), input.size() })
+        {
+            ContainerCompressor compressor(ca, 65536);
+            ContainerDeCompressor deCompressor;
+            std::vector<unsigned char> data(input.begin(), input.begin() + size);
+            compressor.Finish(data);
+            deCompressor.Finish(data);
+            ASSERT_EQ(std::vector<unsigned char>(input.begin(), input.begin() + size), data) << "Size: " << size;
+        }
+    }
+}
+
+TEST_F(ContainerTest, Chunks)
+{
+    const auto input = GetInput(1000000);
+    ContainerCompressor compressor(CompressionAlgo::RLE_StaticHuffman, 10000);
+    std::vector<unsigned char> compressed;
+    for (size_t offset = 0; offset < input.size(); offset += 12345)
+    {
+        std::vector<unsigned char> chunk(input.begin() + offset, input.begin() + std::min(input.size(), offset + 12345));
+        compressor.Compress(chunk);
+        compressed.insert(compressed.end(), chunk.begin(), chunk.end());
+    }
+    std::vector<unsigned char> chunk;
+    compressor.Finish(chunk);
+    compressed.insert(compressed.end(), chunk.begin(), chunk.end());
+
+    ContainerDeCompressor deCompressor;
+    std::vector<unsigned char> deCompressed;
+    for (size_t offset = 0; offset < compressed.size(); offset += 777)
+    {
+        chunk.assign(compressed.begin() + offset, compressed.begin() + std::min(compressed.size(), offset + 777));
+        deCompressor.DeCompress(chunk);
+        deCompressed.insert(deCompressed.end(), chunk.begin(), chunk.end());
+    }
+    chunk.clear();
+    deCompressor.Finish(chunk);
+    deCompressed.insert(deCompressed.end(), chunk.begin(), chunk.end());
+    ASSERT_EQ(input, deCompressed);
+}
+
+TEST_F(ContainerTest, Ranges)
+{
+    const auto input = GetInput(100000);
+    auto data = input;
+    ContainerCompressor compressor(CompressionAlgo::StaticHuffman4, 4096);
+    compressor.Finish(data);
+
+    ContainerReader reader(data.data(), data.size());
+    EXPECT_EQ(CompressionAlgo::StaticHuffman4, reader.Algo());
+    EXPECT_EQ(input.size(), reader.Size());
+    EXPECT_EQ((input.size() + 4095) / 4096, reader.BlockCount());
+    std::mt19937 rng;
+    rng.seed(0);
+    std::vector<unsigned char> range;
+    for (size_t i = 0; i < 100; ++i)
+    {
+        const size_t offset = rng() % input.size();
+        const size_t size = rng() % std::min<size_t>(input.size() - offset, 10000);
+        reader.Read(offset, size, range);
+        ASSERT_EQ(std::vector<unsigned char>(input.begin() + offset, input.begin() + offset + size), range) << "Offset: " << offset << " Size: " << size;
+    }
+    reader.Read(0, input.size(), range);
+    EXPECT_EQ(input, range);
+    EXPECT_THROW(reader.Read(input.size() - 10, 11, range), std::runtime_error);
+}
+
+TEST_F(ContainerTest, InvalidData)
+{
+    auto data = GetInput(100000);
+    ContainerCompressor compressor(CompressionAlgo::StaticHuffman, 10000);
+    compressor.Finish(data);
+    {
+        // a bit in the first compressed block
+        auto invalid = data;
+        invalid[30] ^= 1;
+        ContainerDeCompressor deCompressor;
+        EXPECT_THROW(deCompressor.Finish(invalid), std::runtime_error);
+        ContainerReader reader(invalid.data(), invalid.size());
+        std::vector<unsigned char> range;
+        EXPECT_THROW(reader.Read(0, 10, range), std::runtime_error);
+        EXPECT_NO_THROW(reader.Read(50000, 10, range));
+    }
+    {
+        // the index
+        auto invalid = data;
+        invalid[invalid.size() - 30] ^= 1;
+        ContainerDeCompressor deCompressor;
+        EXPECT_THROW(deCompressor.Finish(invalid), std::runtime_error);
+        EXPECT_THROW(ContainerReader(invalid.data(), invalid.size()), std::runtime_error);
+    }
+    {
+        auto incomplete = data;
+        incomplete.pop_back();
+        ContainerDeCompressor deCompressor;
+        EXPECT_THROW(deCompressor.Finish(incomplete), std::runtime_error);
+        EXPECT_THROW(ContainerReader(incomplete.data(), incomplete.size()), std::runtime_error);
+    }
+    {
+        auto header = data;
+        header[0] = 'X';
+        ContainerDeCompressor deCompressor;
+        EXPECT_THROW(deCompressor.Finish(header), std::runtime_error);
+    }
+    {
+        // an unknown algorithm id
+        auto algo = data;
+        algo[5] = 200;
+        ContainerDeCompressor deCompressor;
+        try
+        {
+            deCompressor.Finish(algo);
+            ADD_FAILURE() << "no exception";
+        }
+        catch (const std::runtime_error& e)
+        {
+            EXPECT_STREQ("Invalid data", e.what());
+        }
+        EXPECT_THROW(ContainerReader(algo.data(), algo.size()), std::runtime_error);
+    }
+}
@@ -0,0 +1,395 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+
+#include "Corpus.h"
+
+// the generators only use the raw output of std::mt19937, which is the same everywhere. the
+// distributions of <random> are not, except for the original synthetic types.
+
+namespace
+{
+    class Generator
+    {
+    public:
+        explicit Generator(const uint32_t seed)
+            : m_rng(seed)
+        {}
+
+        // [0, count)
+        uint32_t Next(const uint32_t count)
+        {
+            return static_cast<uint32_t>((static_cast<uint64_t>(m_rng()) * count) >> 32);
+        }
+        // [0, 1)
+        double Fraction()
+        {
+            return m_rng() / 4294967296.0;
+        }
+        bool Chance(const unsigned int percent)
+        {
+            return Next(100) < percent;
+        }
+        template<typename T, size_t N>
+        const T& Pick(const T(&values)[N])
+        {
+            return values[Next(N)];
+        }
+
+    private:
+        std::mt19937 m_rng;
+    };
+
+    // words of a vocabulary, word i is picked with a chance in proportion to 1/(i+1)
+    class ZipfWords
+    {
+    public:
+        ZipfWords(Generator& generator, const size_t count)
+            : m_words()
+            , m_cumulative()
+        {
+            static const char* common[] =
+            {
+                "the", "of", "and", "to", "a", "in", "is", "it", "that", "was", "for", "on", "are", "with", "as",
+                "he", "be", "at", "by", "this", "have", "from", "or", "one", "had", "not", "but", "what", "all",
+                "were", "when", "we", "there", "can", "an", "your", "which", "their", "said", "if", "do", "will",
+                "each", "about", "how", "up", "out", "them", "then", "she", "many", "some", "so", "these", "would",
+                "other", "into", "has", "more", "her", "two", "like", "him", "see", "time", "could", "no", "make",
+                "than", "first", "been", "its", "who", "now", "people", "my", "made", "over", "did", "down",
+                "only", "way", "find", "use", "may", "water", "long", "little", "very", "after", "words", "called",
+                "just", "where", "most", "know",
+            };
+            static const char* onsets[] = { "b", "c", "d", "f", "g", "h", "l", "m", "n", "p", "r", "s", "t", "v", "w", "br", "ch", "cl", "cr", "dr", "fr", "gr", "pl", "pr", "sh", "sp", "st", "str", "th", "tr" };
+            static const char* vowels[] = { "a", "e", "i", "o", "u", "ea", "ou", "ai", "ee", "oo" };
+            static const char* codas[] = { "", "", "n", "r", "s", "t", "l", "nd", "st", "ng", "ck", "rt", "ll", "nt" };
+            for (const char* word : common)
+            {
+                m_words.emplace_back(word);
+            }
+            while (m_words.size() < count)
+            {
+                std::string word;
+                const uint32_t syllables = 1 + generator.Next(3);
+                for (uint32_t i = 0; i < syllables; ++i)
+                {
+                    word += generator.Pick(onsets);
+                    word += generator.Pick(vowels);
+                }
+                word += generator.Pick(codas);
+                m_words.emplace_back(word);
+            }
+            double total = 0;
+            for (size_t i = 0; i < m_words.size(); ++i)
+            {
+                total += 1.0 / (i + 1);
+                m_cumulative.emplace_back(total);
+            }
+            for (auto& value : m_cumulative)
+            {
+                value /= total;
+            }
+        }
+
+        const std::string& Next(Generator& generator) const
+        {
+            const size_t index = std::upper_bound(m_cumulative.begin(), m_cumulative.end(), generator.Fraction()) - m_cumulative.begin();
+            return m_words[std::min(index, m_words.size() - 1)];
+        }
+
+    private:
+        std::vector<std::string> m_words;
+        std::vector<double> m_cumulative;
+    };
+
+    void Append(std::vector<unsigned char>& output, const std::string& text)
+    {
+        output.insert(output.end(), text.begin(), text.end());
+    }
+
+    template<typename T>
+    void AppendNumber(std::vector<unsigned char>& output, const T value)
+    {
+        for (size_t i = 0; i < sizeof(T); ++i)
+        {
+            output.emplace_back(static_cast<unsigned char>(static_cast<uint64_t>(value) >> (8 * i)));
+        }
+    }
+
+    std::string Timestamp(const uint64_t ms)
+    {
+        // days from 2024-01-01, 30 days a month is close enough
+        const uint64_t seconds = ms / 1000;
+        const uint64_t days = seconds / 86400;
+        char text[40];
+        snprintf(text, sizeof(text), "2024-%02u-%02uT%02u:%02u:%02u.%03uZ",
+            static_cast<unsigned>(1 + (days / 30) % 12), static_cast<unsigned>(1 + days % 30),
+            static_cast<unsigned>(seconds / 3600 % 24), static_cast<unsigned>(seconds / 60 % 60), static_cast<unsigned>(seconds % 60),
+            static_cast<unsigned>(ms % 1000));
+        return text;
+    }
+
+    void GenerateText(std::vector<unsigned char>& output, const size_t size, Generator& generator)
+    {
+        const ZipfWords words(generator, 5000);
+        size_t lineLength = 0;
+        while (output.size() < size)
+        {
+            // a paragraph of sentences
+            const uint32_t sentences = 2 + generator.Next(6);
+            for (uint32_t sentence = 0; sentence < sentences; ++sentence)
+            {
+                const uint32_t count = 4 + generator.Next(16);
+                for (uint32_t i = 0; i < count; ++i)
+                {
+                    std::string word = words.Next(generator);
+                    if (i == 0)
+                    {
+                        word[0] = static_cast<char>(toupper(word[0]));
+                    }
+                    if (i + 1 == count)
+                    {
+                        word += generator.Chance(90) ? "." : "?";
+                    }
+                    else if (generator.Chance(8))
+                    {
+                        word += ",";
+                    }
+                    if (lineLength > 0 && lineLength + 1 + word.size() > 72)
+                    {
+                        output.emplace_back('\n');
+                        lineLength = 0;
+                    }
+                    else if (lineLength > 0)
+                    {
+                        output.emplace_back(' ');
+                        ++lineLength;
+                    }
+                    Append(output, word);
+                    lineLength += word.size();
+                }
+            }
+            Append(output, "\n\n");
+            lineLength = 0;
+        }
+    }
+
+    void GenerateLogs(std::vector<unsigned char>& output, const size_t size, Generator& generator)
+    {
+        static const char* components[] = { "http", "db", "cache", "auth", "scheduler", "storage", "mail", "billing" };
+        static const char* paths[] = { "/", "/login", "/logout", "/api/v1/users", "/api/v1/orders", "/api/v1/items", "/static/app.js", "/health" };
+        static const char* methods[] = { "GET", "GET", "GET", "POST", "PUT", "DELETE" };
+        uint64_t ms = 1000ull * 86400 * 40;
+        char line[300];
+        while (output.size() < size)
+        {
+            ms += generator.Next(2000);
+            const uint32_t kind = generator.Next(100);
+            const char* level = kind < 70 ? "INFO " : kind < 90 ? "DEBUG" : kind < 98 ? "WARN " : "ERROR";
+            const char* component = generator.Pick(components);
+            switch (generator.Next(5))
+            {
+            case 0:
+                snprintf(line, sizeof(line), "%s %s [%s] %s %s status=%u duration=%ums client=10.0.%u.%u\n", Timestamp(ms).c_str(), level, component,
+                    generator.Pick(methods), generator.Pick(paths), generator.Chance(95) ? 200u : 500u, generator.Next(900), generator.Next(4), generator.Next(256));
+                break;
+            case 1:
+                snprintf(line, sizeof(line), "%s %s [%s] query took %u ms rows=%u\n", Timestamp(ms).c_str(), level, component, generator.Next(300), generator.Next(10000));
+                break;
+            case 2:
+                snprintf(line, sizeof(line), "%s %s [%s] user %u logged in from 192.168.%u.%u\n", Timestamp(ms).c_str(), level, component, 1000 + generator.Next(5000), generator.Next(4), generator.Next(256));
+                break;
+            case 3:
+                snprintf(line, sizeof(line), "%s %s [%s] cache hit ratio %u.%02u%% size=%u\n", Timestamp(ms).c_str(), level, component, 80 + generator.Next(20), generator.Next(100), generator.Next(1 << 20));
+                break;
+            default:
+                snprintf(line, sizeof(line), "%s %s [%s] job %u finished in %u.%03u s\n", Timestamp(ms).c_str(), level, component, generator.Next(100000), generator.Next(60), generator.Next(1000));
+                break;
+            }
+            Append(output, line);
+        }
+    }
+
+    void GenerateJson(std::vector<unsigned char>& output, const size_t size, Generator& generator)
+    {
+        static const char* firstNames[] = { "James", "Mary", "John", "Patricia", "Robert", "Jennifer", "Michael", "Linda", "William", "Elizabeth", "David", "Barbara" };
+        static const char* lastNames[] = { "Smith", "Johnson", "Williams", "Brown", "Jones", "Garcia", "Miller", "Davis", "Wilson", "Anderson", "Taylor", "Thomas" };
+        static const char* domains[] = { "example.com", "mail.example.org", "example.net" };
+        static const char* tags[] = { "new", "premium", "trial", "beta", "staff", "partner" };
+        static const char* countries[] = { "NL", "DE", "US", "GB", "FR", "BE" };
+        uint64_t ms = 1000ull * 86400 * 10;
+        char record[400];
+        for (uint32_t id = 1; output.size() < size; ++id)
+        {
+            ms += generator.Next(100000);
+            const char* first = generator.Pick(firstNames);
+            const char* last = generator.Pick(lastNames);
+            std::string tagList;
+            const uint32_t tagCount = generator.Next(3);
+            for (uint32_t i = 0; i < tagCount; ++i)
+            {
+                tagList += std::string(i > 0 ? "," : "") + "\"" + generator.Pick(tags) + "\"";
+            }
+            snprintf(record, sizeof(record),
+                "{\"id\":%u,\"name\":\"%s %s\",\"email\":\"%s.%s%u@%s\",\"active\":%s,\"score\":%u.%u,\"country\":\"%s\",\"tags\":[%s],\"created\":\"%s\"}\n",
+                id, first, last, first, last, generator.Next(100), generator.Pick(domains), generator.Chance(80) ? "true" : "false",
+                generator.Next(100), generator.Next(10), generator.Pick(countries), tagList.c_str(), Timestamp(ms).c_str());
+            Append(output, record);
+        }
+    }
+
+    void GenerateNumeric(std::vector<unsigned char>& output, const size_t size, Generator& generator)
+    {
+        // the columns of 1024 rows are stored one after the other
+        const uint32_t rows = 1024;
+        uint32_t id = 1;
+        uint64_t timestamp = 1704067200000ull;
+        int32_t price = 10000;
+        while (output.size() < size)
+        {
+            for (uint32_t row = 0; row < rows; ++row)
+            {
+                AppendNumber(output, id + row);
+            }
+            for (uint32_t row = 0; row < rows; ++row)
+            {
+                timestamp += generator.Next(1000);
+                AppendNumber(output, timestamp);
+            }
+            for (uint32_t row = 0; row < rows; ++row)
+            {
+                // random walk, in cents
+                price = std::max<int32_t>(1, price + static_cast<int32_t>(generator.Next(21)) - 10);
+                AppendNumber(output, price);
+            }
+            for (uint32_t row = 0; row < rows; ++row)
+            {
+                AppendNumber(output, static_cast<uint16_t>(generator.Chance(70) ? 1 + generator.Next(10) : generator.Next(1000)));
+            }
+            for (uint32_t row = 0; row < rows; ++row)
+            {
+                // a float in [0, 1)
+                const float value = static_cast<float>(generator.Fraction());
+                uint32_t bits;
+                memcpy(&bits, &value, sizeof(bits));
+                AppendNumber(output, bits);
+            }
+            id += rows;
+        }
+    }
+}
+
+const std::vector<CorpusType>& Corpus::All()
+{
+    static const std::vector<CorpusType> types =
+    {
+        CorpusType::Random,
+        CorpusType::RandomRange,
+        CorpusType::Sequence,
+        CorpusType::Sawtooth,
+        CorpusType::Single,
+        CorpusType::Text,
+        CorpusType::Logs,
+        CorpusType::Json,
+        CorpusType::Numeric,
+    };
+    return types;
+}
+
+std::string Corpus::Name(CorpusType type)
+{
+    switch (type)
+    {
+    case CorpusType::Random:      return "Random";
+    case CorpusType::RandomRange: return "RandomRange";
+    case CorpusType::Sequence:    return "Sequence";
+    case CorpusType::Sawtooth:    return "Sawtooth";
+    case CorpusType::Single:      return "Single";
+    case CorpusType::Text:        return "Text";
+    case CorpusType::Logs:        return "Logs";
+    case CorpusType::Json:        return "Json";
+    case CorpusType::Numeric:     return "Numeric";
+    }
+    return "Unknown(" + std::to_string(static_cast<int>(type)) + ")";
+}
+
+CorpusType Corpus::Parse(const std::string& name)
+{
+    for (auto type : All())
+    {
+        if (Name(type) == name)
+        {
+            return type;
+        }
+    }
+    throw std::runtime_error("Unknown corpus " + name);
+}
+
+std::vector<unsigned char> Corpus::Generate(CorpusType type, const size_t size, const uint32_t seed)
+{
+    static const std::vector<unsigned char> alternatingValues = { 1,2,3,4,5,6 };
+    std::vector<unsigned char> res;
+    res.reserve(size + 1024);
+    Generator generator(seed);
+    switch (type)
+    {
+    case CorpusType::Random:
+    case CorpusType::RandomRange:
+        {
+            std::mt19937 rng;
+            rng.seed(seed);
+            std::uniform_int_distribution<unsigned int> dist(0, type == CorpusType::Random ? 256 : 10);
+            for (size_t i = 0; i < size; ++i)
+            {
+                res.emplace_back(static_cast<unsigned char>(dist(rng)));
+            }
+        }
+        break;
+    case CorpusType::Sequence:
+        while (res.size() < size)
+        {
+            res.emplace_back(alternatingValues[res.size() % alternatingValues.size()]);
+        }
+        break;
+    case CorpusType::Sawtooth:
+        {
+            size_t index = 0;
+            size_t max = 0;
+            size_t cur = 0;
+            while (res.size() < size)
+            {
+                if (cur >= max)
+                {
+                    max++;
+                    if (max >= 50)
+                    {
+                        max = 1;
+                    }
+                    cur = 0;
+                    index = (index + 1) % alternatingValues.size();
+                }
+                cur++;
+                res.emplace_back(alternatingValues[index]);
+            }
+        }
+        break;
+    case CorpusType::Single:
+        res.assign(size, 42);
+        break;
+    case CorpusType::Text:
+        GenerateText(res, size, generator);
+        break;
+    case CorpusType::Logs:
+        GenerateLogs(res, size, generator);
+        break;
+    case CorpusType::Json:
+        GenerateJson(res, size, generator);
+        break;
+    case CorpusType::Numeric:
+        GenerateNumeric(res, size, generator);
+        break;
+    }
+    res.resize(size);
+    return res;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// data for tests and benchmarks. the same type, size and seed always give the same data.
+
+enum class CorpusType
+{
+    Random,       // random values [0..256)
+    RandomRange,  // random values [0..10)
+    Sequence,     // repeat sequence (1,2,3,4,5,6)
+    Sawtooth,     // sawtooth 1-50 times values (1,2,3,4,5,6)
+    Single,       // one value (42)
+    Text,         // English like text, the words have a Zipf distribution
+    Logs,         // log lines with timestamps, levels, components and messages
+    Json,         // JSON records, one per line
+    Numeric,      // blocks of little endian number columns: ids, timestamps, prices, quantities
+};
+
+class Corpus
+{
+public:
+    // all types, in order of their value
+    static const std::vector<CorpusType>& All();
+    static std::string Name(CorpusType type);
+    // throws for an unknown name
+    static CorpusType Parse(const std::string& name);
+
+    static std::vector<unsigned char> Generate(CorpusType type, const size_t size, const uint32_t seed = 0);
+};
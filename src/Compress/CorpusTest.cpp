@@ -0,0 +1,144 @@
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "CommonTestFunctionality.h"
+
+#include "Corpus.h"
+
+class CorpusTest : public Test
+{
+protected:
+    virtual void SetUp()
+    {
+    }
+
+    virtual void TearDown()
+    {
+    }
+
+    static std::vector<std::string> GetLines(const std::vector<unsigned char>& data)
+    {
+        std::vector<std::string> res;
+        std::string line;
+        for (auto c : data)
+        {
+            if (c == '\n')
+            {
+                res.emplace_back(line);
+                line.clear();
+            }
+            else
+            {
+                line += static_cast<char>(c);
+            }
+        }
+        // the last line is cut off
+        return res;
+    }
+};
+
+TEST_F(CorpusTest, Names)
+{
+    for (auto type : Corpus::All())
+    {
+        EXPECT_EQ(type, Corpus::Parse(Corpus::Name(type)));
+    }
+    EXPECT_THROW(Corpus::Parse("Unknown"), std::runtime_error);
+}
+
+TEST_F(CorpusTest, Deterministic)
+{
+    for (auto type : Corpus::All())
+    {
+        for (size_t size : { size_t(0), size_t(1), size_t(1000), size_t(100000) })
+        {
+            const auto data = Corpus::Generate(type, size, 7);
+            ASSERT_EQ(size, data.size()) << Corpus::Name(type);
+            ASSERT_EQ(data, Corpus::Generate(type, size, 7)) << Corpus::Name(type);
+        }
+    }
+    for (auto type : { CorpusType::Random, CorpusType::Text, CorpusType::Logs, CorpusType::Json, CorpusType::Numeric })
+    {
+        EXPECT_NE(Corpus::Generate(type, 10000, 1), Corpus::Generate(type, 10000, 2)) << Corpus::Name(type);
+    }
+    // a longer corpus starts with a shorter one
+    const auto text = Corpus::Generate(CorpusType::Text, 20000);
+    EXPECT_EQ(Corpus::Generate(CorpusType::Text, 5000), std::vector<unsigned char>(text.begin(), text.begin() + 5000));
+}
+
+TEST_F(CorpusTest, Text)
+{
+    const auto lines = GetLines(Corpus::Generate(CorpusType::Text, 200000));
+    std::map<std::string, size_t> counts;
+    for (const auto& line : lines)
+    {
+        ASSERT_LE(line.size(), 72u);
+        std::string word;
+        for (auto c : line + " ")
+        {
+            ASSERT_TRUE((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == ' ' || c == '.' || c == ',' || c == '?') << line;
+            if (c >= 'a' && c <= 'z')
+            {
+                word += c;
+            }
+            else if (!word.empty() && c == ' ')
+            {
+                ++counts[word];
+                word.clear();
+            }
+        }
+    }
+    // Zipf: the most common word is about twice as common as the second one
+    EXPECT_GT(counts["the"], counts["of"] * 3 / 2);
+    EXPECT_GT(counts["of"], counts["and"]);
+}
+
+TEST_F(CorpusTest, Logs)
+{
+    const auto lines = GetLines(Corpus::Generate(CorpusType::Logs, 100000));
+    ASSERT_GT(lines.size(), 500u);
+    std::string previous;
+    for (const auto& line : lines)
+    {
+        // 2024-02-11T00:00:01.234Z LEVEL [component] message
+        ASSERT_GT(line.size(), 40u);
+        const std::string timestamp = line.substr(0, 24);
+        EXPECT_EQ("2024-", timestamp.substr(0, 5)) << line;
+        EXPECT_EQ('T', timestamp[10]) << line;
+        EXPECT_EQ('Z', timestamp[23]) << line;
+        EXPECT_EQ('[', line[31]) << line;
+        EXPECT_LE(previous, timestamp) << line;
+        previous = timestamp;
+    }
+}
+
+TEST_F(CorpusTest, Json)
+{
+    const auto lines = GetLines(Corpus::Generate(CorpusType::Json, 100000));
+    ASSERT_GT(lines.size(), 300u);
+    for (size_t i = 0; i < lines.size(); ++i)
+    {
+        const auto& line = lines[i];
+        EXPECT_EQ("{\"id\":" + std::to_string(i + 1) + ",", line.substr(0, line.find(',') + 1));
+        EXPECT_EQ('}', line.back());
+        size_t quotes = 0;
+        for (auto c : line)
+        {
+            quotes += c == '"' ? 1 : 0;
+        }
+        EXPECT_EQ(0u, quotes % 2) << line;
+    }
+}
+
+TEST_F(CorpusTest, Numeric)
+{
+    const auto data = Corpus::Generate(CorpusType::Numeric, 100000);
+    // the first column holds the row ids, 32 bit little endian
+    for (uint32_t row = 0; row < 1024; ++row)
+    {
+        const uint32_t id = data[4 * row] | (data[4 * row + 1] << 8) | (data[4 * row + 2] << 16) | (static_cast<uint32_t>(data[4 * row + 3]) << 24);
+        ASSERT_EQ(row + 1, id);
+    }
+}
@@ -9,29 +9,33 @@
 
 DynamicHuffmanCompressor::DynamicHuffmanCompressor()
     : DynamicHuffmanCommon()
+    , m_codes()
 {}
 
 void DynamicHuffmanCompressor::WriteKeyUsingTree(unsigned int key)
 {
-    Key& k = m_keys[key];
-    if (k.bits.Empty())
+    Code& code = m_codes[key];
+    if (code.shape != m_shape)
     {
-        k.FillBits();
+        GetCode(key, code.bits, code.length);
+        code.shape = m_shape;
     }
-    m_buffer.Push(k.bits);
+    m_writer.Write(code.bits, code.length);
 }
 
-void DynamicHuffmanCompressor::Compress(std::vector<unsigned char>& ioBuffer)
+void DynamicHuffmanCompressor::CompressBytes(const unsigned char* data, const size_t size, ByteOutput& output)
 {
-    m_buffer.Reserve(ioBuffer.size() * sizeof(ioBuffer[0]) * 8);
-    for (size_t i = 0; i < ioBuffer.size(); ++i)
+    m_outBuffer.clear();
+    m_writer.Begin(m_outBuffer);
+    m_writer.Reserve(size * 8);
+    for (size_t i = 0; i < size; ++i)
     {
-        const auto c = ioBuffer[i];
-        if (m_keys[c].count == 0)
+        const auto c = data[i];
+        if (m_counts[c] == 0)
         {
             WriteKeyUsingTree(keyNew);
-            m_buffer.Push(c, 8u);
-            m_keys[keyNew].count++;
+            m_writer.Write(c, 8u);
+            m_counts[keyNew]++;
             UpdateTree(c,true);
         }
         else
@@ -40,50 +44,42 @@ void DynamicHuffmanCompressor::Compress(std::vector<unsigned char>& ioBuffer)
             UpdateTree(c,false);
         }
     }
-    ioBuffer.clear();
-    m_buffer.Pop(ioBuffer);
-    m_buffer.Optimize();
+    m_writer.End();
+    output.Take(m_outBuffer);
 }
 
-void DynamicHuffmanCompressor::Finish(std::vector<unsigned char>& ioBuffer)
+void DynamicHuffmanCompressor::FinishBytes(ByteOutput& output)
 {
-    Compress(ioBuffer);
-
+    m_outBuffer.clear();
+    m_writer.Begin(m_outBuffer);
     WriteKeyUsingTree(keyEnd);
-
-    if (ioBuffer.empty())
-    {
-        m_buffer.Pop(ioBuffer,true);
-    }
-    else
-    {
-        std::vector<unsigned char> temp;
-        m_buffer.Pop(temp,true);
-        ioBuffer.insert(ioBuffer.end(), temp.begin(), temp.end());
-    }
+    m_writer.End(true);
+    output.Take(m_outBuffer);
 }
 
 DynamicHuffmanDeCompressor::DynamicHuffmanDeCompressor()
     : DynamicHuffmanCommon()
-    , m_currentNode(m_tree)
+    , m_currentNode(0)
 {
 }
 
-void DynamicHuffmanDeCompressor::DeCompress(std::vector<unsigned char>& ioBuffer)
+void DynamicHuffmanDeCompressor::DeCompressBytes(const unsigned char* data, const size_t size, ByteOutput& output)
 {
-    m_buffer.Reserve(ioBuffer.size()*sizeof(ioBuffer[0])*8);
-    m_buffer.Push(ioBuffer, static_cast<unsigned int>(ioBuffer.size() * 8));
-    ioBuffer.clear();
+    m_buffer.Reserve(size * 8);
+    for (size_t i = 0; i < size; ++i)
+    {
+        m_buffer.Push(data[i], 8u);
+    }
     bool run = true;
     while (run)
     {
         unsigned int index;
-        while (m_currentNode->type == NodeType::branch)
+        while (m_nodes[m_currentNode].child != 0)
         {
             run = m_buffer.TryPopBit(index);
             if (run)
             {
-                m_currentNode = m_currentNode->node[index];
+                m_currentNode = m_nodes[m_currentNode].child + index;
             }
             else
             {
@@ -92,16 +88,17 @@ void DynamicHuffmanDeCompressor::DeCompress(std::vector<unsigned char>& ioBuffer
         }
         if (run)
         {
-            switch (m_currentNode->key->value)
+            const unsigned int key = m_nodes[m_currentNode].key;
+            switch (key)
             {
             case keyNew:
                 if (m_buffer.TryPop(index, 8u))
                 {
-                    ioBuffer.emplace_back(static_cast<unsigned char>(index));
-                    assert(m_keys[index].count == 0);
-                    m_keys[keyNew].count++;
+                    output.Put(static_cast<unsigned char>(index));
+                    assert(m_counts[index] == 0);
+                    m_counts[keyNew]++;
                     UpdateTree(index, true);
-                    m_currentNode = m_tree;
+                    m_currentNode = 0;
                 }
                 else
                 {
@@ -126,10 +123,10 @@ void DynamicHuffmanDeCompressor::DeCompress(std::vector<unsigned char>& ioBuffer
                 run = false;
                 break;
             default:
-                ioBuffer.emplace_back(static_cast<unsigned char>(m_currentNode->key->value));
-                assert(m_keys[m_currentNode->key->value].count != 0);
-                UpdateTree(m_currentNode->key->value, false);
-                m_currentNode = m_tree;
+                output.Put(static_cast<unsigned char>(key));
+                assert(m_counts[key] != 0);
+                UpdateTree(key, false);
+                m_currentNode = 0;
                 break;
             }
         }
@@ -137,12 +134,11 @@ void DynamicHuffmanDeCompressor::DeCompress(std::vector<unsigned char>& ioBuffer
     m_buffer.Optimize();
 }
 
-void DynamicHuffmanDeCompressor::Finish(std::vector<unsigned char>& ioBuffer)
+void DynamicHuffmanDeCompressor::FinishBytes(ByteOutput&)
 {
-    DeCompress(ioBuffer);
     if (!m_buffer.Empty() ||
-        m_currentNode->type == NodeType::branch ||
-        m_currentNode->key->value != keyEnd)
+        m_nodes[m_currentNode].child != 0 ||
+        m_nodes[m_currentNode].key != keyEnd)
     {
         throw std::runtime_error("Incomplete data");
     }
@@ -1,7 +1,11 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+
 #include "BitFiFo.h"
-#include "ICompress.h"
+#include "BitStream.h"
+#include "SpanCodec.h"
 
 // bit stream format:
 //   - init with (new table:0),(end:1)
@@ -19,317 +23,207 @@ protected:
 
     static const unsigned int keyCount = 258;
     static const unsigned int startNodeBits = 5;
-
-    // input/output buffer
-    BitFiFo m_buffer;
-
-    class KeyBits : public BitFiFo
-    {
-    public:
-        size_t Length() const
-        {
-            return BitFiFo::Size();
-        }
-        operator BitFiFo() const
-        {
-            return *this;
-        }
-    };
-    enum class NodeType
-    {
-        branch,
-        leaf
-    };
-    struct Node;
-    struct Key
-    {
-        Node* node = nullptr;
-        unsigned int value = 0;
-        unsigned int count = 0;
-        KeyBits bits;
-        void ClearBits()
-        {
-            bits.Clear();
-        }
-        void FillBits()
-        {
-            FillBits(node, bits);
-        }
-    private:
-        inline static void FillBits(Node* n, KeyBits& bits)
-        {
-            if (n->parent)
-            {
-                FillBits(n->parent, bits);
-                bits.PushBit(n->parent->node[0] != n);
-            }
-        }
-    };
+    static const unsigned int nodeCount = keyCount * 2;
+    // the tree is a huffman tree for counts which add up to less than 2^32, and those never give a
+    // code longer than this (HuffmanCode::MaxTotalCount(45) > 2^32). the codes fit a single write.
+    static const unsigned int maxCodeLength = 45;
+
+    // the tree is kept in flat arrays, indexed by the implicit numbering of the sibling property:
+    // position 0 is the root, the children of a branch are at an odd position and the one after it,
+    // and the counts go down with the position.
     struct Node
     {
-        Node* parent;
-        uint64_t tick;
-        unsigned int index;
         unsigned int count;
-        NodeType type;
-        union
-        {
-            Node* node[2];
-            Key* key;
-        };
-        void SetKey(Key* k)
-        {
-            tick = (uint64_t)-1;
-            key = k;
-            count = k->count;
-            type = NodeType::leaf;
-            k->node = this;
-        }
-        void SetNodes(Node* n0, Node* n1)
-        {
-            tick = (uint64_t)-1;
-            node[0] = n0;
-            node[1] = n1;
-            count = n0->count + n1->count;
-            type = NodeType::branch;
-            n0->parent = this;
-            n1->parent = this;
-        }
+        // the position of the first child of a branch, 0 for a leaf
+        uint16_t child;
+        uint16_t key;
     };
 
-    typedef std::array<Node, keyCount * 2> NodeCache;
-    NodeCache m_nodeCache;
-
-    typedef std::vector<Node*> Nodes;
+    typedef std::array<Node, nodeCount> Nodes;
     Nodes m_nodes;
 
-    typedef std::array<Key, keyCount> Keys;
-    Keys m_keys;
+    // the position of the parent of the node at each position, which changes when the parent moves
+    typedef std::array<uint16_t, nodeCount> Parents;
+    Parents m_parents;
 
-    Node* m_tree;
+    // the position of the leaf of each key, when its count isn't 0
+    typedef std::array<uint16_t, keyCount> Leaves;
+    Leaves m_leaves;
+
+    typedef std::array<unsigned int, keyCount> Counts;
+    Counts m_counts;
+
+    // goes up each time nodes move, and with them the codes
+    uint64_t m_shape;
 
     DynamicHuffmanCommon()
-        : m_buffer()
-        , m_nodeCache()
-        , m_nodes()
-        , m_keys()
-        , m_tree(nullptr)
+        : m_nodes()
+        , m_parents()
+        , m_leaves()
+        , m_counts()
+        , m_shape(0)
     {
-        m_nodes.reserve(keyCount * 2);
-        for (unsigned int key = 0; key<256; ++key)
-        {
-            m_keys[key].count = 0;
-            m_keys[key].value = key;
-        }
-        for (auto key : { keyNew,keyEnd })
-        {
-            m_keys[key].count = 1;
-            m_keys[key].value = key;
-        }
+        m_counts[keyNew] = 1;
+        m_counts[keyEnd] = 1;
         BuildTree();
     }
 
-    // add a node to the end of m_nodes;
-    inline Node* AddNode()
+    // the code of a key as an integer, the first bit of the code is the lsb
+    void GetCode(const unsigned int key, uint64_t& bits, unsigned int& length) const
     {
-        m_nodes.emplace_back(&m_nodeCache[m_nodes.size()]);
-        return m_nodes.back();
+        bits = 0;
+        length = 0;
+        for (unsigned int position = m_leaves[key]; position != 0; position = m_parents[position])
+        {
+            bits = (bits << 1) | ((position & 1) ^ 1);
+            ++length;
+        }
+        assert(length <= maxCodeLength);
     }
-	inline void AddKeyNode(Key * key)
-	{
-		Node & node = m_nodeCache[m_nodes.size()];
-		node.SetKey(key);
-		m_nodes.emplace_back(&node);
-	}
 
     void UpdateTree(unsigned int key, const bool forceUpdate)
     {
-        struct LocalFunctions
+        m_counts[key]++;
+        if (forceUpdate)
         {
-            // recount immediate children
-            static inline void UpdateCount(Node* node)
-            {
-                do
-                {
-                    node->count = node->node[0]->count + node->node[1]->count;
-                    node = node->parent;
-                } 
-                while (nullptr != node);
-            }
-            // clear the Key bits in this subtree, adjust node order for nodes which share a parent.
-            static inline void UpdateSubtree(Node* node, const uint64_t tick)
-            {
-                assert(node->parent != node);
-                if (node->tick == tick)
-                {
-                    return;
-                }
-                if (node->type == NodeType::branch)
-                {
-                    UpdateSubtree(node->node[0], tick);
-                    UpdateSubtree(node->node[1], tick);
-                    assert(node->count == node->node[0]->count + node->node[1]->count);
-                }
-                else
-                {
-                    node->key->ClearBits();
-                    assert(node->count == node->key->count);
-                }
-            };
-            // swap 2 nodes
-            static inline void SwapNodes(const unsigned int ai, const unsigned int bi, Nodes& nodes, const uint64_t tick)
-            {
-                Node* a = nodes[ai];
-                Node* b = nodes[bi];
-
-                assert(a->parent != a);
-                assert(b->parent != b);
-                assert(b->parent != a);
-                assert(a->parent != b);
-                assert(a->count < a->parent->count);
-                assert(b->count < b->parent->count);
-
-                assert(a->parent->count == a->parent->node[0]->count + a->parent->node[1]->count);
-                assert(b->parent->count == b->parent->node[0]->count + b->parent->node[1]->count);
-
-                if (a->parent == b->parent)
-                {
-                    assert((a->parent->node[0] == a && a->parent->node[1] == b) ||
-                           (a->parent->node[0] == b && a->parent->node[1] == a));
-                    std::swap(a->parent->node[0], a->parent->node[1]);
-                }
-                else
-                {
-                    assert(a->parent->node[0] == a || a->parent->node[1] == a);
-                    assert(b->parent->node[0] == b || b->parent->node[1] == b);
-                    a->parent->node[a->parent->node[0] == a ? 0 : 1] = b;
-                    b->parent->node[b->parent->node[0] == b ? 0 : 1] = a;
-                    if (a->count != b->count)
-                    {
-                        UpdateCount(a->parent);
-                        UpdateCount(b->parent);
-                    }
-                    std::swap(a->parent, b->parent);
-                }
-
-                assert(a->parent->count == a->parent->node[0]->count + a->parent->node[1]->count);
-                assert(b->parent->count == b->parent->node[0]->count + b->parent->node[1]->count);
-
-                nodes[ai] = b;
-                nodes[bi] = a;
-
-                b->index = ai;
-                a->index = bi;
-
-                UpdateSubtree(a, tick);
-                UpdateSubtree(b, tick);
-            };
-            // increase count for branch
-            static inline void IncreaseNodeCount(Node* node)
-            {
-                do
-                {
-                    node->count++;
-                    node = node->parent;
-                }
-                while(node);
-            }
-            // swap nodes if needed
-            static inline void SwapNodesIfNeeded(Node* node, Nodes& nodes, Node* tree)
+            BuildTree();
+        }
+        else
+        {
+            // from the leaf up: the node moves in front of the nodes with the same count, which each move
+            // one position down, and its count goes up. this keeps the counts ordered, and gives the
+            // same tree as swapping it with each of them in turn.
+            unsigned int position = m_leaves[key];
+            while (position != 0)
             {
-                uint64_t tick = tree->tick + 1;
-                while (node->parent)
+                const Node node = m_nodes[position];
+                if (position > 1 && m_nodes[position - 1].count <= node.count)
                 {
-                    unsigned int index = node->index;
-                    while (index > 1 && nodes[index]->count > nodes[index - 1]->count)
+                    do
                     {
-                        LocalFunctions::SwapNodes(index - 1, index, nodes, tick);
-                        index--;
+                        assert(m_nodes[position - 1].count == node.count);
+                        MoveNode(m_nodes[position - 1], position);
+                        --position;
                     }
-                    node = node->parent;
+                    while (position > 1 && m_nodes[position - 1].count <= node.count);
+                    MoveNode(node, position);
+                    ++m_shape;
                 }
+                m_nodes[position].count++;
+                position = m_parents[position];
             }
-        };
-        // only update when there is a neighbor change detected
-        m_keys[key].count++;
-        if (forceUpdate)
+            m_nodes[0].count++;
+        }
+    }
+
+    // put a node at a position, its children or key follow it
+    inline void MoveNode(const Node& node, const unsigned int position)
+    {
+        m_nodes[position] = node;
+        if (node.child != 0)
         {
-            BuildTree();
+            m_parents[node.child] = static_cast<uint16_t>(position);
+            m_parents[node.child + 1] = static_cast<uint16_t>(position);
         }
         else
         {
-            Node* node = m_keys[key].node;
-            LocalFunctions::IncreaseNodeCount(node);
-            LocalFunctions::SwapNodesIfNeeded(node,m_nodes,m_tree);
+            m_leaves[node.key] = static_cast<uint16_t>(position);
         }
     }
 
     void BuildTree()
     {
-        m_nodes.clear();
+        // until the positions are known, the nodes are numbered in the order they're made, with
+        // 'child' the number of the first child of a branch
+        Nodes nodes;
+        std::array<uint16_t, nodeCount> order;
         // add nodes for all used keys
-        for (auto& key:m_keys)
+        unsigned int size = 0;
+        for (unsigned int key = 0; key < keyCount; ++key)
         {
-            if (key.count > 0)
+            if (m_counts[key] > 0)
             {
-                key.ClearBits();
-				AddKeyNode(&key);
+                nodes[size] = Node{ m_counts[key], 0, static_cast<uint16_t>(key) };
+                order[size] = static_cast<uint16_t>(size);
+                ++size;
             }
         }
+        const unsigned int leafCount = size;
         // sort nodes, these are all 'key nodes'
-        std::sort(m_nodes.begin(), m_nodes.end(), [](Node* a, Node* b)
+        std::sort(order.begin(), order.begin() + size, [&nodes](const uint16_t a, const uint16_t b)
         {
-            assert(a->type == NodeType::leaf);
-            assert(b->type == NodeType::leaf);
-            return (a->count > b->count) || (a->count == b->count && a->key->value < b->key->value);
+            return (nodes[a].count > nodes[b].count) || (nodes[a].count == nodes[b].count && nodes[a].key < nodes[b].key);
         });
         // repeatedly join the 2 least important nodes until there is one node left
+        std::array<uint16_t, nodeCount> positions;
+        for (unsigned int count = size; count >= 2; --count)
         {
-            Node* node = nullptr;
-            for (size_t nodeCount = m_nodes.size(); nodeCount >= 2; --nodeCount)
+            assert(size < nodes.size());
+            nodes[size] = Node{ nodes[order[count - 2]].count + nodes[order[count - 1]].count, order[count - 2], 0 };
+            auto iter = std::lower_bound(order.begin(), order.begin() + count - 2, nodes[size].count, [&nodes](const uint16_t a, const unsigned int c)
             {
-                assert(m_nodes.size() < m_nodeCache.size());
-                node = &m_nodeCache[m_nodes.size()];
-                node->SetNodes(m_nodes[nodeCount - 2], m_nodes[nodeCount - 1]);
-                auto iter = std::lower_bound(m_nodes.begin(), m_nodes.begin() + nodeCount - 2, node, [](Node* a, Node* b)
-                {
-                    return (a->count > b->count);
-                });
-                m_nodes.emplace(iter, node);
-            }
-            m_tree = node;
+                return (nodes[a].count > c);
+            });
+            std::copy_backward(iter, order.begin() + size, order.begin() + size + 1);
+            *iter = static_cast<uint16_t>(size);
+            ++size;
+        }
+        // fill positions
+        for (unsigned int position = 0; position < size; ++position)
+        {
+            positions[order[position]] = static_cast<uint16_t>(position);
         }
-        // fill index
-        for (unsigned int i = 0; i<m_nodes.size(); ++i)
+        m_parents[0] = 0;
+        ++m_shape;
+        for (unsigned int position = 0; position < size; ++position)
         {
-            m_nodes[i]->tick = (uint64_t)-1;
-            m_nodes[i]->index = i;
+            Node node = nodes[order[position]];
+            if (order[position] >= leafCount)
+            {
+                node.child = positions[node.child];
+                assert((node.child & 1) == 1);
+            }
+            MoveNode(node, position);
         }
-        assert(m_tree->parent == nullptr);
     }
 };
 
-class DynamicHuffmanCompressor : public DynamicHuffmanCommon<ICompressor>
+class DynamicHuffmanCompressor : public DynamicHuffmanCommon<SpanCompressor>
 {
 public:
     DynamicHuffmanCompressor();
 
-    void Compress(std::vector<unsigned char>& ioBuffer) override;
-    void Finish(std::vector<unsigned char>& ioBuffer) override;
+    void CompressBytes(const unsigned char* data, const size_t size, ByteOutput& output) override;
+    void FinishBytes(ByteOutput& output) override;
 
 private:
     void WriteKeyUsingTree(unsigned int key);
+
+    // the code of each key, as long as the shape of the tree is the same
+    struct Code
+    {
+        uint64_t bits;
+        uint64_t shape;
+        unsigned int length;
+    };
+    std::array<Code, keyCount> m_codes;
+
+    std::vector<unsigned char> m_outBuffer;
+    BitWriter m_writer;
 };
 
-class DynamicHuffmanDeCompressor : public DynamicHuffmanCommon<IDeCompressor>
+class DynamicHuffmanDeCompressor : public DynamicHuffmanCommon<SpanDeCompressor>
 {
 public:
     DynamicHuffmanDeCompressor();
 
-    void DeCompress(std::vector<unsigned char>& ioBuffer) override;
-    void Finish(std::vector<unsigned char>& ioBuffer) override;
+    void DeCompressBytes(const unsigned char* data, const size_t size, ByteOutput& output) override;
+    void FinishBytes(ByteOutput& output) override;
 
 private:
-    Node * m_currentNode;
+    // input buffer
+    BitFiFo m_buffer;
+    // the position of the node reached by the bits so far
+    unsigned int m_currentNode;
 };
 
@@ -0,0 +1,53 @@
+#include <algorithm>
+#include <cstring>
+
+#include "Histogram.h"
+
+namespace
+{
+    // less data isn't worth clearing and adding the tables
+    const size_t minTableSize = 64;
+    // the tables are added to the counts before a 32 bit count can overflow
+    const size_t maxTableSize = size_t(1) << 30;
+}
+
+void Histogram::Count(const unsigned char* data, const size_t size, uint64_t* counts)
+{
+    const unsigned char* end = data + size;
+    if (size >= minTableSize)
+    {
+        // a run of one byte value makes each increment of a single table wait for the one before it.
+        // neighbouring bytes go to different tables, so four increments are independent.
+        uint32_t tables[4][byteCount];
+        while (end - data >= 16)
+        {
+            memset(tables, 0, sizeof(tables));
+            const unsigned char* tablesEnd = data + std::min<size_t>(end - data, maxTableSize);
+            for (; tablesEnd - data >= 16; data += 16)
+            {
+                // the order of the bytes in the words doesn't matter for the counts
+                uint64_t words[2];
+                memcpy(words, data, sizeof(words));
+                for (const uint64_t word : words)
+                {
+                    ++tables[0][static_cast<unsigned char>(word)];
+                    ++tables[1][static_cast<unsigned char>(word >> 8)];
+                    ++tables[2][static_cast<unsigned char>(word >> 16)];
+                    ++tables[3][static_cast<unsigned char>(word >> 24)];
+                    ++tables[0][static_cast<unsigned char>(word >> 32)];
+                    ++tables[1][static_cast<unsigned char>(word >> 40)];
+                    ++tables[2][static_cast<unsigned char>(word >> 48)];
+                    ++tables[3][static_cast<unsigned char>(word >> 56)];
+                }
+            }
+            for (unsigned int value = 0; value < byteCount; ++value)
+            {
+                counts[value] += uint64_t(tables[0][value]) + tables[1][value] + tables[2][value] + tables[3][value];
+            }
+        }
+    }
+    for (; data != end; ++data)
+    {
+        ++counts[*data];
+    }
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <inttypes.h>
+#include <cstddef>
+
+// byte counts for the codecs which build a model from a whole block
+//   Count : adds the count of each byte value in data to counts[0..256)
+
+class Histogram
+{
+public:
+    static const unsigned int byteCount = 256;
+
+    static void Count(const unsigned char* data, const size_t size, uint64_t* counts);
+};
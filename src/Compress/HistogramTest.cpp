@@ -0,0 +1,62 @@
+#include <random>
+#include <vector>
+
+#include "CommonTestFunctionality.h"
+
+#include "Histogram.h"
+
+class HistogramTest : public Test
+{
+protected:
+    virtual void SetUp()
+    {
+    }
+
+    virtual void TearDown()
+    {
+    }
+
+    static std::vector<uint64_t> Expected(const unsigned char* data, const size_t size)
+    {
+        std::vector<uint64_t> counts(Histogram::byteCount, 0);
+        for (size_t i = 0; i < size; ++i)
+        {
+            ++counts[data[i]];
+        }
+        return counts;
+    }
+};
+
+TEST_F(HistogramTest, MatchesCounting)
+{
+    std::mt19937 rng;
+    rng.seed(0);
+    std::vector<unsigned char> input;
+    while (input.size() < 10000)
+    {
+        // runs, and random bytes
+        const unsigned char value = static_cast<unsigned char>(rng());
+        input.insert(input.end(), rng() % 2 == 0 ? 1 + rng() % 100 : 1, value);
+    }
+    // every size around the 16 bytes per step, and unaligned starts
+    for (size_t offset = 0; offset < 8; ++offset)
+    {
+        for (size_t size : { 0, 1, 15, 16, 17, 63, 64, 65, 79, 80, 81, 1000, 9000 })
+        {
+            std::vector<uint64_t> counts(Histogram::byteCount, 0);
+            Histogram::Count(input.data() + offset, size, counts.data());
+            ASSERT_EQ(Expected(input.data() + offset, size), counts) << "Offset: " << offset << " Size: " << size;
+        }
+    }
+}
+
+TEST_F(HistogramTest, AddsToCounts)
+{
+    const std::vector<unsigned char> input(1000, 42);
+    std::vector<uint64_t> counts(Histogram::byteCount, 1);
+    Histogram::Count(input.data(), input.size(), counts.data());
+    Histogram::Count(input.data(), 10, counts.data());
+    EXPECT_EQ(1011u, counts[42]);
+    EXPECT_EQ(1u, counts[41]);
+    EXPECT_EQ(1u, counts[43]);
+}
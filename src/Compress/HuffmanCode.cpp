@@ -0,0 +1,114 @@
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+#include "HuffmanCode.h"
+
+const unsigned int HuffmanCode::maxCodeLength;
+
+void HuffmanCode::LimitedLengths(const uint64_t* counts, const size_t keyCount, const unsigned int maxLength, unsigned int* lengths)
+{
+    // package-merge: the lists hold the leaves and the pairs of the list below, sorted on weight. the
+    // cheapest 2n-2 items of the top list decide the lengths: a leaf gets one bit for every list
+    // it is taken from.
+    std::vector<unsigned int> keys;
+    for (unsigned int key = 0; key < keyCount; ++key)
+    {
+        lengths[key] = 0;
+        if (counts[key] > 0)
+        {
+            keys.emplace_back(key);
+        }
+    }
+    if (keys.size() <= 1)
+    {
+        if (!keys.empty())
+        {
+            lengths[keys.front()] = 1;
+        }
+        return;
+    }
+    assert(maxLength < 64 && keys.size() <= (uint64_t(1) << maxLength));
+    std::stable_sort(keys.begin(), keys.end(), [counts](unsigned int a, unsigned int b)
+    {
+        return counts[a] < counts[b];
+    });
+    const size_t n = keys.size();
+    // per list the weights, and whether the item is a leaf
+    std::vector<std::vector<uint64_t>> weights(maxLength);
+    std::vector<std::vector<bool>> leaves(maxLength);
+    for (unsigned int list = 0; list < maxLength; ++list)
+    {
+        const size_t packages = list == 0 ? 0 : weights[list - 1].size() / 2;
+        weights[list].reserve(n + packages);
+        leaves[list].reserve(n + packages);
+        size_t leaf = 0;
+        size_t package = 0;
+        while (leaf < n || package < packages)
+        {
+            const bool takeLeaf = package == packages ||
+                (leaf < n && counts[keys[leaf]] <= weights[list - 1][2 * package] + weights[list - 1][2 * package + 1]);
+            if (takeLeaf)
+            {
+                weights[list].emplace_back(counts[keys[leaf]]);
+                ++leaf;
+            }
+            else
+            {
+                weights[list].emplace_back(weights[list - 1][2 * package] + weights[list - 1][2 * package + 1]);
+                ++package;
+            }
+            leaves[list].push_back(takeLeaf);
+        }
+    }
+    size_t take = 2 * n - 2;
+    for (unsigned int list = maxLength; list-- > 0; )
+    {
+        assert(take <= weights[list].size());
+        const size_t taken = std::count(leaves[list].begin(), leaves[list].begin() + take, true);
+        for (size_t leaf = 0; leaf < taken; ++leaf)
+        {
+            ++lengths[keys[leaf]];
+        }
+        take = 2 * (take - taken);
+    }
+    assert(take == 0);
+}
+
+void HuffmanCode::CanonicalCodes(const unsigned int* lengths, const size_t keyCount, uint32_t* codes)
+{
+    std::vector<uint32_t> count(maxCodeLength + 1, 0);
+    for (size_t key = 0; key < keyCount; ++key)
+    {
+        assert(lengths[key] <= maxCodeLength);
+        ++count[lengths[key]];
+    }
+    count[0] = 0;
+    // first code for each length
+    std::vector<uint32_t> next(maxCodeLength + 1, 0);
+    uint32_t code = 0;
+    for (unsigned int length = 1; length <= maxCodeLength; ++length)
+    {
+        code = (code + count[length - 1]) << 1;
+        next[length] = code;
+    }
+    for (size_t key = 0; key < keyCount; ++key)
+    {
+        codes[key] = lengths[key] > 0 ? next[lengths[key]]++ : 0;
+    }
+}
+
+uint64_t HuffmanCode::MaxTotalCount(const unsigned int maxLength)
+{
+    // the smallest counts which give a tree of depth d are fibonacci numbers, adding up to F(d+2)
+    uint64_t a = 1;
+    uint64_t b = 1;
+    for (unsigned int i = 0; i < maxLength + 1; ++i)
+    {
+        const uint64_t c = a + b;
+        a = b;
+        b = c;
+    }
+    // b = F(maxLength + 3)
+    return b;
+}
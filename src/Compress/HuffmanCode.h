@@ -0,0 +1,24 @@
+#pragma once
+
+#include <inttypes.h>
+#include <cstddef>
+
+// code construction shared by the Huffman codecs
+//   LimitedLengths : optimal code lengths which don't exceed a maximum length (package-merge)
+//   CanonicalCodes : codes for a set of lengths, shorter codes first, equal lengths in key order.
+//                    the most significant bit of a code is written first.
+//   MaxTotalCount  : counts which add up to less than this never give a Huffman tree deeper than
+//                    maxLength.
+
+class HuffmanCode
+{
+public:
+    // codes are stored in 32 bits
+    static const unsigned int maxCodeLength = 32;
+
+    // lengths for the keys with a count > 0, 0 for the others. a single key gets length 1.
+    static void LimitedLengths(const uint64_t* counts, const size_t keyCount, const unsigned int maxLength, unsigned int* lengths);
+    // codes for the keys with a length > 0, 0 for the others
+    static void CanonicalCodes(const unsigned int* lengths, const size_t keyCount, uint32_t* codes);
+    static uint64_t MaxTotalCount(const unsigned int maxLength);
+};
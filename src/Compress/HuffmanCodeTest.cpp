@@ -0,0 +1,156 @@
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <random>
+#include <vector>
+
+#include "CommonTestFunctionality.h"
+
+#include "HuffmanCode.h"
+
+class HuffmanCodeTest : public Test
+{
+protected:
+    virtual void SetUp()
+    {
+    }
+
+    virtual void TearDown()
+    {
+    }
+
+    // total bits for the counts using the lengths
+    static uint64_t Cost(const std::vector<uint64_t>& counts, const std::vector<unsigned int>& lengths)
+    {
+        uint64_t cost = 0;
+        for (size_t key = 0; key < counts.size(); ++key)
+        {
+            cost += counts[key] * lengths[key];
+        }
+        return cost;
+    }
+
+    // total bits for an unlimited huffman code: the sum of all merged weights
+    static uint64_t HuffmanCost(const std::vector<uint64_t>& counts)
+    {
+        std::priority_queue<uint64_t, std::vector<uint64_t>, std::greater<uint64_t>> queue;
+        for (auto count : counts)
+        {
+            if (count > 0)
+            {
+                queue.push(count);
+            }
+        }
+        uint64_t cost = 0;
+        while (queue.size() > 1)
+        {
+            const uint64_t a = queue.top();
+            queue.pop();
+            const uint64_t b = queue.top();
+            queue.pop();
+            cost += a + b;
+            queue.push(a + b);
+        }
+        return cost;
+    }
+
+    // the lengths form a complete prefix code
+    static void CheckKraft(const std::vector<unsigned int>& lengths, const unsigned int maxLength)
+    {
+        uint64_t sum = 0;
+        for (auto length : lengths)
+        {
+            ASSERT_LE(length, maxLength);
+            if (length > 0)
+            {
+                sum += uint64_t(1) << (maxLength - length);
+            }
+        }
+        EXPECT_EQ(uint64_t(1) << maxLength, sum);
+    }
+};
+
+TEST_F(HuffmanCodeTest, LimitedLengthsMatchHuffman)
+{
+    std::mt19937 rng;
+    rng.seed(0);
+    for (int i = 0; i < 100; ++i)
+    {
+        std::vector<uint64_t> counts(257);
+        for (auto& count : counts)
+        {
+            count = rng() % 3 == 0 ? 0 : rng() % 1000;
+        }
+        counts[256] = 1;
+        std::vector<unsigned int> lengths(counts.size());
+        // long enough to never limit
+        HuffmanCode::LimitedLengths(counts.data(), counts.size(), 32, lengths.data());
+        CheckKraft(lengths, 32);
+        EXPECT_EQ(HuffmanCost(counts), Cost(counts, lengths));
+    }
+}
+
+TEST_F(HuffmanCodeTest, LimitedLengthsAreLimited)
+{
+    // fibonacci counts give the deepest tree
+    std::vector<uint64_t> counts = { 1, 1 };
+    while (counts.size() < 40)
+    {
+        counts.emplace_back(counts[counts.size() - 1] + counts[counts.size() - 2]);
+    }
+    std::vector<unsigned int> unlimited(counts.size());
+    HuffmanCode::LimitedLengths(counts.data(), counts.size(), 63, unlimited.data());
+    EXPECT_EQ(39u, *std::max_element(unlimited.begin(), unlimited.end()));
+    for (unsigned int maxLength : { 6u, 8u, 15u })
+    {
+        std::vector<unsigned int> lengths(counts.size());
+        HuffmanCode::LimitedLengths(counts.data(), counts.size(), maxLength, lengths.data());
+        CheckKraft(lengths, maxLength);
+        EXPECT_EQ(maxLength, *std::max_element(lengths.begin(), lengths.end()));
+        EXPECT_GE(Cost(counts, lengths), HuffmanCost(counts));
+    }
+}
+
+TEST_F(HuffmanCodeTest, LimitedLengthsSingleKey)
+{
+    std::vector<uint64_t> counts(10, 0);
+    std::vector<unsigned int> lengths(counts.size(), 5);
+    HuffmanCode::LimitedLengths(counts.data(), counts.size(), 15, lengths.data());
+    EXPECT_EQ(std::vector<unsigned int>(10, 0), lengths);
+    counts[3] = 100;
+    HuffmanCode::LimitedLengths(counts.data(), counts.size(), 15, lengths.data());
+    EXPECT_EQ(1u, lengths[3]);
+    EXPECT_EQ(9, std::count(lengths.begin(), lengths.end(), 0u));
+}
+
+TEST_F(HuffmanCodeTest, CanonicalCodes)
+{
+    const std::vector<unsigned int> lengths = { 3, 3, 3, 3, 3, 2, 4, 4, 0 };
+    std::vector<uint32_t> codes(lengths.size());
+    HuffmanCode::CanonicalCodes(lengths.data(), lengths.size(), codes.data());
+    // the example from rfc 1951
+    EXPECT_EQ((std::vector<uint32_t>{ 2, 3, 4, 5, 6, 0, 14, 15, 0 }), codes);
+}
+
+TEST_F(HuffmanCodeTest, MaxTotalCount)
+{
+    // counts 1,1,1 are the smallest which need 2 bits
+    EXPECT_EQ(3u, HuffmanCode::MaxTotalCount(1));
+    EXPECT_EQ(5u, HuffmanCode::MaxTotalCount(2));
+    // the deepest tree for its total count
+    std::vector<uint64_t> counts = { 1, 1 };
+    while (counts.size() < 20)
+    {
+        counts.emplace_back(counts[counts.size() - 1] + counts[counts.size() - 2]);
+    }
+    uint64_t total = 0;
+    for (auto count : counts)
+    {
+        total += count;
+    }
+    std::vector<unsigned int> lengths(counts.size());
+    HuffmanCode::LimitedLengths(counts.data(), counts.size(), 63, lengths.data());
+    const unsigned int longest = *std::max_element(lengths.begin(), lengths.end());
+    EXPECT_LT(total, HuffmanCode::MaxTotalCount(longest));
+    EXPECT_GE(total, HuffmanCode::MaxTotalCount(longest - 1));
+}
@@ -2,6 +2,7 @@
 #include <array>
 #include <deque>
 #include <algorithm>
+#include <stdexcept>
 
 #include "ICompress.h"
 #include "BitFiFo.h"
@@ -10,7 +11,82 @@
 #include "Window.h"
 #include "DynamicHuffman.h"
 #include "StaticHuffman.h"
+#include "StaticHuffman4.h"
+#include "SemiAdaptiveHuffman.h"
+#include "TANS.h"
 #include "PipeLine.h"
+#include "Range.h"
+#include "ThreadedPipeLine.h"
+
+const std::vector<CompressionAlgo>& CompressionAlgoNames::All()
+{
+    static const std::vector<CompressionAlgo> algos =
+    {
+        CompressionAlgo::DynamicHuffman,
+        CompressionAlgo::StaticHuffman,
+        CompressionAlgo::Window,
+        CompressionAlgo::RLE,
+        CompressionAlgo::RLE_DynamicHuffman,
+        CompressionAlgo::RLE_StaticHuffman,
+        CompressionAlgo::Window_DynamicHuffman,
+        CompressionAlgo::Window_RLE_DynamicHuffman,
+        CompressionAlgo::StaticHuffman4,
+        CompressionAlgo::Range,
+        CompressionAlgo::RLE_Range,
+        CompressionAlgo::Window_Range,
+        CompressionAlgo::TANS,
+        CompressionAlgo::SemiAdaptiveHuffman,
+    };
+    return algos;
+}
+
+std::string CompressionAlgoNames::Name(CompressionAlgo ca)
+{
+    switch (ca)
+    {
+    case CompressionAlgo::DynamicHuffman:
+        return "DynamicHuffman";
+    case CompressionAlgo::StaticHuffman:
+        return "StaticHuffman";
+    case CompressionAlgo::Window:
+        return "Window";
+    case CompressionAlgo::RLE:
+        return "RLE";
+    case CompressionAlgo::RLE_DynamicHuffman:
+        return "RLE_DynamicHuffman";
+    case CompressionAlgo::RLE_StaticHuffman:
+        return "RLE_StaticHuffman";
+    case CompressionAlgo::Window_DynamicHuffman:
+        return "Window_DynamicHuffman";
+    case CompressionAlgo::Window_RLE_DynamicHuffman:
+        return "Window_RLE_DynamicHuffman";
+    case CompressionAlgo::StaticHuffman4:
+        return "StaticHuffman4";
+    case CompressionAlgo::Range:
+        return "Range";
+    case CompressionAlgo::RLE_Range:
+        return "RLE_Range";
+    case CompressionAlgo::Window_Range:
+        return "Window_Range";
+    case CompressionAlgo::TANS:
+        return "TANS";
+    case CompressionAlgo::SemiAdaptiveHuffman:
+        return "SemiAdaptiveHuffman";
+    }
+    return "Unknown";
+}
+
+CompressionAlgo CompressionAlgoNames::Parse(const std::string& name)
+{
+    for (auto ca : All())
+    {
+        if (Name(ca) == name)
+        {
+            return ca;
+        }
+    }
+    throw std::runtime_error("Unknown algorithm " + name);
+}
 
 std::shared_ptr<ICompressor> CompressorFactory::Create(CompressionAlgo ca)
 {
@@ -33,7 +109,57 @@ std::shared_ptr<ICompressor> CompressorFactory::Create(CompressionAlgo ca)
         return std::make_shared<PipeLineCompressor<WindowCompressor, DynamicHuffmanCompressor>>();
     case CompressionAlgo::Window_RLE_DynamicHuffman:
         return std::make_shared<PipeLineCompressor<WindowCompressor, RLECompressor, DynamicHuffmanCompressor>>();
+    case CompressionAlgo::StaticHuffman4:
+        return std::make_shared<StaticHuffman4Compressor>();
+    case CompressionAlgo::Range:
+        return std::make_shared<RangeCompressor>();
+    // pipelines compress from the last type to the first, so the range coder gets the output of the others
+    case CompressionAlgo::RLE_Range:
+        return std::make_shared<PipeLineCompressor<RangeCompressor, RLECompressor>>();
+    case CompressionAlgo::Window_Range:
+        return std::make_shared<PipeLineCompressor<RangeCompressor, WindowCompressor>>();
+    case CompressionAlgo::TANS:
+        return std::make_shared<TANSCompressor>();
+    case CompressionAlgo::SemiAdaptiveHuffman:
+        return std::make_shared<SemiAdaptiveHuffmanCompressor>();
+    }
+}
+
+std::shared_ptr<ICompressor> CompressorFactory::Create(CompressionAlgo ca, CompressionLevel level)
+{
+    auto compressor = Create(ca);
+    compressor->SetLevel(level);
+    return compressor;
+}
+
+std::shared_ptr<ICompressor> CompressorFactory::CreateThreaded(CompressionAlgo ca, CompressionLevel level)
+{
+    std::shared_ptr<ICompressor> compressor;
+    switch (ca)
+    {
+    default:
+        return Create(ca, level);
+    case CompressionAlgo::RLE_DynamicHuffman:
+        compressor = std::make_shared<ThreadedPipeLineCompressor<RLECompressor, DynamicHuffmanCompressor>>();
+        break;
+    case CompressionAlgo::RLE_StaticHuffman:
+        compressor = std::make_shared<ThreadedPipeLineCompressor<RLECompressor, StaticHuffmanCompressor>>();
+        break;
+    case CompressionAlgo::Window_DynamicHuffman:
+        compressor = std::make_shared<ThreadedPipeLineCompressor<WindowCompressor, DynamicHuffmanCompressor>>();
+        break;
+    case CompressionAlgo::Window_RLE_DynamicHuffman:
+        compressor = std::make_shared<ThreadedPipeLineCompressor<WindowCompressor, RLECompressor, DynamicHuffmanCompressor>>();
+        break;
+    case CompressionAlgo::RLE_Range:
+        compressor = std::make_shared<ThreadedPipeLineCompressor<RangeCompressor, RLECompressor>>();
+        break;
+    case CompressionAlgo::Window_Range:
+        compressor = std::make_shared<ThreadedPipeLineCompressor<RangeCompressor, WindowCompressor>>();
+        break;
     }
+    compressor->SetLevel(level);
+    return compressor;
 }
 
 std::shared_ptr<IDeCompressor> DeCompressorFactory::Create(CompressionAlgo ca)
@@ -57,5 +183,38 @@ std::shared_ptr<IDeCompressor> DeCompressorFactory::Create(CompressionAlgo ca)
         return std::make_shared<PipeLineDeCompressor<WindowDeCompressor, DynamicHuffmanDeCompressor>>();
     case CompressionAlgo::Window_RLE_DynamicHuffman:
         return std::make_shared<PipeLineDeCompressor<WindowDeCompressor, RLEDeCompressor, DynamicHuffmanDeCompressor>>();
+    case CompressionAlgo::StaticHuffman4:
+        return std::make_shared<StaticHuffman4DeCompressor>();
+    case CompressionAlgo::Range:
+        return std::make_shared<RangeDeCompressor>();
+    case CompressionAlgo::RLE_Range:
+        return std::make_shared<PipeLineDeCompressor<RangeDeCompressor, RLEDeCompressor>>();
+    case CompressionAlgo::Window_Range:
+        return std::make_shared<PipeLineDeCompressor<RangeDeCompressor, WindowDeCompressor>>();
+    case CompressionAlgo::TANS:
+        return std::make_shared<TANSDeCompressor>();
+    case CompressionAlgo::SemiAdaptiveHuffman:
+        return std::make_shared<SemiAdaptiveHuffmanDeCompressor>();
+    }
+}
+
+std::shared_ptr<IDeCompressor> DeCompressorFactory::CreateThreaded(CompressionAlgo ca)
+{
+    switch (ca)
+    {
+    default:
+        return Create(ca);
+    case CompressionAlgo::RLE_DynamicHuffman:
+        return std::make_shared<ThreadedPipeLineDeCompressor<RLEDeCompressor, DynamicHuffmanDeCompressor>>();
+    case CompressionAlgo::RLE_StaticHuffman:
+        return std::make_shared<ThreadedPipeLineDeCompressor<RLEDeCompressor, StaticHuffmanDeCompressor>>();
+    case CompressionAlgo::Window_DynamicHuffman:
+        return std::make_shared<ThreadedPipeLineDeCompressor<WindowDeCompressor, DynamicHuffmanDeCompressor>>();
+    case CompressionAlgo::Window_RLE_DynamicHuffman:
+        return std::make_shared<ThreadedPipeLineDeCompressor<WindowDeCompressor, RLEDeCompressor, DynamicHuffmanDeCompressor>>();
+    case CompressionAlgo::RLE_Range:
+        return std::make_shared<ThreadedPipeLineDeCompressor<RangeDeCompressor, RLEDeCompressor>>();
+    case CompressionAlgo::Window_Range:
+        return std::make_shared<ThreadedPipeLineDeCompressor<RangeDeCompressor, WindowDeCompressor>>();
     }
 }
@@ -5,12 +5,39 @@
 #include <map>
 #include <array>
 #include <iterator>
+#include <string>
+
+// trade speed for ratio, compressors without a choice ignore it
+enum class CompressionLevel
+{
+    Fast,
+    Normal,
+    Max
+};
+
+// result of the calls which write to a caller's buffer
+enum class CodecStatus
+{
+    Done,      // all output is written
+    NeedsSpace // there is more output, call again with new space (and no new input)
+};
+
+// there are two ways to use a codec, which can be mixed:
+//   - vector: the output replaces the data in ioBuffer
+//   - span: all input is used, the output is written to [output,output+outputSize) and 'written' is set
+//     to the number of bytes written. output which doesn't fit is kept for the next call, which is
+//     signalled by NeedsSpace. keep calling Finish until it returns Done.
+// SpanCodec.h has base classes which implement one way using the other.
 
 class ICompressor
 {
 public:
+    // has to be called before the first Compress/Finish
+    virtual void SetLevel(CompressionLevel /*level*/) {}
     virtual void Compress(std::vector<unsigned char>& ioBuffer) = 0;
     virtual void Finish(std::vector<unsigned char>& ioBuffer) = 0;
+    virtual CodecStatus Compress(const unsigned char* input, const size_t inputSize, unsigned char* output, const size_t outputSize, size_t& written) = 0;
+    virtual CodecStatus Finish(unsigned char* output, const size_t outputSize, size_t& written) = 0;
 };
 
 class IDeCompressor
@@ -18,6 +45,8 @@ class IDeCompressor
 public:
     virtual void DeCompress(std::vector<unsigned char>& ioBuffer) = 0;
     virtual void Finish(std::vector<unsigned char>& ioBuffer) = 0;
+    virtual CodecStatus DeCompress(const unsigned char* input, const size_t inputSize, unsigned char* output, const size_t outputSize, size_t& written) = 0;
+    virtual CodecStatus Finish(unsigned char* output, const size_t outputSize, size_t& written) = 0;
 };
 
 enum class CompressionAlgo
@@ -29,18 +58,43 @@ enum class CompressionAlgo
     RLE_DynamicHuffman,
     RLE_StaticHuffman,
     Window_DynamicHuffman,
-    Window_RLE_DynamicHuffman
+    Window_RLE_DynamicHuffman,
+    // static huffman blocks in 4 streams, for faster decoding
+    StaticHuffman4,
+    // order-0 adaptive range coder, alone and as the last stage after RLE or Window
+    Range,
+    RLE_Range,
+    Window_Range,
+    // block static tANS, with the blocks of StaticHuffman
+    TANS,
+    // adaptive counts, with new huffman codes every few thousand keys
+    SemiAdaptiveHuffman,
+};
+
+class CompressionAlgoNames
+{
+public:
+    // all algorithms, in order of their value
+    static const std::vector<CompressionAlgo>& All();
+    static std::string Name(CompressionAlgo ca);
+    // throws for an unknown name
+    static CompressionAlgo Parse(const std::string& name);
 };
 
 class CompressorFactory
 {
 public:
     static std::shared_ptr<ICompressor> Create(CompressionAlgo ca);
+    static std::shared_ptr<ICompressor> Create(CompressionAlgo ca, CompressionLevel level);
+    // pipelines run a thread per stage, the output is the same as from Create
+    static std::shared_ptr<ICompressor> CreateThreaded(CompressionAlgo ca, CompressionLevel level);
 };
 
 class DeCompressorFactory
 {
 public:
     static std::shared_ptr<IDeCompressor> Create(CompressionAlgo ca);
+    // pipelines run a thread per stage
+    static std::shared_ptr<IDeCompressor> CreateThreaded(CompressionAlgo ca);
 };
 
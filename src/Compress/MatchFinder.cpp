@@ -0,0 +1,261 @@
+#include <algorithm>
+#include <cassert>
+
+#include "MatchFinder.h"
+#include "MatchLength.h"
+
+const unsigned int IMatchFinder::minLength;
+const uint32_t MatchFinderCommon::empty;
+
+std::unique_ptr<IMatchFinder> IMatchFinder::Create(MatchFinderType type, unsigned int minDistance, unsigned int maxDistance)
+{
+    switch (type)
+    {
+    default:
+    case MatchFinderType::HashChain:
+        return std::unique_ptr<IMatchFinder>(new HashChainMatchFinder(minDistance, maxDistance));
+    case MatchFinderType::BinaryTree:
+        return std::unique_ptr<IMatchFinder>(new BinaryTreeMatchFinder(minDistance, maxDistance));
+    }
+}
+
+MatchFinderCommon::MatchFinderCommon(unsigned int minDistance, unsigned int maxDistance, unsigned int depth)
+    : m_head(size_t(1) << minHashBits, empty)
+    , m_hashBits(minHashBits)
+    , m_mask((1u << minHashBits) - 1)
+    , m_maxMask(1)
+    , m_minDistance(std::max(minDistance, 1u))
+    , m_maxDistance(maxDistance)
+    , m_depth(depth)
+{
+    while (m_maxMask < maxDistance)
+    {
+        m_maxMask = (m_maxMask << 1) | 1;
+    }
+    m_mask = std::min(m_mask, m_maxMask);
+}
+
+void MatchFinderCommon::Resize()
+{
+    Reset(m_head, size_t(1) << m_hashBits);
+}
+
+void MatchFinderCommon::Reset(std::vector<uint32_t>& positions, const size_t size)
+{
+    // free the old table first, so growing doesn't need both at once
+    std::vector<uint32_t>().swap(positions);
+    positions.assign(size, empty);
+}
+
+void MatchFinderCommon::Grow(const unsigned char* data, uint32_t pos, unsigned int maxLength)
+{
+    while (m_mask < pos && m_mask < m_maxMask)
+    {
+        m_mask = (m_mask << 1) | 1;
+        if (m_hashBits < maxHashBits)
+        {
+            ++m_hashBits;
+        }
+    }
+    Resize();
+    // older positions have at least as many bytes available
+    const uint32_t first = pos > m_maxDistance ? pos - m_maxDistance : 0;
+    for (uint32_t added = first; added < pos; ++added)
+    {
+        Add(data, added, maxLength);
+    }
+}
+
+void MatchFinderCommon::Find(const unsigned char* data, uint32_t pos, unsigned int maxLength, Matches& matches)
+{
+    Skip(data, pos, maxLength);
+    Search(data, pos, maxLength, matches);
+}
+
+void MatchFinderCommon::Skip(const unsigned char* data, uint32_t pos, unsigned int maxLength)
+{
+    assert(maxLength >= minLength);
+    if (pos >= m_minDistance)
+    {
+        // at least as many bytes are available for the older position
+        const uint32_t added = pos - m_minDistance;
+        if (added > m_mask && m_mask < m_maxMask)
+        {
+            Grow(data, added, maxLength);
+        }
+        Add(data, added, maxLength);
+    }
+}
+
+void MatchFinderCommon::Rebase(uint32_t delta)
+{
+    assert(delta % DictionarySize() == 0 && m_mask == m_maxMask);
+    RebasePositions(m_head, delta);
+}
+
+void MatchFinderCommon::RebasePositions(std::vector<uint32_t>& positions, uint32_t delta)
+{
+    for (auto& pos : positions)
+    {
+        pos = (pos == empty || pos < delta) ? empty : pos - delta;
+    }
+}
+
+unsigned int MatchFinderCommon::Hash(const unsigned char* data) const
+{
+    const uint32_t key = data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+    return (key * 2654435761u) >> (32 - m_hashBits);
+}
+
+uint32_t MatchFinderCommon::UpdateHead(const unsigned char* data, uint32_t pos)
+{
+    uint32_t& head = m_head[Hash(data + pos)];
+    const uint32_t candidate = head;
+    head = pos;
+    return candidate;
+}
+
+HashChainMatchFinder::HashChainMatchFinder(unsigned int minDistance, unsigned int maxDistance, unsigned int depth)
+    : MatchFinderCommon(minDistance, maxDistance, depth)
+    , m_chain(m_mask + 1, empty)
+{}
+
+void HashChainMatchFinder::Resize()
+{
+    MatchFinderCommon::Resize();
+    Reset(m_chain, m_mask + 1);
+}
+
+void HashChainMatchFinder::Rebase(uint32_t delta)
+{
+    MatchFinderCommon::Rebase(delta);
+    RebasePositions(m_chain, delta);
+}
+
+void HashChainMatchFinder::Add(const unsigned char* data, uint32_t pos, unsigned int /*maxLength*/)
+{
+    m_chain[Slot(pos)] = UpdateHead(data, pos);
+}
+
+void HashChainMatchFinder::Search(const unsigned char* data, uint32_t pos, unsigned int maxLength, Matches& matches) const
+{
+    const unsigned char* current = data + pos;
+    uint32_t candidate = m_head[Hash(current)];
+    unsigned int best = minLength - 1;
+    for (unsigned int depth = m_depth; depth > 0 && InRange(candidate, pos); --depth)
+    {
+        const unsigned char* other = data + candidate;
+        // the byte after the current best length has to match for an improvement
+        if (other[best] == current[best])
+        {
+            const unsigned int length = MatchLength::Extend(current, other, 0, maxLength);
+            if (length > best)
+            {
+                best = length;
+                matches.push_back({ length, static_cast<unsigned int>(pos - candidate) });
+                if (length == maxLength)
+                {
+                    break;
+                }
+            }
+        }
+        candidate = m_chain[Slot(candidate)];
+    }
+}
+
+BinaryTreeMatchFinder::BinaryTreeMatchFinder(unsigned int minDistance, unsigned int maxDistance, unsigned int depth)
+    : MatchFinderCommon(minDistance, maxDistance, depth)
+    , m_tree(2 * (m_mask + 1), empty)
+{}
+
+void BinaryTreeMatchFinder::Resize()
+{
+    MatchFinderCommon::Resize();
+    Reset(m_tree, 2 * (size_t(m_mask) + 1));
+}
+
+void BinaryTreeMatchFinder::Rebase(uint32_t delta)
+{
+    MatchFinderCommon::Rebase(delta);
+    RebasePositions(m_tree, delta);
+}
+
+void BinaryTreeMatchFinder::Add(const unsigned char* data, uint32_t pos, unsigned int maxLength)
+{
+    // pos becomes the new root of the tree for its hash, all older positions are split into
+    // the ones smaller and larger than the data at pos while walking down the old tree.
+    uint32_t candidate = UpdateHead(data, pos);
+    uint32_t* smaller = &m_tree[2 * Slot(pos)];
+    uint32_t* larger = &m_tree[2 * Slot(pos) + 1];
+    unsigned int smallerLength = 0;
+    unsigned int largerLength = 0;
+    const unsigned char* current = data + pos;
+    for (unsigned int depth = m_depth; ; --depth)
+    {
+        if (depth == 0 || !InRange(candidate, pos))
+        {
+            *smaller = empty;
+            *larger = empty;
+            return;
+        }
+        uint32_t* pair = &m_tree[2 * Slot(candidate)];
+        const unsigned char* other = data + candidate;
+        // everything in this subtree shares at least min(smallerLength,largerLength) bytes with pos
+        const unsigned int length = MatchLength::Extend(current, other, std::min(smallerLength, largerLength), maxLength);
+        if (length == maxLength)
+        {
+            // candidate is replaced by pos
+            *smaller = pair[0];
+            *larger = pair[1];
+            return;
+        }
+        if (other[length] < current[length])
+        {
+            *smaller = candidate;
+            smaller = &pair[1];
+            candidate = *smaller;
+            smallerLength = length;
+        }
+        else
+        {
+            *larger = candidate;
+            larger = &pair[0];
+            candidate = *larger;
+            largerLength = length;
+        }
+    }
+}
+
+void BinaryTreeMatchFinder::Search(const unsigned char* data, uint32_t pos, unsigned int maxLength, Matches& matches) const
+{
+    const unsigned char* current = data + pos;
+    uint32_t candidate = m_head[Hash(current)];
+    unsigned int smallerLength = 0;
+    unsigned int largerLength = 0;
+    unsigned int best = minLength - 1;
+    for (unsigned int depth = m_depth; depth > 0 && InRange(candidate, pos); --depth)
+    {
+        const uint32_t* pair = &m_tree[2 * Slot(candidate)];
+        const unsigned char* other = data + candidate;
+        const unsigned int length = MatchLength::Extend(current, other, std::min(smallerLength, largerLength), maxLength);
+        if (length > best)
+        {
+            best = length;
+            matches.push_back({ length, static_cast<unsigned int>(pos - candidate) });
+            if (length == maxLength)
+            {
+                break;
+            }
+        }
+        if (other[length] < current[length])
+        {
+            candidate = pair[1];
+            smallerLength = length;
+        }
+        else
+        {
+            candidate = pair[0];
+            largerLength = length;
+        }
+    }
+}
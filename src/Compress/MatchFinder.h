@@ -0,0 +1,129 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <inttypes.h>
+
+// match finders for LZ style compressors
+//   HashChain  : hash of the first 4 bytes -> most recent position, each position links to the previous one
+//                with the same hash. the chain is followed up to a fixed depth.
+//   BinaryTree : hash of the first 4 bytes -> root of a binary tree which keeps all positions sorted on
+//                the data which follows them. slower, but finds (nearly) all long matches.
+//
+// positions are indices into the data buffer passed to Find/Skip, every position has to be passed to
+// either Find or Skip in increasing order. positions are added to the search structure 'minDistance'
+// positions late, so closer matches can't hide the ones which are far enough away.
+// when the data buffer is slid back, Rebase moves all stored positions along with it.
+// the tables start small and grow with the positions added, up to the size for the whole dictionary.
+// on each growth the positions are added again, so short inputs don't pay for a large dictionary.
+
+enum class MatchFinderType
+{
+    HashChain,
+    BinaryTree
+};
+
+struct Match
+{
+    unsigned int length;
+    unsigned int distance;
+};
+typedef std::vector<Match> Matches;
+
+class IMatchFinder
+{
+public:
+    static const unsigned int minLength = 4;
+
+    virtual ~IMatchFinder() {}
+
+    // add the matches for position pos to 'matches', every match is longer and further away than the one
+    // before it. maxLength is the number of bytes available at pos, and should be >= minLength.
+    virtual void Find(const unsigned char* data, uint32_t pos, unsigned int maxLength, Matches& matches) = 0;
+    // add position pos without looking for matches
+    virtual void Skip(const unsigned char* data, uint32_t pos, unsigned int maxLength) = 0;
+    // move all positions 'delta' back, positions which end up before the data are dropped.
+    // delta has to be a multiple of DictionarySize()
+    virtual void Rebase(uint32_t delta) = 0;
+    virtual uint32_t DictionarySize() const = 0;
+
+    // matches will be in the range [minDistance,maxDistance]
+    static std::unique_ptr<IMatchFinder> Create(MatchFinderType type, unsigned int minDistance, unsigned int maxDistance);
+};
+
+class MatchFinderCommon : public IMatchFinder
+{
+public:
+    void Find(const unsigned char* data, uint32_t pos, unsigned int maxLength, Matches& matches) override;
+    void Skip(const unsigned char* data, uint32_t pos, unsigned int maxLength) override;
+    void Rebase(uint32_t delta) override;
+    uint32_t DictionarySize() const override { return m_maxMask + 1; }
+
+protected:
+    // the hash table has 1 << bits entries for a dictionary of 1 << bits positions, within these limits
+    static const unsigned int minHashBits = 16;
+    static const unsigned int maxHashBits = 22;
+    static const uint32_t empty = (uint32_t)-1;
+
+    MatchFinderCommon(unsigned int minDistance, unsigned int maxDistance, unsigned int depth);
+
+    // add position pos to the search structure
+    virtual void Add(const unsigned char* data, uint32_t pos, unsigned int maxLength) = 0;
+    // find matches for pos without changing the search structure
+    virtual void Search(const unsigned char* data, uint32_t pos, unsigned int maxLength, Matches& matches) const = 0;
+    // clear the tables, and size them for m_mask
+    virtual void Resize();
+    static void RebasePositions(std::vector<uint32_t>& positions, uint32_t delta);
+    // 'size' empty positions
+    static void Reset(std::vector<uint32_t>& positions, const size_t size);
+
+    // grow the tables so position pos fits, and add the positions before it again
+    void Grow(const unsigned char* data, uint32_t pos, unsigned int maxLength);
+    unsigned int Hash(const unsigned char* data) const;
+    // swap the head for the hash of the data at pos with pos, returns the previous head
+    uint32_t UpdateHead(const unsigned char* data, uint32_t pos);
+    size_t Slot(uint32_t pos) const { return pos & m_mask; }
+    bool InRange(uint32_t candidate, uint32_t pos) const { return candidate != empty && pos - candidate <= m_maxDistance; }
+
+    std::vector<uint32_t> m_head;
+    unsigned int m_hashBits;
+    // positions in the tables, and in the tables for the whole dictionary
+    uint32_t m_mask;
+    uint32_t m_maxMask;
+    unsigned int m_minDistance;
+    unsigned int m_maxDistance;
+    unsigned int m_depth;
+};
+
+class HashChainMatchFinder : public MatchFinderCommon
+{
+public:
+    HashChainMatchFinder(unsigned int minDistance, unsigned int maxDistance, unsigned int depth = 16);
+
+    void Rebase(uint32_t delta) override;
+
+protected:
+    void Add(const unsigned char* data, uint32_t pos, unsigned int maxLength) override;
+    void Search(const unsigned char* data, uint32_t pos, unsigned int maxLength, Matches& matches) const override;
+    void Resize() override;
+
+private:
+    std::vector<uint32_t> m_chain;
+};
+
+class BinaryTreeMatchFinder : public MatchFinderCommon
+{
+public:
+    BinaryTreeMatchFinder(unsigned int minDistance, unsigned int maxDistance, unsigned int depth = 64);
+
+    void Rebase(uint32_t delta) override;
+
+protected:
+    void Add(const unsigned char* data, uint32_t pos, unsigned int maxLength) override;
+    void Search(const unsigned char* data, uint32_t pos, unsigned int maxLength, Matches& matches) const override;
+    void Resize() override;
+
+private:
+    // two entries per position: positions with smaller/larger data
+    std::vector<uint32_t> m_tree;
+};
@@ -0,0 +1,138 @@
+#include <random>
+
+#include "CommonTestFunctionality.h"
+
+#include "MatchFinder.h"
+#include "Window.h"
+
+class MatchFinderTest : public testing::TestWithParam<MatchFinderType>
+{
+protected:
+    virtual void SetUp()
+    {
+    }
+
+    virtual void TearDown()
+    {
+    }
+
+    std::vector<unsigned char> GetInputData(const size_t size) const
+    {
+        // small alphabet with some repeated blocks, so there are plenty of matches of all lengths
+        std::mt19937 rng;
+        rng.seed(0);
+        std::uniform_int_distribution<unsigned int> value(0, 3);
+        std::uniform_int_distribution<unsigned int> copy(0, 20);
+        std::vector<unsigned char> res;
+        while (res.size() < size)
+        {
+            if (copy(rng) == 0 && res.size() > 1000)
+            {
+                const size_t begin = res.size() - 1000 + copy(rng) * 10;
+                for (size_t i = 0; i < 300; ++i)
+                {
+                    res.emplace_back(res[begin + i]);
+                }
+            }
+            else
+            {
+                res.emplace_back(static_cast<unsigned char>(value(rng)));
+            }
+        }
+        return res;
+    }
+};
+
+TEST_P(MatchFinderTest, MatchesAreValid)
+{
+    static const unsigned int minDistance = 6;
+    static const unsigned int maxDistance = 5000;
+    static const unsigned int maxLength = 261;
+    const auto input = GetInputData(100000);
+    auto finder = IMatchFinder::Create(GetParam(), minDistance, maxDistance);
+    Matches matches;
+    size_t found = 0;
+    for (uint64_t pos = 0; pos + IMatchFinder::minLength <= input.size(); ++pos)
+    {
+        const unsigned int length = static_cast<unsigned int>(std::min<uint64_t>(maxLength, input.size() - pos));
+        if (pos % 3 == 0)
+        {
+            finder->Skip(input.data(), pos, length);
+            continue;
+        }
+        matches.clear();
+        finder->Find(input.data(), pos, length, matches);
+        found += matches.size();
+        for (size_t i = 0; i < matches.size(); ++i)
+        {
+            const auto& match = matches[i];
+            ASSERT_GE(match.distance, minDistance);
+            ASSERT_LE(match.distance, maxDistance);
+            ASSERT_LE(match.distance, pos);
+            ASSERT_GE(match.length, IMatchFinder::minLength);
+            ASSERT_LE(match.length, length);
+            ASSERT_TRUE(std::equal(input.begin() + pos, input.begin() + pos + match.length, input.begin() + pos - match.distance));
+            if (i > 0)
+            {
+                ASSERT_GT(match.length, matches[i - 1].length);
+                ASSERT_GT(match.distance, matches[i - 1].distance);
+            }
+        }
+    }
+    EXPECT_LT(input.size(), found);
+}
+
+TEST_P(MatchFinderTest, GrowsWithData)
+{
+    // the tables start smaller than the distance, positions from before a growth are still found
+    std::mt19937 rng;
+    rng.seed(0);
+    std::vector<unsigned char> input(300000);
+    for (auto& c : input)
+    {
+        c = static_cast<unsigned char>(rng());
+    }
+    std::copy(input.begin() + 10000, input.begin() + 10100, input.begin() + 250000);
+    auto finder = IMatchFinder::Create(GetParam(), 6, 1 << 20);
+    Matches matches;
+    for (uint32_t pos = 0; pos < 250000; ++pos)
+    {
+        finder->Skip(input.data(), pos, 100);
+    }
+    finder->Find(input.data(), 250000, 100, matches);
+    ASSERT_FALSE(matches.empty());
+    EXPECT_EQ(100u, matches.back().length);
+    EXPECT_EQ(240000u, matches.back().distance);
+}
+
+TEST_P(MatchFinderTest, WindowRoundTrip)
+{
+#ifdef _DEBUG
+    const auto input = GetInputData(1000000);
+#else
+    // long enough to slide the window
+    const auto input = GetInputData(12000000);
+#endif
+    WindowCompressor compressor(GetParam());
+    WindowDeCompressor deCompressor;
+    std::vector<unsigned char> compressed;
+    std::vector<unsigned char> buffer;
+    // feed the data in uneven chunks
+    for (size_t begin = 0; begin < input.size(); begin += 123457)
+    {
+        buffer.assign(input.begin() + begin, input.begin() + std::min(input.size(), begin + 123457));
+        compressor.Compress(buffer);
+        compressed.insert(compressed.end(), buffer.begin(), buffer.end());
+    }
+    buffer.clear();
+    compressor.Finish(buffer);
+    compressed.insert(compressed.end(), buffer.begin(), buffer.end());
+    EXPECT_GT(input.size() / 2, compressed.size());
+    deCompressor.Finish(compressed);
+    ASSERT_EQ(input, compressed);
+}
+
+INSTANTIATE_TEST_CASE_P(MatchFinders, MatchFinderTest,
+    testing::Values(
+        MatchFinderType::HashChain,
+        MatchFinderType::BinaryTree));
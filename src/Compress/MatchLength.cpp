@@ -0,0 +1,192 @@
+#include <cassert>
+#include <cstring>
+
+#include "MatchLength.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define MATCHLENGTH_X86
+#include <immintrin.h>
+#endif
+
+// gcc and clang only generate avx2 code for functions which ask for it
+#if defined(MATCHLENGTH_X86) && (defined(__GNUC__) || defined(__clang__))
+#define MATCHLENGTH_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define MATCHLENGTH_TARGET_AVX2
+#endif
+
+namespace
+{
+    unsigned int TrailingZeros(uint64_t value)
+    {
+        assert(value != 0);
+#if defined(_MSC_VER) && defined(_M_X64)
+        unsigned long index;
+        _BitScanForward64(&index, value);
+        return index;
+#elif defined(_MSC_VER)
+        unsigned long index;
+        if (_BitScanForward(&index, static_cast<uint32_t>(value)))
+        {
+            return index;
+        }
+        _BitScanForward(&index, static_cast<uint32_t>(value >> 32));
+        return 32 + index;
+#else
+        return __builtin_ctzll(value);
+#endif
+    }
+
+    // the first differing byte, for two 8 byte words loaded from memory which differ
+    unsigned int FirstDifference(uint64_t a, uint64_t b)
+    {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        return __builtin_clzll(a ^ b) / 8;
+#else
+        return TrailingZeros(a ^ b) / 8;
+#endif
+    }
+
+    uint64_t Load64(const unsigned char* data)
+    {
+        uint64_t value;
+        memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    unsigned int ExtendBytes(const unsigned char* a, const unsigned char* b, unsigned int length, const unsigned int maxLength)
+    {
+        while (length < maxLength && a[length] == b[length])
+        {
+            ++length;
+        }
+        return length;
+    }
+
+    unsigned int ExtendWord(const unsigned char* a, const unsigned char* b, unsigned int length, const unsigned int maxLength)
+    {
+        while (length + 8 <= maxLength)
+        {
+            const uint64_t x = Load64(a + length);
+            const uint64_t y = Load64(b + length);
+            if (x != y)
+            {
+                return length + FirstDifference(x, y);
+            }
+            length += 8;
+        }
+        return ExtendBytes(a, b, length, maxLength);
+    }
+
+#ifdef MATCHLENGTH_X86
+    unsigned int ExtendSSE2(const unsigned char* a, const unsigned char* b, unsigned int length, const unsigned int maxLength)
+    {
+        while (length + 16 <= maxLength)
+        {
+            const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + length));
+            const __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + length));
+            const unsigned int equal = static_cast<unsigned int>(_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)));
+            if (equal != 0xFFFF)
+            {
+                return length + TrailingZeros(~equal & 0xFFFF);
+            }
+            length += 16;
+        }
+        return ExtendWord(a, b, length, maxLength);
+    }
+
+    MATCHLENGTH_TARGET_AVX2
+    unsigned int ExtendAVX2(const unsigned char* a, const unsigned char* b, unsigned int length, const unsigned int maxLength)
+    {
+        while (length + 32 <= maxLength)
+        {
+            const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + length));
+            const __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + length));
+            const uint32_t equal = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)));
+            if (equal != 0xFFFFFFFF)
+            {
+                return length + TrailingZeros(~equal);
+            }
+            length += 32;
+        }
+        return ExtendSSE2(a, b, length, maxLength);
+    }
+
+    bool HasAVX2()
+    {
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+        {
+            return false;
+        }
+        __cpuid(info, 1);
+        // osxsave and avx, and the os saves the ymm registers
+        const bool osxsave = (info[2] & (1 << 27)) != 0;
+        const bool avx = (info[2] & (1 << 28)) != 0;
+        if (!osxsave || !avx || (_xgetbv(0) & 6) != 6)
+        {
+            return false;
+        }
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") != 0;
+#endif
+    }
+#endif
+}
+
+std::atomic<MatchLength::ExtendFunction> MatchLength::m_extend(&MatchLength::ExtendFirst);
+
+unsigned int MatchLength::ExtendFirst(const unsigned char* a, const unsigned char* b, unsigned int length, const unsigned int maxLength)
+{
+    // every thread selects the same implementation, unless Select() came first
+    ExtendFunction first = &ExtendFirst;
+    m_extend.compare_exchange_strong(first, Get(Best()), std::memory_order_relaxed);
+    return m_extend.load(std::memory_order_relaxed)(a, b, length, maxLength);
+}
+
+MatchLength::Implementation MatchLength::Best()
+{
+#ifdef MATCHLENGTH_X86
+    static const bool avx2 = HasAVX2();
+    return avx2 ? Implementation::AVX2 : Implementation::SSE2;
+#else
+    return Implementation::Word;
+#endif
+}
+
+bool MatchLength::Supported(Implementation implementation)
+{
+    return implementation <= Best();
+}
+
+void MatchLength::Select(Implementation implementation)
+{
+    assert(Supported(implementation));
+    m_extend.store(Get(implementation), std::memory_order_relaxed);
+}
+
+MatchLength::ExtendFunction MatchLength::Get(Implementation implementation)
+{
+    switch (implementation)
+    {
+    case Implementation::Bytes:
+        return ExtendBytes;
+    default:
+    case Implementation::Word:
+        return ExtendWord;
+#ifdef MATCHLENGTH_X86
+    case Implementation::SSE2:
+        return ExtendSSE2;
+    case Implementation::AVX2:
+        return ExtendAVX2;
+#endif
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <inttypes.h>
+
+// length of the common prefix of two byte sequences, for LZ style match finders.
+// compares a word or vector register at a time, the widest variant the cpu supports is
+// selected on first use.
+//   Bytes : one byte at a time, reference implementation
+//   Word  : 8 bytes at a time, xor + count trailing zeros
+//   SSE2  : 16 bytes at a time, compare + movemask
+//   AVX2  : 32 bytes at a time, compare + movemask
+
+class MatchLength
+{
+public:
+    enum class Implementation
+    {
+        Bytes,
+        Word,
+        SSE2,
+        AVX2
+    };
+
+    // returns the first position in [length,maxLength) where a and b differ, or maxLength.
+    // the first 'length' bytes are known to be equal. no bytes beyond maxLength are read.
+    static unsigned int Extend(const unsigned char* a, const unsigned char* b, unsigned int length, const unsigned int maxLength)
+    {
+        return m_extend.load(std::memory_order_relaxed)(a, b, length, maxLength);
+    }
+
+    // the fastest implementation available on this cpu
+    static Implementation Best();
+    static bool Supported(Implementation implementation);
+    // use a specific implementation (tests and benchmarks), it has to be supported
+    static void Select(Implementation implementation);
+
+private:
+    typedef unsigned int (*ExtendFunction)(const unsigned char*, const unsigned char*, unsigned int, unsigned int);
+
+    static ExtendFunction Get(Implementation implementation);
+    // selects Best() on the first call and continues with it
+    static unsigned int ExtendFirst(const unsigned char* a, const unsigned char* b, unsigned int length, const unsigned int maxLength);
+
+    // constant initialized, so it can be used from other static initializers
+    static std::atomic<ExtendFunction> m_extend;
+};
@@ -0,0 +1,90 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "CommonTestFunctionality.h"
+
+#include "MatchLength.h"
+
+class MatchLengthTest : public testing::TestWithParam<MatchLength::Implementation>
+{
+protected:
+    virtual void SetUp()
+    {
+        if (MatchLength::Supported(GetParam()))
+        {
+            MatchLength::Select(GetParam());
+        }
+    }
+
+    virtual void TearDown()
+    {
+        MatchLength::Select(MatchLength::Best());
+    }
+};
+
+TEST_P(MatchLengthTest, EveryPosition)
+{
+    if (!MatchLength::Supported(GetParam()))
+    {
+        return;
+    }
+    // put a single difference at every position, and try every start and end around it
+    static const unsigned int size = 100;
+    std::vector<unsigned char> a(size, 7);
+    std::vector<unsigned char> b(size, 7);
+    for (unsigned int difference = 0; difference <= size; ++difference)
+    {
+        if (difference < size)
+        {
+            b[difference] = 8;
+        }
+        for (unsigned int maxLength = 0; maxLength <= size; ++maxLength)
+        {
+            for (unsigned int length = 0; length <= std::min(maxLength, difference); ++length)
+            {
+                ASSERT_EQ(std::min(difference, maxLength), MatchLength::Extend(a.data(), b.data(), length, maxLength));
+            }
+        }
+        if (difference < size)
+        {
+            b[difference] = 7;
+        }
+    }
+}
+
+TEST_P(MatchLengthTest, Random)
+{
+    if (!MatchLength::Supported(GetParam()))
+    {
+        return;
+    }
+    std::mt19937 rng;
+    rng.seed(0);
+    std::uniform_int_distribution<unsigned int> value(0, 255);
+    std::uniform_int_distribution<unsigned int> position(0, 300);
+    std::vector<unsigned char> a(300);
+    for (auto& c : a)
+    {
+        c = static_cast<unsigned char>(value(rng));
+    }
+    for (int i = 0; i < 10000; ++i)
+    {
+        std::vector<unsigned char> b = a;
+        const unsigned int difference = position(rng);
+        if (difference < b.size())
+        {
+            b[difference] ^= 1 + value(rng) % 255;
+        }
+        const unsigned int maxLength = position(rng);
+        const unsigned int expected = std::min(difference, maxLength);
+        ASSERT_EQ(expected, MatchLength::Extend(a.data(), b.data(), 0, maxLength));
+    }
+}
+
+INSTANTIATE_TEST_CASE_P(Implementations, MatchLengthTest,
+    testing::Values(
+        MatchLength::Implementation::Bytes,
+        MatchLength::Implementation::Word,
+        MatchLength::Implementation::SSE2,
+        MatchLength::Implementation::AVX2));
@@ -0,0 +1,195 @@
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include <string>
+
+#include "Parallel.h"
+
+ParallelCommon::ParallelCommon(const CompressionAlgo algo, const unsigned int threadCount)
+    : m_algo(algo)
+    , m_pool(threadCount)
+{
+}
+
+void ParallelCommon::WriteNumber(std::vector<unsigned char>& buffer, const uint32_t value)
+{
+    for (unsigned int i = 0; i < 4; ++i)
+    {
+        buffer.emplace_back(static_cast<unsigned char>(value >> (8 * i)));
+    }
+}
+
+uint32_t ParallelCommon::ReadNumber(const unsigned char* data)
+{
+    return data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<uint32_t>(data[3]) << 24);
+}
+
+
+
+ParallelCompressor::ParallelCompressor(const CompressionAlgo algo, const size_t blockSize, const unsigned int threadCount)
+    : ParallelCommon(algo, threadCount)
+    , m_blockSize(blockSize)
+    , m_level(CompressionLevel::Normal)
+    , m_inBuffer()
+{
+    if (blockSize == 0 || blockSize > 0xFFFFFFFFu)
+    {
+        throw std::runtime_error("Invalid block size");
+    }
+}
+
+void ParallelCompressor::SetLevel(CompressionLevel level)
+{
+    m_level = level;
+}
+
+void ParallelCompressor::CompressBatch(const size_t size, std::vector<unsigned char>& output)
+{
+    assert(size <= m_inBuffer.size());
+    const size_t count = (size + m_blockSize - 1) / m_blockSize;
+    std::vector<std::vector<unsigned char>> blocks(count);
+    m_pool.ParallelFor(count, [this, size, &blocks](const size_t index)
+    {
+        const size_t begin = index * m_blockSize;
+        const size_t end = std::min(size, begin + m_blockSize);
+        auto& block = blocks[index];
+        block.assign(m_inBuffer.begin() + begin, m_inBuffer.begin() + end);
+        auto compressor = CompressorFactory::Create(m_algo, m_level);
+        compressor->Finish(block);
+        if (block.size() > 0xFFFFFFFFu)
+        {
+            throw std::runtime_error("Block too large");
+        }
+    });
+    WriteNumber(output, static_cast<uint32_t>(count));
+    for (size_t index = 0; index < count; ++index)
+    {
+        const size_t begin = index * m_blockSize;
+        WriteNumber(output, static_cast<uint32_t>(std::min(m_blockSize, size - begin)));
+        WriteNumber(output, static_cast<uint32_t>(blocks[index].size()));
+    }
+    for (const auto& block : blocks)
+    {
+        output.insert(output.end(), block.begin(), block.end());
+    }
+    m_inBuffer.erase(m_inBuffer.begin(), m_inBuffer.begin() + size);
+}
+
+void ParallelCompressor::Compress(std::vector<unsigned char>& ioBuffer)
+{
+    m_inBuffer.insert(m_inBuffer.end(), ioBuffer.begin(), ioBuffer.end());
+    ioBuffer.clear();
+    // wait until all threads get a block
+    const size_t blocks = m_inBuffer.size() / m_blockSize;
+    if (blocks >= m_pool.ThreadCount())
+    {
+        CompressBatch(blocks * m_blockSize, ioBuffer);
+    }
+}
+
+void ParallelCompressor::Finish(std::vector<unsigned char>& ioBuffer)
+{
+    Compress(ioBuffer);
+    if (!m_inBuffer.empty())
+    {
+        CompressBatch(m_inBuffer.size(), ioBuffer);
+    }
+    WriteNumber(ioBuffer, 0);
+}
+
+
+
+ParallelDeCompressor::ParallelDeCompressor(const CompressionAlgo algo, const unsigned int threadCount)
+    : ParallelCommon(algo, threadCount)
+    , m_inBuffer()
+    , m_position(0)
+    , m_eof(false)
+{
+}
+
+bool ParallelDeCompressor::DeCompressBatch(std::vector<unsigned char>& output)
+{
+    const unsigned char* data = m_inBuffer.data() + m_position;
+    const size_t size = m_inBuffer.size() - m_position;
+    if (size < 4)
+    {
+        return false;
+    }
+    const size_t count = ReadNumber(data);
+    if (count == 0)
+    {
+        m_position += 4;
+        m_eof = true;
+        return true;
+    }
+    const size_t header = 4 + 8 * count;
+    if (size < header)
+    {
+        return false;
+    }
+    // offsets of the compressed blocks
+    std::vector<size_t> inOffsets(count + 1, header);
+    for (size_t index = 0; index < count; ++index)
+    {
+        inOffsets[index + 1] = inOffsets[index] + ReadNumber(data + 8 + 8 * index);
+    }
+    if (size < inOffsets[count])
+    {
+        return false;
+    }
+    // the sizes in the index are only compared with the decompressed blocks, memory is never
+    // allocated for them up front
+    std::vector<std::vector<unsigned char>> blocks(count);
+    m_pool.ParallelFor(count, [this, data, &inOffsets, &blocks](const size_t index)
+    {
+        auto& block = blocks[index];
+        block.assign(data + inOffsets[index], data + inOffsets[index + 1]);
+        auto deCompressor = DeCompressorFactory::Create(m_algo);
+        deCompressor->Finish(block);
+        if (block.size() != ReadNumber(data + 4 + 8 * index))
+        {
+            throw std::runtime_error("Invalid data");
+        }
+    });
+    size_t total = output.size();
+    for (const auto& block : blocks)
+    {
+        total += block.size();
+    }
+    output.reserve(total);
+    for (auto& block : blocks)
+    {
+        output.insert(output.end(), block.begin(), block.end());
+        std::vector<unsigned char>().swap(block);
+    }
+    m_position += inOffsets[count];
+    return true;
+}
+
+void ParallelDeCompressor::DeCompress(std::vector<unsigned char>& ioBuffer)
+{
+    if (m_eof && !ioBuffer.empty())
+    {
+        throw std::runtime_error("Data after end");
+    }
+    m_inBuffer.insert(m_inBuffer.end(), ioBuffer.begin(), ioBuffer.end());
+    ioBuffer.clear();
+    while (!m_eof && DeCompressBatch(ioBuffer))
+    {
+    }
+    if (m_eof && m_position != m_inBuffer.size())
+    {
+        throw std::runtime_error("Data after end");
+    }
+    m_inBuffer.erase(m_inBuffer.begin(), m_inBuffer.begin() + m_position);
+    m_position = 0;
+}
+
+void ParallelDeCompressor::Finish(std::vector<unsigned char>& ioBuffer)
+{
+    DeCompress(ioBuffer);
+    if (!m_eof)
+    {
+        throw std::runtime_error("Incomplete data");
+    }
+}
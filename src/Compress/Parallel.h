@@ -0,0 +1,70 @@
+#pragma once
+
+#include "SpanCodec.h"
+#include "ThreadPool.h"
+
+// split the data in independent blocks, which are compressed with any CompressionAlgo on a pool of
+// threads. the decompressor decodes the blocks of a batch at the same time.
+//
+// byte stream format (numbers are 32 bit, lsb first):
+//   - repeat for each batch of blocks:
+//     - count
+//     - block index: size, compressed size, for each block
+//     - the compressed blocks
+//   - end: a batch with count 0
+//
+// all blocks have 'blockSize' bytes, except the last one. a batch is written as soon as there is a
+// block for each thread, or when the stream is finished.
+
+class ParallelCommon
+{
+public:
+    static const size_t defaultBlockSize = 1 << 20;
+
+protected:
+    ParallelCommon(const CompressionAlgo algo, const unsigned int threadCount);
+
+    static void WriteNumber(std::vector<unsigned char>& buffer, const uint32_t value);
+    static uint32_t ReadNumber(const unsigned char* data);
+
+    CompressionAlgo m_algo;
+    ThreadPool m_pool;
+};
+
+class ParallelCompressor : public VectorCompressor, public ParallelCommon
+{
+public:
+    // threadCount 0 uses one thread per core
+    explicit ParallelCompressor(const CompressionAlgo algo, const size_t blockSize = defaultBlockSize, const unsigned int threadCount = 0);
+
+    void SetLevel(CompressionLevel level) override;
+    void Compress(std::vector<unsigned char>& ioBuffer) override;
+    void Finish(std::vector<unsigned char>& ioBuffer) override;
+
+private:
+    // compress the first 'size' bytes of m_inBuffer as a batch
+    void CompressBatch(const size_t size, std::vector<unsigned char>& output);
+
+    size_t m_blockSize;
+    CompressionLevel m_level;
+    std::vector<unsigned char> m_inBuffer;
+};
+
+class ParallelDeCompressor : public VectorDeCompressor, public ParallelCommon
+{
+public:
+    // threadCount 0 uses one thread per core
+    explicit ParallelDeCompressor(const CompressionAlgo algo, const unsigned int threadCount = 0);
+
+    void DeCompress(std::vector<unsigned char>& ioBuffer) override;
+    void Finish(std::vector<unsigned char>& ioBuffer) override;
+
+private:
+    // returns false when the batch isn't complete yet
+    bool DeCompressBatch(std::vector<unsigned char>& output);
+
+    std::vector<unsigned char> m_inBuffer;
+    // bytes used from the start of m_inBuffer
+    size_t m_position;
+    bool m_eof;
+};
@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "CommonTestFunctionality.h"
+
+#include "Parallel.h"
+
+class ParallelTest : public Test
+{
+protected:
+    virtual void SetUp()
+    {
+    }
+
+    virtual void TearDown()
+    {
+    }
+
+    static std::vector<unsigned char> GetInput(const size_t size)
+    {
+        std::mt19937 rng;
+        rng.seed(0);
+        std::vector<unsigned char> res;
+        while (res.size() < size)
+        {
+            const unsigned char value = static_cast<unsigned char>(rng() % 20);
+            res.insert(res.end(), 1 + rng() % 10, value);
+        }
+        res.resize(size);
+        return res;
+    }
+};
+
+TEST_F(ParallelTest, ThreadPool)
+{
+    ThreadPool pool(4);
+    EXPECT_EQ(4u, pool.ThreadCount());
+    std::vector<size_t> results(1000);
+    pool.ParallelFor(results.size(), [&results](const size_t index) { results[index] = index * index; });
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        ASSERT_EQ(i * i, results[i]);
+    }
+    EXPECT_EQ(42, pool.Submit([]() { return 42; }).get());
+
+    std::atomic<size_t> calls(0);
+    EXPECT_THROW(pool.ParallelFor(100, [&calls](const size_t index)
+    {
+        ++calls;
+        if (index == 10)
+        {
+            throw std::runtime_error("test");
+        }
+    }), std::runtime_error);
+    EXPECT_EQ(100u, calls.load());
+}
+
+TEST_F(ParallelTest, Algorithms)
+{
+    const auto input = GetInput(300000);
+    for (auto ca : { CompressionAlgo::StaticHuffman, CompressionAlgo::Window_DynamicHuffman, CompressionAlgo::StaticHuffman4 })
+    {
+        for (size_t size : { size_t(0), size_t(1), size_t(65536), input.size() })
+        {
+            ParallelCompressor compressor(ca, 65536, 4);
+            ParallelDeCompressor deCompressor(ca, 4);
+            std::vector<unsigned char> data(input.begin(), input.begin() + size);
+            compressor.Finish(data);
+            deCompressor.Finish(data);
+            ASSERT_EQ(std::vector<unsigned char>(input.begin(), input.begin() + size), data) << "Size: " << size;
+        }
+    }
+}
+
+TEST_F(ParallelTest, Chunks)
+{
+    const auto input = GetInput(1000000);
+    ParallelCompressor compressor(CompressionAlgo::RLE_StaticHuffman, 10000, 3);
+    ParallelDeCompressor deCompressor(CompressionAlgo::RLE_StaticHuffman, 2);
+    std::vector<unsigned char> compressed;
+    for (size_t offset = 0; offset < input.size(); offset += 12345)
+    {
+        std::vector<unsigned char> chunk(input.begin() + offset, input.begin() + std::min(input.size(), offset + 12345));
+        compressor.Compress(chunk);
+        compressed.insert(compressed.end(), chunk.begin(), chunk.end());
+    }
+    std::vector<unsigned char> chunk;
+    compressor.Finish(chunk);
+    compressed.insert(compressed.end(), chunk.begin(), chunk.end());
+
+    std::vector<unsigned char> deCompressed;
+    for (size_t offset = 0; offset < compressed.size(); offset += 777)
+    {
+        chunk.assign(compressed.begin() + offset, compressed.begin() + std::min(compressed.size(), offset + 777));
+        deCompressor.DeCompress(chunk);
+        deCompressed.insert(deCompressed.end(), chunk.begin(), chunk.end());
+    }
+    chunk.clear();
+    deCompressor.Finish(chunk);
+    deCompressed.insert(deCompressed.end(), chunk.begin(), chunk.end());
+    ASSERT_EQ(input, deCompressed);
+}
+
+TEST_F(ParallelTest, InvalidData)
+{
+    auto data = GetInput(100000);
+    ParallelCompressor compressor(CompressionAlgo::StaticHuffman, 10000, 2);
+    compressor.Finish(data);
+    {
+        // the size of the first block is wrong
+        auto invalid = data;
+        invalid[4] ^= 1;
+        ParallelDeCompressor deCompressor(CompressionAlgo::StaticHuffman, 2);
+        EXPECT_THROW(deCompressor.Finish(invalid), std::runtime_error);
+    }
+    {
+        auto incomplete = data;
+        incomplete.pop_back();
+        ParallelDeCompressor deCompressor(CompressionAlgo::StaticHuffman, 2);
+        EXPECT_THROW(deCompressor.Finish(incomplete), std::runtime_error);
+    }
+    {
+        // a block claims 4 GiB, which is only found out by decompressing it
+        auto huge = data;
+        std::fill(huge.begin() + 4, huge.begin() + 8, static_cast<unsigned char>(0xFF));
+        ParallelDeCompressor deCompressor(CompressionAlgo::StaticHuffman, 2);
+        try
+        {
+            deCompressor.Finish(huge);
+            ADD_FAILURE() << "no exception";
+        }
+        catch (const std::runtime_error& e)
+        {
+            EXPECT_STREQ("Invalid data", e.what());
+        }
+    }
+}
@@ -1,17 +1,19 @@
 #include "PassThrough.h"
 
-void PassThroughCompressor::Compress(std::vector<unsigned char>&)
+void PassThroughCompressor::CompressBytes(const unsigned char* data, const size_t size, ByteOutput& output)
 {
+    output.Put(data, size);
 }
 
-void PassThroughCompressor::Finish(std::vector<unsigned char>&)
+void PassThroughCompressor::FinishBytes(ByteOutput&)
 {
 }
 
-void PassThroughDeCompressor::DeCompress(std::vector<unsigned char>&)
+void PassThroughDeCompressor::DeCompressBytes(const unsigned char* data, const size_t size, ByteOutput& output)
 {
+    output.Put(data, size);
 }
 
-void PassThroughDeCompressor::Finish(std::vector<unsigned char>&)
+void PassThroughDeCompressor::FinishBytes(ByteOutput&)
 {
 }
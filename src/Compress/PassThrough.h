@@ -1,23 +1,21 @@
 #pragma once
 
-#include "ICompress.h"
+#include "SpanCodec.h"
 
 // byte stream format:
 //   value -> value
 
-class PassThroughCompressor : public ICompressor
+class PassThroughCompressor : public SpanCompressor
 {
 public:
-    void Compress(std::vector<unsigned char>& ioBuffer) override;
-    void Finish(std::vector<unsigned char>& ioBuffer) override;
-private:
+    void CompressBytes(const unsigned char* data, const size_t size, ByteOutput& output) override;
+    void FinishBytes(ByteOutput& output) override;
 };
 
-class PassThroughDeCompressor : public IDeCompressor
+class PassThroughDeCompressor : public SpanDeCompressor
 {
 public:
-    void DeCompress(std::vector<unsigned char>& ioBuffer) override;
-    void Finish(std::vector<unsigned char>& ioBuffer) override;
-private:
+    void DeCompressBytes(const unsigned char* data, const size_t size, ByteOutput& output) override;
+    void FinishBytes(ByteOutput& output) override;
 };
 
@@ -1,10 +1,17 @@
 ﻿#pragma once
 
+#include <algorithm>
+#include <array>
 #include <tuple>
 
-#include "ICompress.h"
+#include "SpanCodec.h"
 
 // pipeline several compressors
+//
+// the stages are fused: the input is cut in chunks of 'chunkSize' bytes, and each chunk is passed
+// through all stages before the next one is read. the output of a stage is kept in a small buffer,
+// which stays in the cache. the stages are called directly, not through the virtual interface.
+// compressors run from the last type to the first one, decompressors from the first to the last.
 
 template<class... Objects>
 class PipeLineCommon
@@ -40,6 +47,20 @@ private:
         ApplyImplementation(func, std::get<I>(objects) ...);
     }
 protected:
+    static const size_t chunkSize = 1 << 16;
+    static const size_t count = sizeof...(Objects);
+
+    template<size_t I>
+    using Object = typename std::tuple_element<I, std::tuple<Objects...>>::type;
+    template<size_t I>
+    using Stage = std::integral_constant<size_t, I>;
+
+    template<size_t I>
+    Object<I>& Get()
+    {
+        return std::get<I>(m_objects);
+    }
+
     template<typename Func>
     void Apply(Func&& func, const bool reverse)
     {
@@ -54,31 +75,136 @@ protected:
     }
 };
 
+template<class... Objects>
+const size_t PipeLineCommon<Objects...>::chunkSize;
+
 template<class... Compressors>
-class PipeLineCompressor : public ICompressor, PipeLineCommon<Compressors...>
+class PipeLineCompressor : public SpanCompressor, PipeLineCommon<Compressors...>
 {
+private:
+    using Common = PipeLineCommon<Compressors...>;
+    // stage S runs compressor count - 1 - S
+    template<size_t S>
+    using Compressor = typename Common::template Object<Common::count - 1 - S>;
+    template<size_t S>
+    using Stage = typename Common::template Stage<S>;
+
 public:
-    void Compress(std::vector<unsigned char>& ioBuffer) override
+    void SetLevel(CompressionLevel level) override
+    {
+        this->Apply([level](ICompressor& compressor) {compressor.SetLevel(level); }, true);
+    }
+    void CompressBytes(const unsigned char* data, const size_t size, ByteOutput& output) override
+    {
+        for (size_t offset = 0; offset < size; offset += Common::chunkSize)
+        {
+            CompressStage(Stage<0>(), data + offset, std::min(Common::chunkSize, size - offset), output);
+        }
+    }
+    void FinishBytes(ByteOutput& output) override
+    {
+        FinishStage(Stage<0>(), output);
+    }
+
+private:
+    template<size_t S>
+    void CompressStage(Stage<S>, const unsigned char* data, const size_t size, ByteOutput& output)
+    {
+        using Type = Compressor<S>;
+        auto& buffer = m_buffers[S];
+        buffer.clear();
+        m_bufferOutput.Begin(buffer);
+        this->template Get<Common::count - 1 - S>().Type::CompressBytes(data, size, m_bufferOutput);
+        m_bufferOutput.End();
+        CompressStage(Stage<S + 1>(), buffer.data(), buffer.size(), output);
+    }
+    void CompressStage(Stage<Common::count - 1>, const unsigned char* data, const size_t size, ByteOutput& output)
+    {
+        using Type = Compressor<Common::count - 1>;
+        this->template Get<0>().Type::CompressBytes(data, size, output);
+    }
+    // the data a stage writes on finish goes through the stages after it, before they finish
+    template<size_t S>
+    void FinishStage(Stage<S>, ByteOutput& output)
     {
-        this->Apply([&ioBuffer](ICompressor& compressor) {compressor.Compress(ioBuffer); }, true);
+        using Type = Compressor<S>;
+        auto& buffer = m_buffers[S];
+        buffer.clear();
+        m_bufferOutput.Begin(buffer);
+        this->template Get<Common::count - 1 - S>().Type::FinishBytes(m_bufferOutput);
+        m_bufferOutput.End();
+        CompressStage(Stage<S + 1>(), buffer.data(), buffer.size(), output);
+        FinishStage(Stage<S + 1>(), output);
     }
-    void Finish(std::vector<unsigned char>& ioBuffer) override
+    void FinishStage(Stage<Common::count - 1>, ByteOutput& output)
     {
-        this->Apply([&ioBuffer](ICompressor& compressor) {compressor.Finish(ioBuffer); }, true);
+        using Type = Compressor<Common::count - 1>;
+        this->template Get<0>().Type::FinishBytes(output);
     }
+
+    // output of each stage but the last
+    std::array<std::vector<unsigned char>, Common::count - 1> m_buffers;
+    ByteOutput m_bufferOutput;
 };
 
 template<class... DeCompressors>
-class PipeLineDeCompressor : public IDeCompressor, PipeLineCommon<DeCompressors...>
+class PipeLineDeCompressor : public SpanDeCompressor, PipeLineCommon<DeCompressors...>
 {
+private:
+    using Common = PipeLineCommon<DeCompressors...>;
+    template<size_t S>
+    using DeCompressor = typename Common::template Object<S>;
+    template<size_t S>
+    using Stage = typename Common::template Stage<S>;
+
 public:
-    void DeCompress(std::vector<unsigned char>& ioBuffer) override
+    void DeCompressBytes(const unsigned char* data, const size_t size, ByteOutput& output) override
     {
-        this->Apply([&ioBuffer](IDeCompressor& decompressor) {decompressor.DeCompress(ioBuffer); }, false);
+        for (size_t offset = 0; offset < size; offset += Common::chunkSize)
+        {
+            DeCompressStage(Stage<0>(), data + offset, std::min(Common::chunkSize, size - offset), output);
+        }
     }
-    void Finish(std::vector<unsigned char>& ioBuffer) override
+    void FinishBytes(ByteOutput& output) override
     {
-        this->Apply([&ioBuffer](IDeCompressor& decompressor) {decompressor.Finish(ioBuffer); }, false);
+        FinishStage(Stage<0>(), output);
+    }
+
+private:
+    template<size_t S>
+    void DeCompressStage(Stage<S>, const unsigned char* data, const size_t size, ByteOutput& output)
+    {
+        using Type = DeCompressor<S>;
+        auto& buffer = m_buffers[S];
+        buffer.clear();
+        m_bufferOutput.Begin(buffer);
+        this->template Get<S>().Type::DeCompressBytes(data, size, m_bufferOutput);
+        m_bufferOutput.End();
+        DeCompressStage(Stage<S + 1>(), buffer.data(), buffer.size(), output);
+    }
+    void DeCompressStage(Stage<Common::count - 1>, const unsigned char* data, const size_t size, ByteOutput& output)
+    {
+        using Type = DeCompressor<Common::count - 1>;
+        this->template Get<Common::count - 1>().Type::DeCompressBytes(data, size, output);
+    }
+    template<size_t S>
+    void FinishStage(Stage<S>, ByteOutput& output)
+    {
+        using Type = DeCompressor<S>;
+        auto& buffer = m_buffers[S];
+        buffer.clear();
+        m_bufferOutput.Begin(buffer);
+        this->template Get<S>().Type::FinishBytes(m_bufferOutput);
+        m_bufferOutput.End();
+        DeCompressStage(Stage<S + 1>(), buffer.data(), buffer.size(), output);
+        FinishStage(Stage<S + 1>(), output);
+    }
+    void FinishStage(Stage<Common::count - 1>, ByteOutput& output)
+    {
+        using Type = DeCompressor<Common::count - 1>;
+        this->template Get<Common::count - 1>().Type::FinishBytes(output);
     }
-};
 
+    std::array<std::vector<unsigned char>, Common::count - 1> m_buffers;
+    ByteOutput m_bufferOutput;
+};
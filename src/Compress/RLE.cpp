@@ -1,12 +1,13 @@
 #include <algorithm>
-#include <cassert>
+#include <cstring>
 #include <stdexcept>
 
 #include "RLE.h"
+#include "RLEScan.h"
 
 const unsigned char RLECommon::m_escape = 255;
  
-void RLECompressor::DumpCurrent(std::vector<unsigned char>& buffer)
+void RLECompressor::DumpCurrent(ByteOutput& output)
 {
     while (m_count > 0)
     {
@@ -18,8 +19,8 @@ void RLECompressor::DumpCurrent(std::vector<unsigned char>& buffer)
                 {
                     for (decltype(m_count) i = 0; i < m_count; ++i)
                     {
-                        buffer.emplace_back(m_escape);
-                        buffer.emplace_back(m_current);
+                        output.Put(m_escape);
+                        output.Put(m_current);
                     }
                     m_count = 0;
                     return;
@@ -27,8 +28,8 @@ void RLECompressor::DumpCurrent(std::vector<unsigned char>& buffer)
             }
             else
             {
-                buffer.emplace_back(m_current);
-                buffer.emplace_back(m_current);
+                output.Put(m_current);
+                output.Put(m_current);
                 m_count = 0;
                 return;
             }
@@ -37,9 +38,9 @@ void RLECompressor::DumpCurrent(std::vector<unsigned char>& buffer)
         {
             if (m_escape == m_current)
             {
-                buffer.emplace_back(m_current);
+                output.Put(m_current);
             }
-            buffer.emplace_back(m_current);
+            output.Put(m_current);
             m_count = 0;
             return;
         }
@@ -48,64 +49,58 @@ void RLECompressor::DumpCurrent(std::vector<unsigned char>& buffer)
         {
             --run;
         }
-        buffer.emplace_back(m_escape);
-        buffer.emplace_back(run);
-        buffer.emplace_back(m_current);
+        output.Put(m_escape);
+        output.Put(run);
+        output.Put(m_current);
         m_count -= run;
     }
 }
 
-void RLECompressor::Compress(std::vector<unsigned char>& buffer)
+void RLECompressor::CompressBytes(const unsigned char* data, const size_t size, ByteOutput& output)
 {
-    if (m_buffer.capacity()*4 < buffer.capacity()*3)
+    const unsigned char* end = data + size;
+    while (data != end)
     {
-        m_buffer.reserve(buffer.capacity());
-    }
-    for (const auto c : buffer)
-    {
-        if (m_count > 0)
+        if (m_count == 0)
         {
-            if (m_current == c)
-            {
-                ++m_count;
-            }
-            else
+            // bytes which are written as they are, up to an escape or a run
+            const size_t literals = RLEScan::Literals(data, end - data, m_escape);
+            output.Put(data, literals);
+            data += literals;
+            if (data == end)
             {
-                DumpCurrent(m_buffer);
-                m_count = 1;
-                m_current = c;
+                break;
             }
+            m_current = *data++;
+            m_count = 1;
         }
-        else
+        // the run can continue in the next data
+        const size_t run = RLEScan::Run(data, end - data, m_current);
+        m_count += run;
+        data += run;
+        if (data != end)
         {
-            m_count = 1;
-            m_current = c;
+            DumpCurrent(output);
         }
     }
-    m_buffer.swap(buffer);
-    m_buffer.clear();
 }
 
-void RLECompressor::Finish(std::vector<unsigned char>& buffer)
+void RLECompressor::FinishBytes(ByteOutput& output)
 {
-    Compress(buffer);
-    DumpCurrent(buffer);
+    DumpCurrent(output);
     m_current = 0;
 }
 
-void RLEDeCompressor::DeCompress(std::vector<unsigned char>& buffer)
+void RLEDeCompressor::DeCompressBytes(const unsigned char* data, const size_t size, ByteOutput& output)
 {
-    if (m_buffer.capacity() * 4 < buffer.capacity() * 3)
-    {
-        m_buffer.reserve(buffer.capacity());
-    }
-    for (const auto c : buffer)
+    for (const unsigned char* end = data + size; data != end; ++data)
     {
+        const auto c = *data;
         if (m_escaped)
         {
             if (m_escape == c && m_count==0)
             {
-                m_buffer.emplace_back(m_escape);
+                output.Put(m_escape);
                 m_escaped = false;
             }
             else if(m_count==0)
@@ -114,37 +109,33 @@ void RLEDeCompressor::DeCompress(std::vector<unsigned char>& buffer)
             }
             else
             {
-                for (; m_count != 0; --m_count)
-                {
-                    m_buffer.emplace_back(c);
-                }
-                assert(0 == m_count);
+                // a run is at most 255 bytes
+                unsigned char run[255];
+                memset(run, c, m_count);
+                output.Put(run, m_count);
+                m_count = 0;
                 m_escaped = false;
             }
         }
+        else if (m_escape == c)
+        {
+            m_escaped = true;
+        }
         else
         {
-            if (m_escape == c)
-            {
-                m_escaped = true;
-            }
-            else
-            {
-                m_buffer.emplace_back(c);
-            }
+            // everything up to the next escape is written as it is
+            const unsigned char* escape = static_cast<const unsigned char*>(memchr(data, m_escape, end - data));
+            const unsigned char* literalsEnd = escape == nullptr ? end : escape;
+            output.Put(data, literalsEnd - data);
+            data = literalsEnd - 1;
         }
     }
-    m_buffer.swap(buffer);
-    m_buffer.clear();
 }
 
-void RLEDeCompressor::Finish(std::vector<unsigned char>& buffer)
+void RLEDeCompressor::FinishBytes(ByteOutput&)
 {
-    DeCompress(buffer);
     if (m_escaped)
     {
         throw std::runtime_error("Incomplete data");
     }
 }
-
-
@@ -1,6 +1,6 @@
 #pragma once
 
-#include "ICompress.h"
+#include "SpanCodec.h"
 
 // byte stream format:
 //   value => value
@@ -14,31 +14,28 @@ protected:
 };
 
 
-class RLECompressor : public ICompressor, RLECommon
+class RLECompressor : public SpanCompressor, RLECommon
 {
 public:
-    void Compress(std::vector<unsigned char>& ioBuffer) override;
-    void Finish(std::vector<unsigned char>& ioBuffer) override;
+    void CompressBytes(const unsigned char* data, const size_t size, ByteOutput& output) override;
+    void FinishBytes(ByteOutput& output) override;
 
 private:
-    void DumpCurrent(std::vector<unsigned char>& buffer);
+    void DumpCurrent(ByteOutput& output);
 
     unsigned char m_current = 0;
     size_t m_count = 0;
-    std::vector<unsigned char> m_buffer;
 };
 
 
-class RLEDeCompressor : public IDeCompressor, RLECommon
+class RLEDeCompressor : public SpanDeCompressor, RLECommon
 {
 public:
-
-    void DeCompress(std::vector<unsigned char>& ioBuffer) override;
-    void Finish(std::vector<unsigned char>& ioBuffer) override;
+    void DeCompressBytes(const unsigned char* data, const size_t size, ByteOutput& output) override;
+    void FinishBytes(ByteOutput& output) override;
 
 private:
     bool m_escaped = false;
     size_t m_count = 0;
-    std::vector<unsigned char> m_buffer;
 };
 
@@ -0,0 +1,245 @@
+#include <cassert>
+#include <cstring>
+
+#include "RLEScan.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define RLESCAN_X86
+#include <immintrin.h>
+#endif
+
+// gcc and clang only generate avx2 code for functions which ask for it
+#if defined(RLESCAN_X86) && (defined(__GNUC__) || defined(__clang__))
+#define RLESCAN_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define RLESCAN_TARGET_AVX2
+#endif
+
+namespace
+{
+    unsigned int TrailingZeros(uint32_t value)
+    {
+        assert(value != 0);
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward(&index, value);
+        return index;
+#else
+        return __builtin_ctz(value);
+#endif
+    }
+
+    uint64_t Load64(const unsigned char* data)
+    {
+        uint64_t value;
+        memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    // the high bit of each byte is set when that byte is 0, or when a lower byte is 0
+    uint64_t ZeroBytes(const uint64_t value)
+    {
+        return (value - 0x0101010101010101ull) & ~value & 0x8080808080808080ull;
+    }
+
+    // the first position from 'position' which is the escape or starts a run of 3 bytes, or else the
+    // first position which isn't followed by 2 bytes
+    size_t FindBytes(const unsigned char* data, const size_t size, const unsigned char escape, size_t position)
+    {
+        for (; position + 2 < size; ++position)
+        {
+            if (data[position] == escape || (data[position] == data[position + 1] && data[position] == data[position + 2]))
+            {
+                break;
+            }
+        }
+        return position;
+    }
+
+    size_t FindWord(const unsigned char* data, const size_t size, const unsigned char escape, size_t position)
+    {
+        const uint64_t escapes = 0x0101010101010101ull * escape;
+        for (; position + 10 <= size; position += 8)
+        {
+            const uint64_t x = Load64(data + position);
+            const uint64_t y = Load64(data + position + 1);
+            const uint64_t z = Load64(data + position + 2);
+            if ((ZeroBytes(x ^ escapes) | ZeroBytes((x ^ y) | (y ^ z))) != 0)
+            {
+                // the bytes loop finds which one
+                break;
+            }
+        }
+        return FindBytes(data, size, escape, position);
+    }
+
+    // the literals end where the scan found an escape or run. at the end of data, the last literal and
+    // the byte after it could be the start of a run which continues in the next data.
+    size_t LiteralsEnd(const unsigned char* data, const size_t size, const size_t position)
+    {
+        return position > 0 && position < size && data[position - 1] == data[position] ? position - 1 : position;
+    }
+
+    size_t LiteralsBytes(const unsigned char* data, const size_t size, const unsigned char escape)
+    {
+        return LiteralsEnd(data, size, FindBytes(data, size, escape, 0));
+    }
+
+    size_t LiteralsWord(const unsigned char* data, const size_t size, const unsigned char escape)
+    {
+        return LiteralsEnd(data, size, FindWord(data, size, escape, 0));
+    }
+
+    size_t RunBytes(const unsigned char* data, const size_t size, const unsigned char value)
+    {
+        size_t position = 0;
+        while (position < size && data[position] == value)
+        {
+            ++position;
+        }
+        return position;
+    }
+
+    size_t RunWord(const unsigned char* data, const size_t size, const unsigned char value)
+    {
+        const uint64_t values = 0x0101010101010101ull * value;
+        size_t position = 0;
+        while (position + 8 <= size && Load64(data + position) == values)
+        {
+            position += 8;
+        }
+        return position + RunBytes(data + position, size - position, value);
+    }
+
+#ifdef RLESCAN_X86
+    size_t FindSSE2(const unsigned char* data, const size_t size, const unsigned char escape, size_t position)
+    {
+        const __m128i escapes = _mm_set1_epi8(static_cast<char>(escape));
+        for (; position + 18 <= size; position += 16)
+        {
+            const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + position));
+            const __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + position + 1));
+            const __m128i z = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + position + 2));
+            const __m128i found = _mm_or_si128(_mm_cmpeq_epi8(x, escapes), _mm_and_si128(_mm_cmpeq_epi8(x, y), _mm_cmpeq_epi8(y, z)));
+            const unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(found));
+            if (mask != 0)
+            {
+                return position + TrailingZeros(mask);
+            }
+        }
+        return FindWord(data, size, escape, position);
+    }
+
+    size_t LiteralsSSE2(const unsigned char* data, const size_t size, const unsigned char escape)
+    {
+        return LiteralsEnd(data, size, FindSSE2(data, size, escape, 0));
+    }
+
+    size_t RunSSE2(const unsigned char* data, const size_t size, const unsigned char value)
+    {
+        const __m128i values = _mm_set1_epi8(static_cast<char>(value));
+        size_t position = 0;
+        for (; position + 16 <= size; position += 16)
+        {
+            const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + position));
+            const unsigned int equal = static_cast<unsigned int>(_mm_movemask_epi8(_mm_cmpeq_epi8(x, values)));
+            if (equal != 0xFFFF)
+            {
+                return position + TrailingZeros(~equal & 0xFFFF);
+            }
+        }
+        return position + RunWord(data + position, size - position, value);
+    }
+
+    RLESCAN_TARGET_AVX2
+    size_t FindAVX2(const unsigned char* data, const size_t size, const unsigned char escape, size_t position)
+    {
+        const __m256i escapes = _mm256_set1_epi8(static_cast<char>(escape));
+        for (; position + 34 <= size; position += 32)
+        {
+            const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + position));
+            const __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + position + 1));
+            const __m256i z = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + position + 2));
+            const __m256i found = _mm256_or_si256(_mm256_cmpeq_epi8(x, escapes), _mm256_and_si256(_mm256_cmpeq_epi8(x, y), _mm256_cmpeq_epi8(y, z)));
+            const uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(found));
+            if (mask != 0)
+            {
+                return position + TrailingZeros(mask);
+            }
+        }
+        return FindSSE2(data, size, escape, position);
+    }
+
+    RLESCAN_TARGET_AVX2
+    size_t LiteralsAVX2(const unsigned char* data, const size_t size, const unsigned char escape)
+    {
+        return LiteralsEnd(data, size, FindAVX2(data, size, escape, 0));
+    }
+
+    RLESCAN_TARGET_AVX2
+    size_t RunAVX2(const unsigned char* data, const size_t size, const unsigned char value)
+    {
+        const __m256i values = _mm256_set1_epi8(static_cast<char>(value));
+        size_t position = 0;
+        for (; position + 32 <= size; position += 32)
+        {
+            const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + position));
+            const uint32_t equal = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, values)));
+            if (equal != 0xFFFFFFFF)
+            {
+                return position + TrailingZeros(~equal);
+            }
+        }
+        return position + RunSSE2(data + position, size - position, value);
+    }
+#endif
+}
+
+RLEScan::ScanFunction RLEScan::m_literals = RLEScan::GetLiterals(MatchLength::Best());
+RLEScan::ScanFunction RLEScan::m_run = RLEScan::GetRun(MatchLength::Best());
+
+void RLEScan::Select(Implementation implementation)
+{
+    assert(MatchLength::Supported(implementation));
+    m_literals = GetLiterals(implementation);
+    m_run = GetRun(implementation);
+}
+
+RLEScan::ScanFunction RLEScan::GetLiterals(Implementation implementation)
+{
+    switch (implementation)
+    {
+    case Implementation::Bytes:
+        return LiteralsBytes;
+    default:
+    case Implementation::Word:
+        return LiteralsWord;
+#ifdef RLESCAN_X86
+    case Implementation::SSE2:
+        return LiteralsSSE2;
+    case Implementation::AVX2:
+        return LiteralsAVX2;
+#endif
+    }
+}
+
+RLEScan::ScanFunction RLEScan::GetRun(Implementation implementation)
+{
+    switch (implementation)
+    {
+    case Implementation::Bytes:
+        return RunBytes;
+    default:
+    case Implementation::Word:
+        return RunWord;
+#ifdef RLESCAN_X86
+    case Implementation::SSE2:
+        return RunSSE2;
+    case Implementation::AVX2:
+        return RunAVX2;
+#endif
+    }
+}
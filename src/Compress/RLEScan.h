@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+
+#include "MatchLength.h"
+
+// the scans of the RLE compressor, which look at a word or vector register at a time. there are
+// the same variants as for MatchLength, the widest variant the cpu supports is selected on first use.
+//   Literals : length of the bytes at the start of data which are written as they are: bytes which
+//              aren't the escape and aren't in a run of more than 2. a run which could continue after
+//              the last 2 bytes isn't included, the byte after the literals differs from the last one.
+//   Run      : length of the run of 'value' at the start of data
+
+class RLEScan
+{
+public:
+    typedef MatchLength::Implementation Implementation;
+
+    static size_t Literals(const unsigned char* data, const size_t size, const unsigned char escape)
+    {
+        return m_literals(data, size, escape);
+    }
+    static size_t Run(const unsigned char* data, const size_t size, const unsigned char value)
+    {
+        return m_run(data, size, value);
+    }
+
+    // use a specific implementation (tests and benchmarks), it has to be supported
+    static void Select(Implementation implementation);
+
+private:
+    typedef size_t (*ScanFunction)(const unsigned char*, size_t, unsigned char);
+
+    static ScanFunction GetLiterals(Implementation implementation);
+    static ScanFunction GetRun(Implementation implementation);
+
+    static ScanFunction m_literals;
+    static ScanFunction m_run;
+};
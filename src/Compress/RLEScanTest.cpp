@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "CommonTestFunctionality.h"
+
+#include "RLEScan.h"
+
+class RLEScanTest : public testing::TestWithParam<RLEScan::Implementation>
+{
+protected:
+    virtual void SetUp()
+    {
+        if (MatchLength::Supported(GetParam()))
+        {
+            RLEScan::Select(GetParam());
+        }
+    }
+
+    virtual void TearDown()
+    {
+        RLEScan::Select(MatchLength::Best());
+    }
+
+    // runs of 1..4 bytes from a few values, the escape is one of them
+    static std::vector<unsigned char> GetInput(const size_t size)
+    {
+        std::mt19937 rng;
+        rng.seed(0);
+        std::vector<unsigned char> res;
+        while (res.size() < size)
+        {
+            const unsigned char value = static_cast<unsigned char>(252 + rng() % 4);
+            const size_t run = rng() % 16 == 0 ? 1 + rng() % 4 : 1;
+            res.insert(res.end(), run, value);
+        }
+        res.resize(size);
+        return res;
+    }
+};
+
+TEST_P(RLEScanTest, Literals)
+{
+    if (!MatchLength::Supported(GetParam()))
+    {
+        return;
+    }
+    const unsigned char escape = 255;
+    const auto input = GetInput(2000);
+    for (size_t start = 0; start < 1000; ++start)
+    {
+        for (size_t size : { 0, 1, 2, 3, 9, 10, 11, 17, 18, 19, 33, 34, 35, 100, 1000 })
+        {
+            const unsigned char* data = input.data() + start;
+            // the first escape or run of 3, or up to the last 2 bytes
+            size_t expected = 0;
+            while (expected + 2 < size && data[expected] != escape && !(data[expected] == data[expected + 1] && data[expected] == data[expected + 2]))
+            {
+                ++expected;
+            }
+            if (expected + 2 >= size && expected > 0 && expected < size && data[expected - 1] == data[expected])
+            {
+                --expected;
+            }
+            ASSERT_EQ(expected, RLEScan::Literals(data, size, escape)) << "Start: " << start << " Size: " << size;
+        }
+    }
+}
+
+TEST_P(RLEScanTest, Run)
+{
+    if (!MatchLength::Supported(GetParam()))
+    {
+        return;
+    }
+    std::vector<unsigned char> input(200, 7);
+    for (size_t difference = 0; difference <= input.size(); ++difference)
+    {
+        if (difference < input.size())
+        {
+            input[difference] = 8;
+        }
+        for (size_t size = 0; size <= input.size(); ++size)
+        {
+            ASSERT_EQ(std::min(difference, size), RLEScan::Run(input.data(), size, 7));
+        }
+        if (difference < input.size())
+        {
+            input[difference] = 7;
+        }
+    }
+}
+
+INSTANTIATE_TEST_CASE_P(Implementations, RLEScanTest,
+    testing::Values(
+        MatchLength::Implementation::Bytes,
+        MatchLength::Implementation::Word,
+        MatchLength::Implementation::SSE2,
+        MatchLength::Implementation::AVX2));
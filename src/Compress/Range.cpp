@@ -0,0 +1,333 @@
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+#include "Histogram.h"
+#include "Range.h"
+
+namespace
+{
+    const size_t firstInterval = 16;
+    const size_t maxInterval = 2048;
+    // the counts are halved above this total
+    const uint32_t countLimit = 1 << 16;
+}
+
+RangeCommon::Model::Model(const bool lookup)
+    : m_symbols()
+    , m_counts()
+    , m_lookup(lookup ? total : 0)
+    , m_interval(firstInterval)
+    , m_untilRebuild(firstInterval)
+{
+    for (unsigned int value = 0; value < 256; ++value)
+    {
+        m_symbols[value] = { value * (total / 256), total / 256 };
+    }
+    if (lookup)
+    {
+        for (uint32_t slot = 0; slot < total; ++slot)
+        {
+            m_lookup[slot] = static_cast<unsigned char>(slot / (total / 256));
+        }
+    }
+}
+
+void RangeCommon::Model::Count(const unsigned char* data, const size_t size)
+{
+    assert(size <= m_untilRebuild);
+    Histogram::Count(data, size, m_counts.data());
+    m_untilRebuild -= size;
+    if (m_untilRebuild == 0)
+    {
+        Rebuild();
+    }
+}
+
+void RangeCommon::Model::Rebuild()
+{
+    uint64_t sum = 0;
+    for (auto count : m_counts)
+    {
+        sum += count;
+    }
+    // every byte keeps a frequency of at least 1, the rest is divided by count. what is lost by
+    // rounding down goes to the most frequent byte.
+    const uint64_t scale = (static_cast<uint64_t>(total - 256) << 32) / std::max<uint64_t>(sum, 1);
+    uint32_t start = 0;
+    unsigned int largest = 0;
+    for (unsigned int value = 0; value < 256; ++value)
+    {
+        m_symbols[value].frequency = 1 + static_cast<uint32_t>((m_counts[value] * scale) >> 32);
+        start += m_symbols[value].frequency;
+        if (m_symbols[value].frequency > m_symbols[largest].frequency)
+        {
+            largest = value;
+        }
+    }
+    assert(start <= total);
+    m_symbols[largest].frequency += total - start;
+    start = 0;
+    for (unsigned int value = 0; value < 256; ++value)
+    {
+        m_symbols[value].start = start;
+        start += m_symbols[value].frequency;
+    }
+    if (!m_lookup.empty())
+    {
+        for (unsigned int value = 0; value < 256; ++value)
+        {
+            memset(m_lookup.data() + m_symbols[value].start, static_cast<int>(value), m_symbols[value].frequency);
+        }
+    }
+    if (sum > countLimit)
+    {
+        for (auto& count : m_counts)
+        {
+            count /= 2;
+        }
+    }
+    m_interval = std::min(maxInterval, 2 * m_interval);
+    m_untilRebuild = m_interval;
+}
+
+void RangeCommon::WriteNumber(unsigned char* data, const uint32_t value)
+{
+    for (unsigned int i = 0; i < 4; ++i)
+    {
+        data[i] = static_cast<unsigned char>(value >> (8 * i));
+    }
+}
+
+uint32_t RangeCommon::ReadNumber(const unsigned char* data)
+{
+    return data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<uint32_t>(data[3]) << 24);
+}
+
+
+
+RangeCompressor::RangeCompressor()
+    : m_model(false)
+    , m_encoders()
+    , m_streams()
+    , m_blockKeys(0)
+    , m_outBuffer()
+{
+    // a byte takes at most 'totalBits' bits
+    for (auto& stream : m_streams)
+    {
+        stream.resize(blockSize / streamCount * 2 + 16);
+    }
+    BeginBlock();
+}
+
+void RangeCompressor::BeginBlock()
+{
+    for (unsigned int stream = 0; stream < streamCount; ++stream)
+    {
+        m_encoders[stream].Begin(m_streams[stream].data());
+    }
+    m_blockKeys = 0;
+}
+
+void RangeCompressor::CompressBytes(const unsigned char* data, size_t size, ByteOutput& output)
+{
+    m_outBuffer.clear();
+    while (size > 0)
+    {
+        const size_t count = std::min(std::min(size, blockSize - m_blockKeys), m_model.Remaining());
+        // the coders are kept in locals, the writes to the streams could change the members
+        std::array<Encoder, streamCount> encoders = m_encoders;
+        const Model::Symbol* symbols = m_model.Symbols();
+        const unsigned char* iter = data;
+        const unsigned char* end = data + count;
+        // byte n of the block goes to stream n % streamCount
+        for (size_t stream = m_blockKeys % streamCount; stream != 0 && stream < streamCount && iter != end; ++stream)
+        {
+            encoders[stream].Encode(symbols[*iter++]);
+        }
+        for (; static_cast<size_t>(end - iter) >= streamCount; iter += streamCount)
+        {
+            for (unsigned int stream = 0; stream < streamCount; ++stream)
+            {
+                encoders[stream].Encode(symbols[iter[stream]]);
+            }
+        }
+        for (unsigned int stream = 0; iter != end; ++stream)
+        {
+            encoders[stream].Encode(symbols[*iter++]);
+        }
+        m_encoders = encoders;
+        m_model.Count(data, count);
+        m_blockKeys += count;
+        data += count;
+        size -= count;
+        if (m_blockKeys == blockSize)
+        {
+            EndBlock();
+        }
+    }
+    output.Take(m_outBuffer);
+}
+
+void RangeCompressor::EndBlock()
+{
+    unsigned char header[headerSize];
+    WriteNumber(header, static_cast<uint32_t>(m_blockKeys));
+    for (unsigned int stream = 0; stream < streamCount; ++stream)
+    {
+        m_encoders[stream].End();
+        assert(m_encoders[stream].out <= m_streams[stream].data() + m_streams[stream].size());
+        WriteNumber(header + 4 + 4 * stream, static_cast<uint32_t>(m_encoders[stream].out - m_streams[stream].data()));
+    }
+    m_outBuffer.insert(m_outBuffer.end(), header, header + headerSize);
+    for (unsigned int stream = 0; stream < streamCount; ++stream)
+    {
+        m_outBuffer.insert(m_outBuffer.end(), m_streams[stream].begin(), m_streams[stream].begin() + (m_encoders[stream].out - m_streams[stream].data()));
+    }
+    BeginBlock();
+}
+
+void RangeCompressor::FinishBytes(ByteOutput& output)
+{
+    m_outBuffer.clear();
+    if (m_blockKeys > 0)
+    {
+        EndBlock();
+    }
+    const unsigned char end[4] = {};
+    m_outBuffer.insert(m_outBuffer.end(), end, end + 4);
+    output.Take(m_outBuffer);
+}
+
+
+
+RangeDeCompressor::RangeDeCompressor()
+    : m_model(true)
+    , m_inBuffer()
+    , m_outBuffer()
+    , m_position(0)
+    , m_eof(false)
+{
+}
+
+bool RangeDeCompressor::DeCompressBlock(std::vector<unsigned char>& output)
+{
+    const unsigned char* data = m_inBuffer.data() + m_position;
+    const size_t size = m_inBuffer.size() - m_position;
+    if (size < 4)
+    {
+        return false;
+    }
+    const size_t count = ReadNumber(data);
+    if (count == 0)
+    {
+        m_position += 4;
+        m_eof = true;
+        return true;
+    }
+    if (count > blockSize)
+    {
+        throw std::runtime_error("Invalid data");
+    }
+    if (size < headerSize)
+    {
+        return false;
+    }
+    size_t total = headerSize;
+    Decoder decoders[streamCount];
+    for (unsigned int stream = 0; stream < streamCount; ++stream)
+    {
+        const size_t streamSize = ReadNumber(data + 4 + 4 * stream);
+        if (size - total < streamSize)
+        {
+            return false;
+        }
+        if (!decoders[stream].Begin(data + total, streamSize))
+        {
+            throw std::runtime_error("Invalid data");
+        }
+        total += streamSize;
+    }
+
+    const size_t start = output.size();
+    output.resize(start + count);
+    unsigned char* out = output.data() + start;
+    for (size_t position = 0; position < count; )
+    {
+        const size_t run = std::min(count - position, m_model.Remaining());
+        const Model::Symbol* symbols = m_model.Symbols();
+        const unsigned char* lookup = m_model.Lookup();
+        auto Decode = [symbols, lookup](Decoder& decoder)
+        {
+            const uint32_t slot = decoder.Slot();
+            if (slot >= RangeCommon::total)
+            {
+                throw std::runtime_error("Invalid data");
+            }
+            const unsigned char value = lookup[slot];
+            decoder.Decode(symbols[value]);
+            return value;
+        };
+        unsigned char* iter = out + position;
+        unsigned char* end = iter + run;
+        for (size_t stream = position % streamCount; stream != 0 && stream < streamCount && iter != end; ++stream)
+        {
+            *iter++ = Decode(decoders[stream]);
+        }
+        for (; static_cast<size_t>(end - iter) >= streamCount; iter += streamCount)
+        {
+            // written out for the 4 streams, a loop keeps the coders in memory
+            static_assert(streamCount == 4, "one call per stream");
+            iter[0] = Decode(decoders[0]);
+            iter[1] = Decode(decoders[1]);
+            iter[2] = Decode(decoders[2]);
+            iter[3] = Decode(decoders[3]);
+        }
+        for (unsigned int stream = 0; iter != end; ++stream)
+        {
+            *iter++ = Decode(decoders[stream]);
+        }
+        m_model.Count(out + position, run);
+        position += run;
+    }
+    for (const auto& decoder : decoders)
+    {
+        if (!decoder.End())
+        {
+            throw std::runtime_error("Invalid data");
+        }
+    }
+
+    m_position += total;
+    return true;
+}
+
+void RangeDeCompressor::DeCompressBytes(const unsigned char* data, const size_t size, ByteOutput& output)
+{
+    if (m_eof && size > 0)
+    {
+        throw std::runtime_error("Data after end");
+    }
+    m_inBuffer.insert(m_inBuffer.end(), data, data + size);
+    m_outBuffer.clear();
+    while (!m_eof && DeCompressBlock(m_outBuffer))
+    {
+    }
+    if (m_eof && m_position != m_inBuffer.size())
+    {
+        throw std::runtime_error("Data after end");
+    }
+    m_inBuffer.erase(m_inBuffer.begin(), m_inBuffer.begin() + m_position);
+    m_position = 0;
+    output.Take(m_outBuffer);
+}
+
+void RangeDeCompressor::FinishBytes(ByteOutput&)
+{
+    if (!m_eof)
+    {
+        throw std::runtime_error("Incomplete data");
+    }
+}
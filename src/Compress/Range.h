@@ -0,0 +1,240 @@
+#pragma once
+
+#include <array>
+
+#include "SpanCodec.h"
+
+// order-0 range coder with adaptive byte frequencies, a 32 bit coder with carry propagation.
+//
+// byte stream format (numbers are 32 bit, lsb first):
+//   - repeat for each block of up to 'blockSize' bytes:
+//     - size, compressed size of each stream
+//     - 4 streams of range coded bytes, stream n codes the bytes at positions n, n+4, n+8, .. of the
+//       block. the coders are flushed at the end of each block.
+//   - end: a block with size 0
+//
+// the decoder follows the 4 streams at the same time, so the work on the bytes overlaps instead of
+// waiting for a division per byte.
+//
+// the frequencies are kept for the whole stream. each byte is counted, but the frequencies used for
+// coding only change when the model is rebuilt: after 16 bytes, then after twice as many bytes each
+// time, up to every 2048 bytes. the decoder finds a byte with a single table lookup that way, and the
+// bytes between rebuilds are coded in a tight loop. the counts are halved when they get large, so the
+// model follows changes in the data.
+
+class RangeCommon
+{
+protected:
+    static const size_t blockSize = 1 << 16;
+    static const unsigned int totalBits = 15;
+    static const uint32_t total = 1u << totalBits;
+    // the range is kept above this
+    static const uint32_t top = 1u << 24;
+    static const unsigned int streamCount = 4;
+    static const size_t headerSize = 4 + 4 * streamCount;
+
+    class Model
+    {
+    public:
+        struct Symbol
+        {
+            uint32_t start;
+            uint32_t frequency;
+        };
+
+        // the decoder needs a lookup table to find bytes
+        explicit Model(const bool lookup);
+
+        const Symbol* Symbols() const
+        {
+            return m_symbols.data();
+        }
+        // the byte of each slot [0..total)
+        const unsigned char* Lookup() const
+        {
+            return m_lookup.data();
+        }
+        // bytes until the next rebuild, the frequencies don't change before that
+        size_t Remaining() const
+        {
+            return m_untilRebuild;
+        }
+        // count coded bytes, at most Remaining()
+        void Count(const unsigned char* data, const size_t size);
+
+    private:
+        void Rebuild();
+
+        std::array<Symbol, 256> m_symbols;
+        std::array<uint64_t, 256> m_counts;
+        std::vector<unsigned char> m_lookup;
+        size_t m_interval;
+        size_t m_untilRebuild;
+    };
+
+    struct Encoder
+    {
+        void Begin(unsigned char* output)
+        {
+            low = 0;
+            range = 0xFFFFFFFF;
+            cache = 0;
+            cacheSize = 1;
+            out = output;
+        }
+        void Encode(const Model::Symbol& symbol)
+        {
+            const uint32_t r = range >> totalBits;
+            low += static_cast<uint64_t>(r) * symbol.start;
+            range = r * symbol.frequency;
+            while (range < top)
+            {
+                range <<= 8;
+                ShiftLow();
+            }
+        }
+        // write all of low
+        void End()
+        {
+            for (unsigned int i = 0; i < 5; ++i)
+            {
+                ShiftLow();
+            }
+        }
+        void ShiftLow()
+        {
+            if (static_cast<uint32_t>(low) < 0xFF000000u || (low >> 32) != 0)
+            {
+                const unsigned char carry = static_cast<unsigned char>(low >> 32);
+                unsigned char value = cache;
+                do
+                {
+                    *out++ = static_cast<unsigned char>(value + carry);
+                    value = 0xFF;
+                } while (--cacheSize != 0);
+                cache = static_cast<unsigned char>(low >> 24);
+            }
+            ++cacheSize;
+            low = (low & 0x00FFFFFF) << 8;
+        }
+
+        uint64_t low;
+        uint32_t range;
+        // the last byte of low which isn't written yet, it can still get a carry. cacheSize-1 bytes
+        // 0xFF follow it.
+        unsigned char cache;
+        size_t cacheSize;
+        unsigned char* out;
+    };
+
+    struct Decoder
+    {
+        // returns false when the stream doesn't start with the zero byte every coder writes first
+        bool Begin(const unsigned char* data, const size_t size)
+        {
+            in = data;
+            end = data + size;
+            code = 0;
+            range = 0xFFFFFFFF;
+            if (Next() != 0)
+            {
+                return false;
+            }
+            for (unsigned int i = 0; i < 4; ++i)
+            {
+                code = (code << 8) | Next();
+            }
+            return true;
+        }
+        // the slot of the next byte, 'total' or more for invalid data
+        uint32_t Slot()
+        {
+            scale = range >> totalBits;
+            return code / scale;
+        }
+        void Decode(const Model::Symbol& symbol)
+        {
+            code -= scale * symbol.start;
+            range = scale * symbol.frequency;
+            // the range is at least 1 << (24 - totalBits) here, so at most two bytes are needed. how
+            // many depends on the data, so they are shifted in without a branch.
+            const unsigned int shift = 8 * ((range < top) + (range < (top >> 8)));
+            if (end - in >= 2)
+            {
+                const uint32_t next = (in[0] << 8) | in[1];
+                code = (code << shift) | (next >> (16 - shift));
+                range <<= shift;
+                in += shift / 8;
+            }
+            else
+            {
+                while (range < top)
+                {
+                    code = (code << 8) | Next();
+                    range <<= 8;
+                }
+            }
+        }
+        // reading past the end gives zeros, End() is false then
+        unsigned char Next()
+        {
+            return in < end ? *in++ : 0;
+        }
+        // true when exactly all data is used
+        bool End() const
+        {
+            return in == end;
+        }
+
+        uint32_t code;
+        uint32_t range;
+        uint32_t scale;
+        const unsigned char* in;
+        const unsigned char* end;
+    };
+
+    static void WriteNumber(unsigned char* data, const uint32_t value);
+    static uint32_t ReadNumber(const unsigned char* data);
+};
+
+class RangeCompressor : public SpanCompressor, RangeCommon
+{
+public:
+    RangeCompressor();
+
+    void CompressBytes(const unsigned char* data, const size_t size, ByteOutput& output) override;
+    void FinishBytes(ByteOutput& output) override;
+
+private:
+    // start the coders of a new block
+    void BeginBlock();
+    // flush the coders and move the block to m_outBuffer
+    void EndBlock();
+
+    Model m_model;
+    std::array<Encoder, streamCount> m_encoders;
+    // coded bytes of each stream of the current block
+    std::array<std::vector<unsigned char>, streamCount> m_streams;
+    size_t m_blockKeys;
+    std::vector<unsigned char> m_outBuffer;
+};
+
+class RangeDeCompressor : public SpanDeCompressor, RangeCommon
+{
+public:
+    RangeDeCompressor();
+
+    void DeCompressBytes(const unsigned char* data, const size_t size, ByteOutput& output) override;
+    void FinishBytes(ByteOutput& output) override;
+
+private:
+    // returns false when the block isn't complete yet
+    bool DeCompressBlock(std::vector<unsigned char>& output);
+
+    Model m_model;
+    std::vector<unsigned char> m_inBuffer;
+    std::vector<unsigned char> m_outBuffer;
+    // bytes used from the start of m_inBuffer
+    size_t m_position;
+    bool m_eof;
+};
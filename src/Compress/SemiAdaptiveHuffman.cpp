@@ -0,0 +1,305 @@
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <stdexcept>
+#include <string>
+
+#include "SemiAdaptiveHuffman.h"
+
+const size_t SemiAdaptiveHuffmanCommon::firstInterval;
+const size_t SemiAdaptiveHuffmanCommon::maxInterval;
+
+SemiAdaptiveHuffmanCommon::SemiAdaptiveHuffmanCommon()
+    : m_counts()
+    , m_lengths()
+    , m_codes()
+    , m_interval(firstInterval / 2)
+    , m_remaining(0)
+{
+    m_counts[keyEscape] = 1;
+    m_counts[keyEnd] = 1;
+    NextCodes();
+}
+
+void SemiAdaptiveHuffmanCommon::NextCodes()
+{
+    // bytes without a code only got a count by escaping
+    uint64_t total = 0;
+    for (unsigned int key = 0; key < keyEscape; ++key)
+    {
+        if (m_lengths[key] == 0)
+        {
+            m_counts[keyEscape] += m_counts[key];
+        }
+        total += m_counts[key];
+    }
+    total += m_counts[keyEscape] + m_counts[keyEnd];
+    if (total >= maxTotalCount)
+    {
+        // no count goes back to 0, a key which has a code keeps one
+        for (auto& count : m_counts)
+        {
+            count = (count + 1) / 2;
+        }
+    }
+    HuffmanCode::LimitedLengths(m_counts.data(), keyCount, codeLengthLimit, m_lengths.data());
+    HuffmanCode::CanonicalCodes(m_lengths.data(), keyCount, m_codes.data());
+    m_interval = std::min(2 * m_interval, maxInterval);
+    m_remaining = m_interval;
+}
+
+void SemiAdaptiveHuffmanCommon::Escaped(const size_t remaining)
+{
+    m_remaining = std::min(remaining, firstInterval);
+    m_interval = firstInterval / 2;
+}
+
+
+
+SemiAdaptiveHuffmanCompressor::SemiAdaptiveHuffmanCompressor()
+    : m_table()
+    , m_outBuffer()
+    , m_writer()
+{
+    BuildTable();
+}
+
+void SemiAdaptiveHuffmanCompressor::BuildTable()
+{
+    for (unsigned int key = 0; key < keyCount; ++key)
+    {
+        uint32_t bits = 0;
+        for (unsigned int bit = 0; bit < m_lengths[key]; ++bit)
+        {
+            bits = (bits << 1) | ((m_codes[key] >> bit) & 1);
+        }
+        m_table[key].bits = bits;
+        m_table[key].length = static_cast<uint16_t>(m_lengths[key]);
+        m_table[key].escape = 0;
+    }
+    const Code escape = m_table[keyEscape];
+    for (unsigned int key = 0; key < keyEscape; ++key)
+    {
+        if (m_table[key].length == 0)
+        {
+            m_table[key].bits = escape.bits | (key << escape.length);
+            m_table[key].length = static_cast<uint16_t>(escape.length + 8);
+            m_table[key].escape = 1;
+        }
+    }
+}
+
+void SemiAdaptiveHuffmanCompressor::CompressBytes(const unsigned char* data, size_t size, ByteOutput& output)
+{
+    m_outBuffer.clear();
+    m_writer.Begin(m_outBuffer);
+    m_writer.Reserve(codeLengthLimit * size);
+    // codes are at most 12 bits, with an escaped byte 20 bits, so two of them fit the writer between
+    // flushes
+    static_assert(2 * (codeLengthLimit + 8) <= 56, "codes don't fit the writer");
+    while (size > 0)
+    {
+        if (m_remaining == 0)
+        {
+            NextCodes();
+            BuildTable();
+        }
+        const size_t run = std::min(size, m_remaining);
+        const unsigned char* iter = data;
+        const unsigned char* end = data + run;
+        for (; end - iter >= 4; iter += 4)
+        {
+            if (m_table[iter[0]].escape | m_table[iter[1]].escape | m_table[iter[2]].escape | m_table[iter[3]].escape)
+            {
+                break;
+            }
+            m_writer.Add(m_table[iter[0]].bits, m_table[iter[0]].length);
+            m_writer.Add(m_table[iter[1]].bits, m_table[iter[1]].length);
+            m_writer.Flush();
+            m_writer.Add(m_table[iter[2]].bits, m_table[iter[2]].length);
+            m_writer.Add(m_table[iter[3]].bits, m_table[iter[3]].length);
+            m_writer.Flush();
+            ++m_counts[iter[0]];
+            ++m_counts[iter[1]];
+            ++m_counts[iter[2]];
+            ++m_counts[iter[3]];
+        }
+        // one at a time up to an escape, or the last few
+        bool escape = false;
+        while (iter != end && !escape)
+        {
+            m_writer.Write(m_table[*iter].bits, m_table[*iter].length);
+            ++m_counts[*iter];
+            escape = m_table[*iter].escape != 0;
+            ++iter;
+        }
+        const size_t used = iter - data;
+        data += used;
+        size -= used;
+        m_remaining -= used;
+        if (escape)
+        {
+            Escaped(m_remaining);
+        }
+    }
+    m_writer.End();
+    output.Take(m_outBuffer);
+}
+
+void SemiAdaptiveHuffmanCompressor::FinishBytes(ByteOutput& output)
+{
+    m_outBuffer.clear();
+    m_writer.Begin(m_outBuffer);
+    if (m_remaining == 0)
+    {
+        NextCodes();
+        BuildTable();
+    }
+    m_writer.Write(m_table[keyEnd].bits, m_table[keyEnd].length);
+    m_writer.End(true);
+    output.Take(m_outBuffer);
+}
+
+
+
+SemiAdaptiveHuffmanDeCompressor::SemiAdaptiveHuffmanDeCompressor()
+    : m_table()
+    , m_inBuffer()
+    , m_outBuffer()
+    , m_position(0)
+    , m_eof(false)
+{
+    BuildTable();
+}
+
+void SemiAdaptiveHuffmanDeCompressor::BuildTable()
+{
+    // the table is indexed by the next bits in the stream, which hold the code reversed. the codes
+    // fill the table.
+    for (unsigned int key = 0; key < keyCount; ++key)
+    {
+        const unsigned int length = m_lengths[key];
+        if (length == 0)
+        {
+            continue;
+        }
+        assert(length <= codeLengthLimit);
+        size_t bits = 0;
+        for (unsigned int bit = 0; bit < length; ++bit)
+        {
+            bits = (bits << 1) | ((m_codes[key] >> bit) & 1);
+        }
+        for (size_t index = bits; index < m_table.size(); index += size_t(1) << length)
+        {
+            m_table[index].key = static_cast<uint16_t>(key);
+            m_table[index].length = static_cast<uint16_t>(length);
+        }
+    }
+}
+
+void SemiAdaptiveHuffmanDeCompressor::DeCompressBytes(const unsigned char* data, const size_t size, ByteOutput& output)
+{
+    if (m_eof && size > 0)
+    {
+        throw std::runtime_error("Data after end");
+    }
+    m_inBuffer.insert(m_inBuffer.end(), data, data + size);
+    m_outBuffer.clear();
+    BitReader reader(m_inBuffer.data(), m_inBuffer.size(), m_position);
+    bool incomplete = false;
+    while (!m_eof && !incomplete)
+    {
+        if (m_remaining == 0)
+        {
+            NextCodes();
+            BuildTable();
+        }
+        const size_t start = m_outBuffer.size();
+        m_outBuffer.resize(start + m_remaining);
+        unsigned char* out = m_outBuffer.data() + start;
+        size_t count = 0;
+        while (count < m_remaining && !m_eof && !incomplete)
+        {
+            // four bytes per refill, as long as there are enough bits for them. an escape or the end
+            // key stops this.
+            bool escape = false;
+            while (!escape && count + 4 <= m_remaining && reader.Available() >= 4 * codeLengthLimit)
+            {
+                reader.Refill();
+                for (unsigned int i = 0; i < 4; ++i)
+                {
+                    const TableEntry entry = m_table[reader.Peek(codeLengthLimit)];
+                    if (entry.key >= keyEscape)
+                    {
+                        escape = true;
+                        break;
+                    }
+                    reader.Skip(entry.length);
+                    out[count++] = static_cast<unsigned char>(entry.key);
+                    ++m_counts[entry.key];
+                }
+            }
+            if (count == m_remaining)
+            {
+                break;
+            }
+            // a single key, which can be an escape, the end key or the end of the input
+            reader.Refill();
+            const TableEntry entry = m_table[reader.Peek(codeLengthLimit)];
+            const unsigned int length = entry.length + (entry.key == keyEscape ? 8 : 0);
+            if (length > reader.Available())
+            {
+                incomplete = true;
+                break;
+            }
+            reader.Skip(entry.length);
+            unsigned int key = entry.key;
+            if (key == keyEscape)
+            {
+                key = static_cast<unsigned int>(reader.Pop(8));
+                if (m_lengths[key] != 0)
+                {
+                    throw std::runtime_error("Invalid data");
+                }
+            }
+            else if (key == keyEnd)
+            {
+                // only the padding can be left
+                reader.Refill();
+                if (reader.Available() >= 8)
+                {
+                    throw std::runtime_error("Data after end");
+                }
+                if (reader.Peek(static_cast<unsigned int>(reader.Available())) != 0)
+                {
+                    throw std::runtime_error("Invalid data");
+                }
+                m_eof = true;
+                break;
+            }
+            out[count++] = static_cast<unsigned char>(key);
+            ++m_counts[key];
+            if (entry.key == keyEscape)
+            {
+                // m_remaining includes the keys decoded in this run
+                Escaped(m_remaining - count);
+                m_remaining += count;
+            }
+        }
+        m_outBuffer.resize(start + count);
+        m_remaining -= count;
+    }
+    // keep the bytes which aren't completely used
+    m_position = reader.Position();
+    m_inBuffer.erase(m_inBuffer.begin(), m_inBuffer.begin() + m_position / 8);
+    m_position %= 8;
+    output.Take(m_outBuffer);
+}
+
+void SemiAdaptiveHuffmanDeCompressor::FinishBytes(ByteOutput&)
+{
+    if (!m_eof)
+    {
+        throw std::runtime_error("Incomplete data");
+    }
+}
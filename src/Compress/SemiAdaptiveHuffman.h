@@ -0,0 +1,102 @@
+#pragma once
+
+#include <array>
+
+#include "BitStream.h"
+#include "HuffmanCode.h"
+#include "SpanCodec.h"
+
+// adaptive huffman which only makes new codes every so often: both sides count the keys as they go,
+// and make canonical codes (see HuffmanCode.h) from the counts after every 'interval' keys. there is
+// no header, the first codes only have the escape and end keys.
+//
+// bit stream format:
+//   - for each byte: its code, or the code of the escape key and the byte:8 when it has no code yet
+//   - the code of the end key
+//   - padding to the byte boundary
+//
+// the interval starts at 'firstInterval' keys and doubles up to 'maxInterval', so short inputs adapt
+// quickly. an escaped byte ends the interval within 'firstInterval' keys and starts the doubling
+// again, so new bytes soon get a code. counts are halved when they add up to 'maxTotalCount', so the
+// codes follow changes in the data.
+
+class SemiAdaptiveHuffmanCommon
+{
+protected:
+    static const unsigned int keyEscape = 256;
+    static const unsigned int keyEnd = 257;
+    static const unsigned int keyCount = 258;
+    static const unsigned int codeLengthLimit = 12;
+    static const size_t firstInterval = 256;
+    static const size_t maxInterval = 16384;
+    static const uint64_t maxTotalCount = 1 << 14;
+
+    typedef std::array<uint64_t, keyCount> Counts;
+    typedef std::array<unsigned int, keyCount> Lengths;
+    typedef std::array<uint32_t, keyCount> Codes;
+
+    SemiAdaptiveHuffmanCommon();
+
+    // make the codes for the next interval
+    void NextCodes();
+    // after a byte without a code, new codes come soon. remaining is the number of keys left in the
+    // interval.
+    void Escaped(const size_t remaining);
+
+    Counts m_counts;
+    Lengths m_lengths;
+    Codes m_codes;
+    size_t m_interval;
+    // keys left until the next codes
+    size_t m_remaining;
+};
+
+class SemiAdaptiveHuffmanCompressor : public SpanCompressor, SemiAdaptiveHuffmanCommon
+{
+public:
+    SemiAdaptiveHuffmanCompressor();
+
+    void CompressBytes(const unsigned char* data, const size_t size, ByteOutput& output) override;
+    void FinishBytes(ByteOutput& output) override;
+
+private:
+    // the encode table, code bits are reversed so they can be written lsb first. a byte without a code
+    // gets the escape code followed by the byte.
+    struct Code
+    {
+        uint32_t bits;
+        uint16_t length;
+        uint16_t escape;
+    };
+
+    void BuildTable();
+
+    std::array<Code, keyCount> m_table;
+    std::vector<unsigned char> m_outBuffer;
+    BitWriter m_writer;
+};
+
+class SemiAdaptiveHuffmanDeCompressor : public SpanDeCompressor, SemiAdaptiveHuffmanCommon
+{
+public:
+    SemiAdaptiveHuffmanDeCompressor();
+
+    void DeCompressBytes(const unsigned char* data, const size_t size, ByteOutput& output) override;
+    void FinishBytes(ByteOutput& output) override;
+
+private:
+    struct TableEntry
+    {
+        uint16_t key;
+        uint16_t length;
+    };
+
+    void BuildTable();
+
+    std::array<TableEntry, 1 << codeLengthLimit> m_table;
+    std::vector<unsigned char> m_inBuffer;
+    std::vector<unsigned char> m_outBuffer;
+    // bits used from the start of m_inBuffer
+    size_t m_position;
+    bool m_eof;
+};
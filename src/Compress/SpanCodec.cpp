@@ -0,0 +1,259 @@
+#include <algorithm>
+#include <cassert>
+
+#include "SpanCodec.h"
+
+void ByteOutput::Begin(std::vector<unsigned char>& output)
+{
+    assert(m_vector == nullptr && m_data == nullptr);
+    m_vector = &output;
+    m_data = output.data();
+    m_size = output.size();
+    m_written = output.size();
+    if (m_pendingPosition < m_pending.size())
+    {
+        Overflow(m_pending.data() + m_pendingPosition, m_pending.size() - m_pendingPosition);
+    }
+    m_pending.clear();
+    m_pendingPosition = 0;
+}
+
+void ByteOutput::Begin(unsigned char* output, const size_t size)
+{
+    assert(m_vector == nullptr && m_data == nullptr);
+    m_data = output;
+    m_size = size;
+    m_written = std::min(size, m_pending.size() - m_pendingPosition);
+    if (m_written > 0)
+    {
+        memcpy(m_data, m_pending.data() + m_pendingPosition, m_written);
+        m_pendingPosition += m_written;
+    }
+    if (m_pendingPosition < m_pending.size())
+    {
+        // the rest of the output has to go after what is still pending
+        m_size = m_written;
+    }
+}
+
+void ByteOutput::End()
+{
+    assert(m_vector != nullptr);
+    m_vector->resize(m_written);
+    m_vector = nullptr;
+    m_data = nullptr;
+    m_size = 0;
+    m_written = 0;
+}
+
+CodecStatus ByteOutput::End(size_t& written)
+{
+    assert(m_vector == nullptr);
+    written = m_written;
+    m_data = nullptr;
+    m_size = 0;
+    m_written = 0;
+    if (m_pendingPosition < m_pending.size())
+    {
+        return CodecStatus::NeedsSpace;
+    }
+    m_pending.clear();
+    m_pendingPosition = 0;
+    return CodecStatus::Done;
+}
+
+void ByteOutput::Take(std::vector<unsigned char>& data)
+{
+    if (m_vector != nullptr && m_written == 0)
+    {
+        m_vector->swap(data);
+        m_data = m_vector->data();
+        m_size = m_vector->size();
+        m_written = m_vector->size();
+    }
+    else
+    {
+        Put(data.data(), data.size());
+    }
+}
+
+void ByteOutput::Overflow(const unsigned char* data, const size_t size)
+{
+    if (m_vector != nullptr)
+    {
+        // only the part in use is resized, the vector grows its capacity geometrically
+        m_vector->resize(std::max(m_written + size, m_vector->size() + m_vector->size() / 2 + 64));
+        m_data = m_vector->data();
+        m_size = m_vector->size();
+        memcpy(m_data + m_written, data, size);
+        m_written += size;
+    }
+    else
+    {
+        // nothing more goes to the caller's buffer
+        m_size = m_written;
+        m_pending.insert(m_pending.end(), data, data + size);
+    }
+}
+
+
+
+SpanCompressor::SpanCompressor()
+    : m_output()
+    , m_vectorOutput()
+    , m_finished(false)
+{
+}
+
+void SpanCompressor::Compress(std::vector<unsigned char>& ioBuffer)
+{
+    m_vectorOutput.clear();
+    m_output.Begin(m_vectorOutput);
+    CompressBytes(ioBuffer.data(), ioBuffer.size(), m_output);
+    m_output.End();
+    ioBuffer.swap(m_vectorOutput);
+}
+
+void SpanCompressor::Finish(std::vector<unsigned char>& ioBuffer)
+{
+    m_vectorOutput.clear();
+    m_output.Begin(m_vectorOutput);
+    CompressBytes(ioBuffer.data(), ioBuffer.size(), m_output);
+    if (!m_finished)
+    {
+        m_finished = true;
+        FinishBytes(m_output);
+    }
+    m_output.End();
+    ioBuffer.swap(m_vectorOutput);
+}
+
+CodecStatus SpanCompressor::Compress(const unsigned char* input, const size_t inputSize, unsigned char* output, const size_t outputSize, size_t& written)
+{
+    m_output.Begin(output, outputSize);
+    CompressBytes(input, inputSize, m_output);
+    return m_output.End(written);
+}
+
+CodecStatus SpanCompressor::Finish(unsigned char* output, const size_t outputSize, size_t& written)
+{
+    m_output.Begin(output, outputSize);
+    if (!m_finished)
+    {
+        m_finished = true;
+        FinishBytes(m_output);
+    }
+    return m_output.End(written);
+}
+
+
+
+SpanDeCompressor::SpanDeCompressor()
+    : m_output()
+    , m_vectorOutput()
+    , m_finished(false)
+{
+}
+
+void SpanDeCompressor::DeCompress(std::vector<unsigned char>& ioBuffer)
+{
+    m_vectorOutput.clear();
+    m_output.Begin(m_vectorOutput);
+    DeCompressBytes(ioBuffer.data(), ioBuffer.size(), m_output);
+    m_output.End();
+    ioBuffer.swap(m_vectorOutput);
+}
+
+void SpanDeCompressor::Finish(std::vector<unsigned char>& ioBuffer)
+{
+    m_vectorOutput.clear();
+    m_output.Begin(m_vectorOutput);
+    DeCompressBytes(ioBuffer.data(), ioBuffer.size(), m_output);
+    if (!m_finished)
+    {
+        m_finished = true;
+        FinishBytes(m_output);
+    }
+    m_output.End();
+    ioBuffer.swap(m_vectorOutput);
+}
+
+CodecStatus SpanDeCompressor::DeCompress(const unsigned char* input, const size_t inputSize, unsigned char* output, const size_t outputSize, size_t& written)
+{
+    m_output.Begin(output, outputSize);
+    DeCompressBytes(input, inputSize, m_output);
+    return m_output.End(written);
+}
+
+CodecStatus SpanDeCompressor::Finish(unsigned char* output, const size_t outputSize, size_t& written)
+{
+    m_output.Begin(output, outputSize);
+    if (!m_finished)
+    {
+        m_finished = true;
+        FinishBytes(m_output);
+    }
+    return m_output.End(written);
+}
+
+
+
+VectorCompressor::VectorCompressor()
+    : m_output()
+    , m_buffer()
+    , m_finished(false)
+{
+}
+
+CodecStatus VectorCompressor::Compress(const unsigned char* input, const size_t inputSize, unsigned char* output, const size_t outputSize, size_t& written)
+{
+    m_buffer.assign(input, input + inputSize);
+    Compress(m_buffer);
+    m_output.Begin(output, outputSize);
+    m_output.Put(m_buffer.data(), m_buffer.size());
+    return m_output.End(written);
+}
+
+CodecStatus VectorCompressor::Finish(unsigned char* output, const size_t outputSize, size_t& written)
+{
+    m_buffer.clear();
+    if (!m_finished)
+    {
+        m_finished = true;
+        Finish(m_buffer);
+    }
+    m_output.Begin(output, outputSize);
+    m_output.Put(m_buffer.data(), m_buffer.size());
+    return m_output.End(written);
+}
+
+
+
+VectorDeCompressor::VectorDeCompressor()
+    : m_output()
+    , m_buffer()
+    , m_finished(false)
+{
+}
+
+CodecStatus VectorDeCompressor::DeCompress(const unsigned char* input, const size_t inputSize, unsigned char* output, const size_t outputSize, size_t& written)
+{
+    m_buffer.assign(input, input + inputSize);
+    DeCompress(m_buffer);
+    m_output.Begin(output, outputSize);
+    m_output.Put(m_buffer.data(), m_buffer.size());
+    return m_output.End(written);
+}
+
+CodecStatus VectorDeCompressor::Finish(unsigned char* output, const size_t outputSize, size_t& written)
+{
+    m_buffer.clear();
+    if (!m_finished)
+    {
+        m_finished = true;
+        Finish(m_buffer);
+    }
+    m_output.Begin(output, outputSize);
+    m_output.Put(m_buffer.data(), m_buffer.size());
+    return m_output.End(written);
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+
+#include "ICompress.h"
+
+// base classes for the two ways to use a codec
+//   SpanCompressor/SpanDeCompressor     : the codec works on byte ranges, the vector calls are adapters
+//   VectorCompressor/VectorDeCompressor : the codec works on vectors, the span calls are adapters
+
+// where a codec writes its output: appended to a vector, or into a caller's buffer. what doesn't fit
+// the caller's buffer is kept, and written first on the next Begin.
+class ByteOutput
+{
+public:
+    ByteOutput()
+        : m_vector(nullptr)
+        , m_data(nullptr)
+        , m_size(0)
+        , m_written(0)
+        , m_pending()
+        , m_pendingPosition(0)
+    {}
+
+    void Begin(std::vector<unsigned char>& output);
+    void Begin(unsigned char* output, const size_t size);
+    // for a vector
+    void End();
+    // for a caller's buffer, 'written' is set to the bytes written to it
+    CodecStatus End(size_t& written);
+
+    void Put(const unsigned char value)
+    {
+        if (m_written < m_size)
+        {
+            m_data[m_written++] = value;
+        }
+        else
+        {
+            Overflow(&value, 1);
+        }
+    }
+    void Put(const unsigned char* data, const size_t size)
+    {
+        const size_t fits = std::min(size, m_size - m_written);
+        if (fits > 0)
+        {
+            memcpy(m_data + m_written, data, fits);
+            m_written += fits;
+        }
+        if (fits < size)
+        {
+            Overflow(data + fits, size - fits);
+        }
+    }
+    // put all of data, which is left with unspecified contents: an empty output vector is swapped with it
+    void Take(std::vector<unsigned char>& data);
+
+private:
+    // grow the vector, or keep the data for the next call
+    void Overflow(const unsigned char* data, const size_t size);
+
+    std::vector<unsigned char>* m_vector;
+    unsigned char* m_data;
+    size_t m_size;
+    size_t m_written;
+    std::vector<unsigned char> m_pending;
+    // bytes of m_pending which are written
+    size_t m_pendingPosition;
+};
+
+class SpanCompressor : public ICompressor
+{
+public:
+    void Compress(std::vector<unsigned char>& ioBuffer) final;
+    void Finish(std::vector<unsigned char>& ioBuffer) final;
+    CodecStatus Compress(const unsigned char* input, const size_t inputSize, unsigned char* output, const size_t outputSize, size_t& written) final;
+    CodecStatus Finish(unsigned char* output, const size_t outputSize, size_t& written) final;
+
+    // compress all of data
+    virtual void CompressBytes(const unsigned char* data, const size_t size, ByteOutput& output) = 0;
+    // write what is left, called once
+    virtual void FinishBytes(ByteOutput& output) = 0;
+
+protected:
+    SpanCompressor();
+
+private:
+    ByteOutput m_output;
+    std::vector<unsigned char> m_vectorOutput;
+    bool m_finished;
+};
+
+class SpanDeCompressor : public IDeCompressor
+{
+public:
+    void DeCompress(std::vector<unsigned char>& ioBuffer) final;
+    void Finish(std::vector<unsigned char>& ioBuffer) final;
+    CodecStatus DeCompress(const unsigned char* input, const size_t inputSize, unsigned char* output, const size_t outputSize, size_t& written) final;
+    CodecStatus Finish(unsigned char* output, const size_t outputSize, size_t& written) final;
+
+    // decompress all of data
+    virtual void DeCompressBytes(const unsigned char* data, const size_t size, ByteOutput& output) = 0;
+    // write what is left and check the data is complete, called once
+    virtual void FinishBytes(ByteOutput& output) = 0;
+
+protected:
+    SpanDeCompressor();
+
+private:
+    ByteOutput m_output;
+    std::vector<unsigned char> m_vectorOutput;
+    bool m_finished;
+};
+
+class VectorCompressor : public ICompressor
+{
+public:
+    using ICompressor::Compress;
+    using ICompressor::Finish;
+    CodecStatus Compress(const unsigned char* input, const size_t inputSize, unsigned char* output, const size_t outputSize, size_t& written) final;
+    CodecStatus Finish(unsigned char* output, const size_t outputSize, size_t& written) final;
+
+protected:
+    VectorCompressor();
+
+private:
+    ByteOutput m_output;
+    std::vector<unsigned char> m_buffer;
+    bool m_finished;
+};
+
+class VectorDeCompressor : public IDeCompressor
+{
+public:
+    using IDeCompressor::DeCompress;
+    using IDeCompressor::Finish;
+    CodecStatus DeCompress(const unsigned char* input, const size_t inputSize, unsigned char* output, const size_t outputSize, size_t& written) final;
+    CodecStatus Finish(unsigned char* output, const size_t outputSize, size_t& written) final;
+
+protected:
+    VectorDeCompressor();
+
+private:
+    ByteOutput m_output;
+    std::vector<unsigned char> m_buffer;
+    bool m_finished;
+};
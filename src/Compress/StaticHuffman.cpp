@@ -1,205 +1,337 @@
 ﻿#include <algorithm>
 #include <array>
 #include <cassert>
+#include <cmath>
 #include <deque>
 #include <stdexcept>
 #include <string>
 
+#include "Histogram.h"
 #include "StaticHuffman.h"
 
+const unsigned int StaticHuffmanDeCompressor::tableBits;
+
 StaticHuffmanCompressor::StaticHuffmanCompressor()
+    : m_level(CompressionLevel::Normal)
+    , m_haveLengths(false)
 {
-    m_nodes.reserve(keyCount);
+    // the marker stays in the writer until the first output
+    m_writer.Begin(m_outBuffer);
+    m_writer.Write(1u, 1u);
+    m_writer.Write(version, 3u);
+    m_writer.End();
 }
 
-void StaticHuffmanCompressor::ClearKeys()
+void StaticHuffmanCompressor::SetLevel(CompressionLevel level)
 {
-    for (unsigned int i = 0; i < 256; ++i)
-    {
-        m_keys[i].count = 0;
-    }
-    m_keys[keyEnd].count = 1;
+    m_level = level;
 }
 
-void StaticHuffmanCompressor::BuildTree()
+void StaticHuffmanCompressor::Count(const unsigned char* begin, const unsigned char* end, Counts& counts)
 {
-    m_nodes.clear();
-    // add nodes for all used keys
-    for (unsigned int i = 0; i < keyCount; ++i)
-    {
-        if (m_keys[i].count > 0)
-        {
-            m_keys[i].bits.Clear();
-            m_nodes.emplace_back(&m_nodeCache[m_nodes.size()]);
-            m_nodes.back()->key = i;
-            m_nodes.back()->type = NodeType::leaf;
-        }
-    }
-    // sort nodes, these are all 'key nodes'
-    std::sort(m_nodes.begin(), m_nodes.end(), [](Node* a, Node* b)
-    {
-        assert(a->type == NodeType::leaf);
-        assert(b->type == NodeType::leaf);
-        return (a->count > b->count) || (a->count == b->count && a->key < b->key);
-    });
-    // repeatedly join the 2 least important nodes until there is one node left
-    Node* node = nullptr;
-    for (size_t nodeCount = m_nodes.size(); nodeCount >= 2; --nodeCount)
-    {
-        assert(m_nodes.size() < m_nodeCache.size());
-        node = &m_nodeCache[m_nodes.size()];
-        node->type = NodeType::branch;
-        node->node[0] = m_nodes[nodeCount - 2];
-        node->node[1] = m_nodes[nodeCount - 1];
-        auto iter = std::lower_bound(m_nodes.begin(), m_nodes.begin() + nodeCount - 2, node, [](Node* a, Node* b)
-        {
-            return (a->count > b->count);
-        });
-        m_nodes.emplace(iter, node);
-    }
-    m_tree = node;
-    // fill bits
-    struct LocalFunctions
+    Histogram::Count(begin, end - begin, counts.data());
+}
+
+void StaticHuffmanCompressor::BuildCodes()
+{
+    HuffmanCode::CanonicalCodes(m_lengths.data(), keyCount, m_codes.data());
+    for (unsigned int key = 0; key < keyCount; ++key)
     {
-        static void FillBits(Keys& keys, Node* node, unsigned int index, BitFiFo bits)
+        uint32_t bits = 0;
+        for (unsigned int bit = 0; bit < m_lengths[key]; ++bit)
         {
-            bits.Push(index, 1u);
-            if (node->type == NodeType::leaf)
-            {
-                keys[node->key].bits.Swap(bits);
-            }
-            else
-            {
-                FillBits(keys, node->node[0], 0, bits);
-                FillBits(keys, node->node[1], 1, bits);
-            }
+            bits = (bits << 1) | ((m_codes[key] >> bit) & 1);
         }
-    };
-    BitFiFo bits;
-    LocalFunctions::FillBits(m_keys, m_tree->node[0], 0, bits);
-    LocalFunctions::FillBits(m_keys, m_tree->node[1], 1, bits);
+        m_keys[key].bits = bits;
+        m_keys[key].length = m_lengths[key];
+    }
 }
 
-void StaticHuffmanCompressor::WriteTree(BitFiFo& buffer) const
+void StaticHuffmanCommon::WriteLengths(BitWriter& writer, const unsigned int* lengths, const size_t count)
 {
-    class Helper
+    unsigned int previous = 0;
+    size_t key = 0;
+    while (key < count)
     {
-    public:
-        Helper(BitFiFo& buffer)
-            : m_buffer(buffer)
-        {}
-
-        void WriteNode(const Node& node)
+        const unsigned int length = lengths[key];
+        unsigned int run = 1;
+        while (key + run < count && lengths[key + run] == length)
         {
-            if (node.type == NodeType::branch)
+            ++run;
+        }
+        if (length == 0 && run >= 2 && (previous != 0 || run >= 10))
+        {
+            run = std::min(run, 256u);
+            writer.Write(0xFu, 4u);
+            writer.Write(run - 1, 8u);
+        }
+        else if (length == previous)
+        {
+            if (run >= 2)
             {
-                m_buffer.PushBit(false);
-                WriteNode(*node.node[0]);
-                WriteNode(*node.node[1]);
+                run = std::min(run, 9u);
+                writer.Write(2u, 2u);
+                writer.Write(run - 2, 3u);
             }
             else
             {
-                m_buffer.PushBit(true);
-                m_buffer.Push(node.key, 9u);
+                writer.Write(0u, 2u);
             }
         }
-    private:
-        BitFiFo& m_buffer;
-    };
-    Helper(buffer).WriteNode(*m_tree);
+        else if (length == previous + 1)
+        {
+            run = 1;
+            writer.Write(1u, 2u);
+        }
+        else if (length + 1 == previous)
+        {
+            run = 1;
+            writer.Write(3u, 3u);
+        }
+        else
+        {
+            run = 1;
+            writer.Write(7u, 4u);
+            writer.Write(length, 5u);
+        }
+        previous = length;
+        key += run;
+    }
 }
 
-void StaticHuffmanCompressor::WriteKeyUsingTree(BitFiFo& buffer, unsigned int key) const
+void StaticHuffmanCompressor::WriteKeyUsingTree(BitWriter& writer, unsigned int key) const
 {
-    buffer.Push(m_keys[key].bits);
+    writer.Write(m_keys[key].bits, m_keys[key].length);
 }
 
-void StaticHuffmanCompressor::CompressBuffer(std::vector<unsigned char>::const_iterator begin, std::vector<unsigned char>::const_iterator end)
+size_t StaticHuffmanCompressor::HeaderBits(const Lengths& lengths)
 {
-    ClearKeys();
-    for (auto iter = begin; iter!=end; ++iter)
+    m_scratch.clear();
+    BitWriter writer;
+    writer.Begin(m_scratch);
+    WriteLengths(writer, lengths.data(), keyCount);
+    writer.End(true);
+    return 8 * m_scratch.size();
+}
+
+double StaticHuffmanCompressor::Cost(const Counts& counts)
+{
+    if (m_level == CompressionLevel::Max)
     {
-        ++m_keys[*iter].count;
+        Lengths lengths;
+        HuffmanCode::LimitedLengths(counts.data(), keyCount, codeLengthLimit, lengths.data());
+        uint64_t bits = HeaderBits(lengths);
+        for (unsigned int key = 0; key < keyCount; ++key)
+        {
+            bits += counts[key] * lengths[key];
+        }
+        return static_cast<double>(bits);
     }
-    BuildTree();
-    WriteTree(m_outBuffer);
-    for (auto iter = begin; iter != end; ++iter)
+    uint64_t total = 0;
+    for (const auto count : counts)
     {
-        WriteKeyUsingTree(m_outBuffer,*iter);
+        total += count;
     }
+    double bits = 0;
+    for (const auto count : counts)
+    {
+        if (count > 0)
+        {
+            bits += 4 + count * std::log2(static_cast<double>(total) / count);
+        }
+    }
+    return bits;
 }
 
-void StaticHuffmanCompressor::Compress(std::vector<unsigned char>& ioBuffer)
+size_t StaticHuffmanCompressor::ChooseBlock(const unsigned char* data, const size_t size, Counts& counts)
 {
-    std::vector<unsigned char>::iterator begin;
-    std::vector<unsigned char>::iterator end;
-    if (!m_inBuffer.empty())
+    counts.fill(0);
+    counts[keyEnd] = 1;
+    if (m_level == CompressionLevel::Fast)
+    {
+        const size_t keys = std::min<size_t>(size, stepSegments * segmentSize);
+        Count(data, data + keys, counts);
+        return keys;
+    }
+    // every block costs a table build when decoding, so only Max tries blocks of a single segment
+    const size_t step = (m_level == CompressionLevel::Max ? 1 : stepSegments) * segmentSize;
+    size_t keys = std::min<size_t>(size, step);
+    Count(data, data + keys, counts);
+    double cost = Cost(counts);
+    while (keys < size && keys < maxSegments * segmentSize)
     {
-        if (m_inBuffer.size() + ioBuffer.size() < blockSize)
+        // add the next step, unless a block of its own is cheaper
+        const size_t next = std::min<size_t>(size - keys, step);
+        Counts segment = {};
+        segment[keyEnd] = 1;
+        Count(data + keys, data + keys + next, segment);
+        Counts merged;
+        for (unsigned int key = 0; key < keyCount; ++key)
         {
-            m_inBuffer.insert(m_inBuffer.end(), ioBuffer.begin(), ioBuffer.end());
-            begin = end = std::end(ioBuffer);
+            merged[key] = counts[key] + segment[key];
         }
-        else
+        merged[keyEnd] = 1;
+        const double mergedCost = Cost(merged);
+        if (mergedCost > cost + Cost(segment))
         {
-            begin = std::begin(ioBuffer);
-            end = begin + blockSize - m_inBuffer.size();
-            m_inBuffer.insert(m_inBuffer.end(), begin, end);
-            CompressBuffer(m_inBuffer.begin(), m_inBuffer.end());
-            m_inBuffer.clear();
+            break;
         }
+        counts = merged;
+        cost = mergedCost;
+        keys += next;
     }
-    else
+    return keys;
+}
+
+size_t StaticHuffmanCompressor::CompressBlock(const unsigned char* data, const size_t size, const bool final, bool& last)
+{
+    Counts counts;
+    const size_t keys = ChooseBlock(data, size, counts);
+    // the last block has room for the end key
+    last = final && keys == size && keys < maxSegments * segmentSize;
+    assert(last || (keys > 0 && keys % segmentSize == 0));
+    m_writer.Reserve(64 + 12 * keyCount + codeLengthLimit * (keys + 1));
+    m_writer.Write(last ? keys / segmentSize : keys / segmentSize - 1, segmentBits);
+
+    Lengths lengths;
+    HuffmanCode::LimitedLengths(counts.data(), keyCount, codeLengthLimit, lengths.data());
+    bool repeat = false;
+    if (m_haveLengths)
+    {
+        // the lengths of the last block need codes for all keys of this block
+        uint64_t previousBits = 0;
+        uint64_t bits = HeaderBits(lengths);
+        repeat = true;
+        for (unsigned int key = 0; key < keyCount; ++key)
+        {
+            repeat = repeat && (counts[key] == 0 || m_lengths[key] > 0);
+            previousBits += counts[key] * m_lengths[key];
+            bits += counts[key] * lengths[key];
+        }
+        repeat = repeat && previousBits <= bits;
+    }
+    m_writer.Write(repeat ? 1u : 0u, 1u);
+    if (!repeat)
+    {
+        m_lengths = lengths;
+        m_haveLengths = true;
+        BuildCodes();
+        WriteLengths(m_writer, m_lengths.data(), keyCount);
+    }
+
+    // codes are at most 15 bits, so three of them fit the writer between flushes
+    static_assert(3 * codeLengthLimit <= 56, "codes don't fit the writer");
+    const unsigned char* iter = data;
+    const unsigned char* end = data + keys;
+    for (; end - iter >= 3; iter += 3)
     {
-        begin = end = std::begin(ioBuffer);
+        const Key& k0 = m_keys[iter[0]];
+        const Key& k1 = m_keys[iter[1]];
+        const Key& k2 = m_keys[iter[2]];
+        m_writer.Add(k0.bits, k0.length);
+        m_writer.Add(k1.bits, k1.length);
+        m_writer.Add(k2.bits, k2.length);
+        m_writer.Flush();
     }
-    while (std::distance(end,ioBuffer.end()) >= blockSize)
+    for (; iter != end; ++iter)
     {
-        begin = end;
-        end += blockSize;
-        CompressBuffer(begin, end);
+        WriteKeyUsingTree(m_writer, *iter);
     }
-    if (end != ioBuffer.end())
+    if (last)
     {
-        m_inBuffer.insert(m_inBuffer.end(), end, ioBuffer.end());
+        WriteKeyUsingTree(m_writer, keyEnd);
     }
-    ioBuffer.clear();
-    m_outBuffer.Pop(ioBuffer);
-    m_outBuffer.Optimize();
+    return keys;
 }
 
-void StaticHuffmanCompressor::Finish(std::vector<unsigned char>& ioBuffer)
+void StaticHuffmanCompressor::CompressBytes(const unsigned char* data, const size_t size, ByteOutput& output)
 {
-    Compress(ioBuffer);
-
+    const size_t longestBlock = maxSegments * segmentSize;
+    m_outBuffer.clear();
+    m_writer.Begin(m_outBuffer);
+    // a block is only chosen when the longest block fits
+    size_t position = 0;
+    bool last = false;
     if (!m_inBuffer.empty())
     {
-        CompressBuffer(m_inBuffer.cbegin(), m_inBuffer.cend());
+        // the buffered keys are followed by at most a longest block, the blocks which start after
+        // the buffered keys are compressed from data
+        const size_t buffered = m_inBuffer.size();
+        const size_t used = std::min<size_t>(size, longestBlock);
+        m_inBuffer.insert(m_inBuffer.end(), data, data + used);
+        while (position < buffered && m_inBuffer.size() - position >= longestBlock)
+        {
+            position += CompressBlock(m_inBuffer.data() + position, m_inBuffer.size() - position, false, last);
+        }
+        if (position < buffered)
+        {
+            // all of data is buffered
+            m_inBuffer.erase(m_inBuffer.begin(), m_inBuffer.begin() + position);
+            position = size;
+        }
+        else
+        {
+            m_inBuffer.clear();
+            position -= buffered;
+        }
     }
+    if (position < size)
+    {
+        while (size - position >= longestBlock)
+        {
+            position += CompressBlock(data + position, size - position, false, last);
+        }
+        m_inBuffer.assign(data + position, data + size);
+    }
+    m_writer.End();
+    output.Take(m_outBuffer);
+}
 
-    WriteKeyUsingTree(m_outBuffer,keyEnd);
-    m_outBuffer.Pop(ioBuffer,true);
+void StaticHuffmanCompressor::FinishBytes(ByteOutput& output)
+{
+    // the end is written in the last block, which can be empty
+    m_outBuffer.clear();
+    m_writer.Begin(m_outBuffer);
+    size_t position = 0;
+    bool last = false;
+    while (!last)
+    {
+        position += CompressBlock(m_inBuffer.data() + position, m_inBuffer.size() - position, true, last);
+    }
+    m_inBuffer.clear();
+    m_writer.End(true);
+    output.Take(m_outBuffer);
 }
 
 
 
 StaticHuffmanDeCompressor::StaticHuffmanDeCompressor()
-    : m_currentNode(nullptr)
+    : m_format(Format::Unknown)
+    , m_lengths()
+    , m_codes()
+    , m_table()
+    , m_rootBits(0)
     , m_inBuffer()
+    , m_outBuffer()
+    , m_position(0)
+    , m_haveTree(false)
+    , m_haveLengths(false)
+    , m_started(false)
+    , m_eof(false)
+    , m_blockSize(blockSize)
     , m_blockCount(0)
 {
 }
 
-
-bool StaticHuffmanDeCompressor::ReadTree()
+bool StaticHuffmanDeCompressor::ReadTree(BitReader& reader)
 {
     class Helper
     {
     public:
-        Helper(BitFiFo& buffer,
+        Helper(BitReader& reader,
                NodeCache& nodeCache)
             : m_index(0)
-            , m_buffer(buffer)
+            , m_reader(reader)
             , m_nodeCache(nodeCache)
         {}
 
@@ -210,14 +342,18 @@ bool StaticHuffmanDeCompressor::ReadTree()
     private:
         Node* ReadNode()
         {
-            if (m_buffer.Size() < 10)
+            if (m_reader.Available() < 10)
             {
                 return nullptr;
             }
+            if (m_index >= m_nodeCache.size())
+            {
+                throw std::runtime_error("Invalid data");
+            }
             Node& node = m_nodeCache[m_index];
             ++m_index;
             node.count = 0;
-            node.type = m_buffer.PopBit() == 0 ? NodeType::branch : NodeType::leaf;
+            node.type = m_reader.Pop(1) == 0 ? NodeType::branch : NodeType::leaf;
             if (node.type == NodeType::branch)
             {
                 if ((node.node[0] = ReadNode()) == nullptr ||
@@ -225,185 +361,446 @@ bool StaticHuffmanDeCompressor::ReadTree()
                 {
                     return nullptr;
                 }
+                node.height = 1 + std::max(node.node[0]->height, node.node[1]->height);
             }
             else
             {
-                node.key = m_buffer.Pop(9u);
+                node.key = static_cast<unsigned int>(m_reader.Pop(9u));
+                if (node.key >= keyCount)
+                {
+                    throw std::runtime_error("Invalid data");
+                }
+                node.height = 0;
             }
             return &node;
         }
 
     private:
         unsigned int m_index = 0;
-        BitFiFo& m_buffer;
+        BitReader& m_reader;
         NodeCache& m_nodeCache;
     };
-    if (m_inBuffer.Size() >= keyCount * 2)
+    // read from a copy, so nothing is used when the tree isn't complete yet
+    BitReader tempReader(reader);
+    Helper helper(tempReader, m_nodeCache);
+    if (nullptr != (m_tree = helper.ReadTree()))
     {
-        Helper helper(m_inBuffer, m_nodeCache);
-        if (nullptr != (m_tree = helper.ReadTree()))
+        if (m_tree->type != NodeType::branch)
         {
-            FillStartNodes();
-            return true;
+            throw std::runtime_error("Invalid data");
         }
+        reader = tempReader;
+        return true;
+    }
+    return false;
+}
+
+bool StaticHuffmanDeCompressor::ReadFormat(BitReader& reader)
+{
+    if (reader.Available() < 4)
+    {
+        return false;
+    }
+    reader.Refill();
+    if (reader.Peek(1) == 0)
+    {
+        // no marker, the first bit is the root of a tree
+        m_format = Format::Tree;
     }
     else
     {
-        BitFiFo tempBuffer(m_inBuffer);
-        Helper helper(tempBuffer, m_nodeCache);
-        if (nullptr != (m_tree = helper.ReadTree()))
+        reader.Skip(1);
+        switch (reader.Pop(3))
         {
-            tempBuffer.Swap(m_inBuffer);
-            FillStartNodes();
-            return true;
+        case 1:
+            m_format = Format::Canonical;
+            break;
+        case version:
+            m_format = Format::Segments;
+            break;
+        default:
+            throw std::runtime_error("Unsupported version");
         }
     }
-    return false;
+    return true;
 }
 
-void StaticHuffmanDeCompressor::DeCompress(std::vector<unsigned char>& ioBuffer)
+bool StaticHuffmanDeCompressor::ReadBlockHeader(BitReader& reader)
 {
-    m_inBuffer.Push(ioBuffer,static_cast<unsigned int>(ioBuffer.size()*8));
-    ioBuffer.clear();
-    bool run = true;
-    if (m_currentNode == nullptr)
+    if (m_format != Format::Segments)
+    {
+        if (!(m_format == Format::Tree ? ReadTree(reader) : ReadLengths(reader)))
+        {
+            return false;
+        }
+        BuildTable();
+        m_blockSize = blockSize;
+        return true;
+    }
+    // read from a copy, so nothing is used when the header isn't complete yet
+    BitReader tempReader(reader);
+    if (tempReader.Available() < segmentBits + 1)
+    {
+        return false;
+    }
+    tempReader.Refill();
+    const size_t segments = 1 + static_cast<size_t>(tempReader.Pop(segmentBits));
+    if (tempReader.Pop(1) != 0)
     {
-        run = run && ReadTree();
-        if (run)
+        if (!m_haveLengths)
         {
-            m_currentNode = m_tree;
-            assert(nullptr != m_currentNode);
+            throw std::runtime_error("Invalid data");
         }
     }
-    while (run)
+    else
+    {
+        if (!ReadLengths(tempReader))
+        {
+            return false;
+        }
+        BuildTable();
+        m_haveLengths = true;
+    }
+    m_blockSize = segments * segmentSize;
+    reader = tempReader;
+    return true;
+}
+
+bool StaticHuffmanCommon::ReadLengths(BitReader& reader, unsigned int* lengths, const size_t count)
+{
+    // read from a copy, so nothing is used when the lengths aren't complete yet
+    BitReader tempReader(reader);
+    bool complete = true;
+    auto Read = [&tempReader, &complete](const unsigned int bits)
     {
-        if (m_currentNode->type == NodeType::branch)
+        if (tempReader.Available() < bits)
         {
-            unsigned int index;
-            while(run && m_currentNode->type != NodeType::leaf)
+            complete = false;
+            return 0u;
+        }
+        return static_cast<unsigned int>(tempReader.Pop(bits));
+    };
+    unsigned int previous = 0;
+    size_t key = 0;
+    while (complete && key < count)
+    {
+        unsigned int length = previous;
+        unsigned int run = 1;
+        if (Read(1) == 0)
+        {
+            if (Read(1) != 0)
             {
-                run = m_inBuffer.TryPopBit(index);
-                if (run)
-                {
-                    m_currentNode = m_currentNode->node[index];
-                }
+                run = 2 + Read(3);
             }
         }
+        else if (Read(1) == 0)
+        {
+            length = previous + 1;
+        }
+        else if (Read(1) == 0)
+        {
+            length = previous - 1;
+        }
+        else if (Read(1) == 0)
+        {
+            length = Read(5);
+        }
         else
         {
-            switch (m_currentNode->key)
+            length = 0;
+            run = 1 + Read(8);
+        }
+        if (complete)
+        {
+            if (key + run > count || length > maxCodeLength)
             {
-            case keyEnd:
-                // see if the filling bits are 0
-                if (m_inBuffer.Size() < 8)
-                {
-                    unsigned int i = m_inBuffer.Pop(static_cast<unsigned int>(m_inBuffer.Size()));
-                    if (i != 0)
-                    {
-                        throw std::runtime_error("Invalid data");
-                    }
-                }
-                else
-                {
-                    throw std::runtime_error("Data after end");
-                }
-                // stop any further actions.
-                run = false;
-                break;
-            default:
-                ioBuffer.emplace_back(static_cast<unsigned char>(m_currentNode->key));
-                m_blockCount++;
-                if (m_blockCount >= blockSize)
-                {
-                    m_currentNode = nullptr;
-                    m_blockCount = 0;
-                    run = run && ReadTree();
-                }
-                if (run)
-                {
-                    unsigned int index;
-                    if (m_inBuffer.TryPeek(index, startNodeBits))
-                    {
-                        m_currentNode = m_startNodes[index];
-                        m_inBuffer.Pop(m_currentNode->depth);
-                    }
-                    else
-                    {
-                        m_currentNode = m_tree;
-                    }
-                }
-                else
-                {
-                    m_currentNode = m_tree;
-                }
-                break;
+                throw std::runtime_error("Invalid data");
             }
+            std::fill(lengths + key, lengths + key + run, length);
+            previous = length;
+            key += run;
         }
     }
-    m_inBuffer.Optimize();
+    if (!complete)
+    {
+        return false;
+    }
+    reader = tempReader;
+    return true;
 }
 
-void StaticHuffmanDeCompressor::Finish(std::vector<unsigned char>& ioBuffer)
+bool StaticHuffmanDeCompressor::ReadLengths(BitReader& reader)
 {
-    DeCompress(ioBuffer);
-    if (!m_inBuffer.Empty() ||
-        (m_currentNode != nullptr && (m_currentNode->type == NodeType::branch || m_currentNode->key != keyEnd)))
+    if (!StaticHuffmanCommon::ReadLengths(reader, m_lengths.data(), keyCount))
     {
-        throw std::runtime_error("Incomplete data");
+        return false;
+    }
+    BuildTreeFromLengths();
+    return true;
+}
+
+void StaticHuffmanDeCompressor::BuildTreeFromLengths()
+{
+    HuffmanCode::CanonicalCodes(m_lengths.data(), keyCount, m_codes.data());
+    size_t used = 0;
+    auto NewNode = [this, &used](const NodeType type)
+    {
+        if (used >= m_nodeCache.size())
+        {
+            throw std::runtime_error("Invalid data");
+        }
+        Node* node = &m_nodeCache[used++];
+        node->type = type;
+        node->count = 0;
+        node->height = 0;
+        if (type == NodeType::branch)
+        {
+            node->node[0] = nullptr;
+            node->node[1] = nullptr;
+        }
+        return node;
+    };
+    m_tree = NewNode(NodeType::branch);
+    const auto keys = keyCount - std::count(m_lengths.begin(), m_lengths.end(), 0u);
+    if (keys == 0)
+    {
+        throw std::runtime_error("Invalid data");
+    }
+    // add each code to the tree, the first bit selects the branch of the root
+    for (unsigned int key = 0; key < keyCount; ++key)
+    {
+        const unsigned int length = m_lengths[key];
+        if (length == 0)
+        {
+            continue;
+        }
+        Node* node = m_tree;
+        for (unsigned int bit = length; bit-- > 0; )
+        {
+            Node*& next = node->node[(m_codes[key] >> bit) & 1];
+            if (next != nullptr && (bit == 0 || next->type == NodeType::leaf))
+            {
+                throw std::runtime_error("Invalid data");
+            }
+            if (bit == 0)
+            {
+                next = NewNode(NodeType::leaf);
+                next->key = key;
+            }
+            else if (next == nullptr)
+            {
+                next = NewNode(NodeType::branch);
+            }
+            node = next;
+        }
+    }
+    if (keys == 1 && m_tree->node[1] == nullptr && m_tree->node[0]->type == NodeType::leaf)
+    {
+        // a single key has a 1 bit code, the other bit is never used
+        m_tree->node[1] = m_tree->node[0];
     }
+    struct LocalFunctions
+    {
+        // all branches need two nodes
+        static unsigned int FillHeight(Node* node)
+        {
+            if (node == nullptr)
+            {
+                throw std::runtime_error("Invalid data");
+            }
+            if (node->type == NodeType::branch)
+            {
+                node->height = 1 + std::max(FillHeight(node->node[0]), FillHeight(node->node[1]));
+            }
+            return node->height;
+        }
+    };
+    LocalFunctions::FillHeight(m_tree);
 }
 
-void StaticHuffmanDeCompressor::FillStartNodes()
+void StaticHuffmanDeCompressor::BuildTable()
 {
-    // todo: turn this into a recursive template
+    // every table is indexed by the next bits of the code, a code which is shorter than the index
+    // fills all entries which start with it. branches at the end of the index get a table of their own.
     class Helper
     {
     public:
-        inline
-            static void Fill(Nodes& nodes, Node* tree)
+        Helper(std::vector<TableEntry>& table)
+            : m_table(table)
+        {}
+
+        size_t AddTable(const Node* node, const unsigned int bits)
         {
-            FillBranch(nodes, tree->node[0], 0, 1);
-            FillBranch(nodes, tree->node[1], 1, 1);
+            const size_t offset = m_table.size();
+            if (offset + (size_t(1) << bits) > 0x10000)
+            {
+                throw std::runtime_error("Invalid data");
+            }
+            m_table.resize(offset + (size_t(1) << bits));
+            Fill(node->node[0], offset, bits, 0, 1);
+            Fill(node->node[1], offset, bits, 1, 1);
+            return offset;
         }
     private:
-        inline
-            static void FillBranch(Nodes& nodes, Node* node, const unsigned int index, const unsigned int depth)
+        void Fill(const Node* node, const size_t offset, const unsigned int bits, const unsigned int code, const unsigned int length)
         {
-            if (depth < startNodeBits)
+            if (node->type == NodeType::leaf)
             {
-                if (node->type == NodeType::branch)
+                const TableEntry entry = { static_cast<uint16_t>(node->key), static_cast<uint8_t>(length), 0 };
+                for (size_t index = code; index < (size_t(1) << bits); index += size_t(1) << length)
                 {
-                    FillBranch(nodes, node->node[0], index, depth + 1);
-                    FillBranch(nodes, node->node[1], index | 1 << depth, depth + 1);
-                }
-                else
-                {
-                    node->depth = depth;
-                    FillLeaf(nodes, node, index, depth + 1);
-                    FillLeaf(nodes, node, index | 1 << depth, depth + 1);
+                    m_table[offset + index] = entry;
                 }
             }
+            else if (length == bits)
+            {
+                const unsigned int nextBits = std::min(tableBits, node->height);
+                const size_t next = AddTable(node, nextBits);
+                m_table[offset + code] = { static_cast<uint16_t>(next), static_cast<uint8_t>(length), static_cast<uint8_t>(nextBits) };
+            }
             else
             {
-                node->depth = depth;
-                nodes[index] = node;
+                Fill(node->node[0], offset, bits, code, length + 1);
+                Fill(node->node[1], offset, bits, code | (1 << length), length + 1);
+            }
+        }
+
+        std::vector<TableEntry>& m_table;
+    };
+    m_table.clear();
+    m_rootBits = std::min(tableBits, m_tree->height);
+    Helper(m_table).AddTable(m_tree, m_rootBits);
+}
+
+bool StaticHuffmanDeCompressor::DecodeKey(BitReader& reader, unsigned int& key) const
+{
+    reader.Refill();
+    if (reader.Available() >= m_tree->height)
+    {
+        // the whole code is available, no need to check every table
+        const TableEntry* entry = &m_table[reader.Peek(m_rootBits)];
+        while (entry->bits != 0)
+        {
+            reader.Skip(entry->length);
+            reader.Refill();
+            entry = &m_table[entry->value + reader.Peek(entry->bits)];
+        }
+        reader.Skip(entry->length);
+        key = entry->value;
+        return true;
+    }
+    else
+    {
+        BitReader tempReader(reader);
+        const TableEntry* entry = &m_table[tempReader.Peek(m_rootBits)];
+        while (entry->length <= tempReader.Available())
+        {
+            tempReader.Skip(entry->length);
+            if (entry->bits == 0)
+            {
+                key = entry->value;
+                reader = tempReader;
+                return true;
             }
+            tempReader.Refill();
+            entry = &m_table[entry->value + tempReader.Peek(entry->bits)];
         }
-        inline
-            static void FillLeaf(Nodes& nodes, Node* node, const unsigned int index, const unsigned int depth)
+        return false;
+    }
+}
+
+void StaticHuffmanDeCompressor::DeCompressBytes(const unsigned char* data, const size_t size, ByteOutput& output)
+{
+    m_inBuffer.insert(m_inBuffer.end(), data, data + size);
+    m_outBuffer.clear();
+    BitReader reader(m_inBuffer.data(), m_inBuffer.size(), m_position);
+    while (!m_eof)
+    {
+        if (m_format == Format::Unknown)
         {
-            if (depth < startNodeBits)
+            if (!ReadFormat(reader))
             {
-                FillLeaf(nodes, node, index, depth + 1);
-                FillLeaf(nodes, node, index | 1 << depth, depth + 1);
+                break;
             }
-            else
+            m_started = true;
+        }
+        if (!m_haveTree)
+        {
+            if (!ReadBlockHeader(reader))
             {
-                nodes[index] = node;
+                break;
             }
+            m_haveTree = true;
         }
-    };
-    m_startNodes.resize(1 << startNodeBits, nullptr);
-    Helper::Fill(m_startNodes, m_tree);
+        // decode the rest of the block directly into the output buffer
+        const size_t start = m_outBuffer.size();
+        m_outBuffer.resize(start + m_blockSize - m_blockCount);
+        auto out = m_outBuffer.begin() + start;
+        unsigned int key = 0;
+        if (m_tree->height <= m_rootBits)
+        {
+            // all codes are in the first table, decode several keys per refill
+            const unsigned int keysPerRefill = 56 / m_tree->height;
+            while (key != keyEnd && std::distance(out, m_outBuffer.end()) >= keysPerRefill && reader.Available() >= 56)
+            {
+                reader.Refill();
+                for (unsigned int i = 0; i < keysPerRefill; ++i)
+                {
+                    const TableEntry& entry = m_table[reader.Peek(m_rootBits)];
+                    reader.Skip(entry.length);
+                    key = entry.value;
+                    if (key == keyEnd)
+                    {
+                        break;
+                    }
+                    *out++ = static_cast<unsigned char>(key);
+                }
+            }
+        }
+        while (key != keyEnd && out != m_outBuffer.end() && DecodeKey(reader, key) && key != keyEnd)
+        {
+            *out++ = static_cast<unsigned char>(key);
+        }
+        m_blockCount += static_cast<size_t>(std::distance(m_outBuffer.begin() + start, out));
+        const bool blockDone = (out == m_outBuffer.end());
+        m_outBuffer.erase(out, m_outBuffer.end());
+        if (blockDone)
+        {
+            m_blockCount = 0;
+            m_haveTree = false;
+        }
+        else if (key == keyEnd)
+        {
+            m_eof = true;
+        }
+        else
+        {
+            break;
+        }
+    }
+    if (m_eof)
+    {
+        // see if the filling bits are 0
+        if (reader.Available() >= 8)
+        {
+            throw std::runtime_error("Data after end");
+        }
+        if (reader.Pop(static_cast<unsigned int>(reader.Available())) != 0)
+        {
+            throw std::runtime_error("Invalid data");
+        }
+    }
+    // drop the bytes which are completely read
+    m_position = reader.Position();
+    m_inBuffer.erase(m_inBuffer.begin(), m_inBuffer.begin() + m_position / 8);
+    m_position %= 8;
+    output.Take(m_outBuffer);
 }
 
+void StaticHuffmanDeCompressor::FinishBytes(ByteOutput&)
+{
+    if (8 * m_inBuffer.size() != m_position || (m_started && !m_eof))
+    {
+        throw std::runtime_error("Incomplete data");
+    }
+}
@@ -1,13 +1,40 @@
 #pragma once
 
-#include "BitFiFo.h"
-#include "ICompress.h"
+#include "BitStream.h"
+#include "HuffmanCode.h"
+#include "SpanCodec.h"
 
 // bit stream format:
-//   - repeat for each 'blocksize'
-//     - write table
+//   - version marker: 1 version:3
+//   - repeat for each block
+//     - segments:6, the block has (segments + 1) * segmentSize keys. the last block has fewer, and
+//       ends with the end key.
+//     - repeat:1, 1 when the block uses the code lengths of the block before it
+//     - write code lengths, when repeat is 0
 //     - write keys
-//   - write end
+//
+// code lengths (lsb->msb), for keys 0..keyEnd, the previous length starts at 0:
+//   0 0                  : previous length
+//   0 1 count:3          : previous length, 2..9 times
+//   1 0                  : previous length + 1
+//   1 1 0                : previous length - 1
+//   1 1 1 0 length:5     : length
+//   1 1 1 1 count:8      : 0, 1..256 times
+// keys get canonical codes: shorter codes first, equal lengths in key order. the code is written
+// starting with its most significant bit.
+//
+// the compressor chooses the blocks: a block grows by a step of segments as long as that is estimated
+// to cost less than a block of its own for the step. the level sets the effort:
+//   Fast   : blocks of 4 segments
+//   Normal : grows by 4 segments at a time, estimates from the entropy of the counts and 4 bits for
+//            each code length
+//   Max    : grows by a segment at a time, estimates from the code lengths and their header
+// a block repeats the code lengths of the block before it when they cost less than its own.
+//
+// version 1 streams have blocks of 'blockSize' keys without segments and repeat, the end is written
+// in a block of its own when the last block is full. streams without version marker (the first bit is
+// 0) are in the original format, which has version 1 blocks with a tree instead of code lengths:
+// branch: 0 node node, leaf: 1 key:9. both formats are still decoded.
 
 class StaticHuffmanCommon 
 {
@@ -15,8 +42,82 @@ protected:
     static const unsigned int keyEnd = 256;
     static const unsigned int keyCount = 257;
     static const unsigned int blockSize = 16384;
-    static const unsigned int startNodeBits = 5;
+    static const unsigned int version = 2;
+    static const unsigned int segmentSize = 4096;
+    static const unsigned int segmentBits = 6;
+    // codes in a block of at most 64 segments can't get longer than this
+    static const unsigned int maxCodeLength = 31;
 
+    typedef std::array<unsigned int, keyCount> Lengths;
+    typedef std::array<uint32_t, keyCount> Codes;
+    typedef std::array<uint64_t, keyCount> Counts;
+
+    // the code lengths header for 'count' keys
+    static void WriteLengths(BitWriter& writer, const unsigned int* lengths, const size_t count);
+    // returns false, without reading anything, when the header isn't complete yet
+    static bool ReadLengths(BitReader& reader, unsigned int* lengths, const size_t count);
+};
+
+class StaticHuffmanCompressor : public SpanCompressor, StaticHuffmanCommon
+{
+public:
+    StaticHuffmanCompressor();
+
+    void SetLevel(CompressionLevel level) override;
+    void CompressBytes(const unsigned char* data, const size_t size, ByteOutput& output) override;
+    void FinishBytes(ByteOutput& output) override;
+
+private:
+    // longest code written, so codes fit the first two decode tables
+    static const unsigned int codeLengthLimit = 15;
+    static const unsigned int maxSegments = 1 << segmentBits;
+    // the size of Fast blocks, and the steps in which Normal grows a block
+    static const unsigned int stepSegments = 4;
+
+    // the encode table, code bits are reversed so they can be written lsb first
+    struct Key
+    {
+        uint32_t bits;
+        uint32_t length;
+    };
+    typedef std::array<Key, keyCount> Keys;
+    Keys m_keys;
+
+    static void Count(const unsigned char* begin, const unsigned char* end, Counts& counts);
+    void BuildCodes();
+    // size of the code lengths header in bits, rounded up to bytes
+    size_t HeaderBits(const Lengths& lengths);
+    // estimated bits for a block with these counts
+    double Cost(const Counts& counts);
+    // keys in the next block, which starts at data and can have 'size' keys
+    size_t ChooseBlock(const unsigned char* data, const size_t size, Counts& counts);
+    // compress the next block, returns its keys. 'last' is set when it is the last block, which is
+    // only possible when 'final' is set.
+    size_t CompressBlock(const unsigned char* data, const size_t size, const bool final, bool& last);
+
+    void WriteKeyUsingTree(BitWriter& writer, unsigned int key) const;
+
+    CompressionLevel m_level;
+    Lengths m_lengths;
+    Codes m_codes;
+    // m_lengths are those of the last block
+    bool m_haveLengths;
+    std::vector<unsigned char> m_inBuffer;
+    std::vector<unsigned char> m_outBuffer;
+    BitWriter m_writer;
+    // for the size of headers
+    std::vector<unsigned char> m_scratch;
+};
+
+class StaticHuffmanDeCompressor : public SpanDeCompressor, StaticHuffmanCommon
+{
+public:
+    StaticHuffmanDeCompressor();
+
+    void DeCompressBytes(const unsigned char* data, const size_t size, ByteOutput& output) override;
+    void FinishBytes(ByteOutput& output) override;
+
+private:
     enum class NodeType
     {
         branch,
@@ -26,7 +127,7 @@ protected:
     {
         NodeType type;
         unsigned int count;
-        unsigned int depth;
+        unsigned int height; // longest path to a leaf
         union
         {
             Node* node[2];
@@ -37,52 +138,52 @@ protected:
     NodeCache m_nodeCache;
     typedef std::vector<Node*> Nodes;
     Node* m_tree;
-};
-
-class StaticHuffmanCompressor : public ICompressor, StaticHuffmanCommon
-{
-public:
-    StaticHuffmanCompressor();
 
-    void Compress(std::vector<unsigned char>& ioBuffer) override;
-    void Finish(std::vector<unsigned char>& ioBuffer) override;
+    // bits used to index the first decode table, longer codes continue in a smaller table
+    static const unsigned int tableBits = 11;
 
-private:
-    struct Key
+    // a key (bits == 0) or a link to the next table (bits > 0) at offset 'value'
+    struct TableEntry
     {
-        uint64_t count;
-        BitFiFo bits;
+        uint16_t value;
+        uint8_t length; // bits used by this entry
+        uint8_t bits;   // index bits of the next table
     };
-    typedef std::array<Key, keyCount> Keys;
-    Keys m_keys;
 
-    void ClearKeys();
-    void BuildTree();
-    void CompressBuffer(std::vector<unsigned char>::const_iterator begin, std::vector<unsigned char>::const_iterator end);
+    enum class Format
+    {
+        Unknown,
+        Tree,
+        Canonical,
+        Segments
+    };
 
-    void WriteTree(BitFiFo& buffer) const;
-    void WriteKeyUsingTree(BitFiFo& buffer, unsigned int key) const;
+    bool ReadFormat(BitReader& reader);
+    // returns false, without reading anything, when the header isn't complete yet
+    bool ReadBlockHeader(BitReader& reader);
+    bool ReadTree(BitReader& reader);
+    bool ReadLengths(BitReader& reader);
+    // build m_tree for the canonical codes of m_lengths
+    void BuildTreeFromLengths();
+    void BuildTable();
+    bool DecodeKey(BitReader& reader, unsigned int& key) const;
 
-    Nodes m_nodes;
+    Format m_format;
+    Lengths m_lengths;
+    Codes m_codes;
+    std::vector<TableEntry> m_table;
+    unsigned int m_rootBits;
     std::vector<unsigned char> m_inBuffer;
-    BitFiFo m_outBuffer;
-};
-
-class StaticHuffmanDeCompressor : public IDeCompressor, StaticHuffmanCommon
-{
-public:
-    StaticHuffmanDeCompressor();
-
-    void DeCompress(std::vector<unsigned char>& ioBuffer) override;
-    void Finish(std::vector<unsigned char>& ioBuffer) override;
-
-private:
-    bool ReadTree();
-    void FillStartNodes();
-
-    Nodes m_startNodes;
-    Node* m_currentNode;
-    BitFiFo m_inBuffer;
-    unsigned int m_blockCount;
+    std::vector<unsigned char> m_outBuffer;
+    // bits read from the start of m_inBuffer
+    size_t m_position;
+    bool m_haveTree;
+    // m_lengths are those of the last block, for a block which repeats them
+    bool m_haveLengths;
+    bool m_started;
+    bool m_eof;
+    // keys in the current block, and decoded so far
+    size_t m_blockSize;
+    size_t m_blockCount;
 };
 
@@ -0,0 +1,329 @@
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <stdexcept>
+#include <string>
+
+#include "Histogram.h"
+#include "StaticHuffman4.h"
+
+std::array<size_t, StaticHuffman4Common::streamCount> StaticHuffman4Common::StreamKeys(const size_t count)
+{
+    const size_t quarter = (count + streamCount - 1) / streamCount;
+    std::array<size_t, streamCount> keys;
+    for (unsigned int stream = 0; stream < streamCount; ++stream)
+    {
+        const size_t begin = std::min(count, stream * quarter);
+        keys[stream] = std::min(count, begin + quarter) - begin;
+    }
+    return keys;
+}
+
+
+
+StaticHuffman4Compressor::StaticHuffman4Compressor()
+    : m_table()
+    , m_inBuffer()
+    , m_outBuffer()
+    , m_writer()
+{
+}
+
+void StaticHuffman4Compressor::CompressBlock(const unsigned char* data, const size_t size, std::vector<unsigned char>& output)
+{
+    assert(size <= blockSize);
+    m_writer.Begin(output);
+    m_writer.Write(size, countBits);
+    if (size == 0)
+    {
+        m_writer.End(true);
+        return;
+    }
+
+    std::array<uint64_t, byteCount> counts = {};
+    Histogram::Count(data, size, counts.data());
+    ByteLengths lengths;
+    ByteCodes codes;
+    HuffmanCode::LimitedLengths(counts.data(), byteCount, codeLengthLimit, lengths.data());
+    HuffmanCode::CanonicalCodes(lengths.data(), byteCount, codes.data());
+    for (unsigned int key = 0; key < byteCount; ++key)
+    {
+        uint32_t bits = 0;
+        for (unsigned int bit = 0; bit < lengths[key]; ++bit)
+        {
+            bits = (bits << 1) | ((codes[key] >> bit) & 1);
+        }
+        m_table[key].bits = bits;
+        m_table[key].length = lengths[key];
+    }
+    WriteLengths(m_writer, lengths.data(), byteCount);
+    m_writer.End(true);
+
+    // the jump table is filled in when the streams are written
+    const size_t jumpTable = output.size();
+    output.resize(jumpTable + jumpTableSize);
+    const auto streamKeys = StreamKeys(size);
+    // codes are at most 11 bits, so four of them fit the writer between flushes
+    static_assert(4 * codeLengthLimit <= 56, "codes don't fit the writer");
+    for (unsigned int stream = 0; stream < streamCount; ++stream)
+    {
+        const size_t start = output.size();
+        const unsigned char* iter = data;
+        const unsigned char* end = data + streamKeys[stream];
+        m_writer.Begin(output);
+        m_writer.Reserve(codeLengthLimit * streamKeys[stream]);
+        for (; end - iter >= 4; iter += 4)
+        {
+            m_writer.Add(m_table[iter[0]].bits, m_table[iter[0]].length);
+            m_writer.Add(m_table[iter[1]].bits, m_table[iter[1]].length);
+            m_writer.Add(m_table[iter[2]].bits, m_table[iter[2]].length);
+            m_writer.Add(m_table[iter[3]].bits, m_table[iter[3]].length);
+            m_writer.Flush();
+        }
+        for (; iter != end; ++iter)
+        {
+            m_writer.Write(m_table[*iter].bits, m_table[*iter].length);
+        }
+        m_writer.End(true);
+        const size_t streamSize = output.size() - start;
+        assert(streamSize <= 0xFFFF);
+        output[jumpTable + 2 * stream] = static_cast<unsigned char>(streamSize);
+        output[jumpTable + 2 * stream + 1] = static_cast<unsigned char>(streamSize >> 8);
+        data = end;
+    }
+}
+
+void StaticHuffman4Compressor::CompressBytes(const unsigned char* data, size_t size, ByteOutput& output)
+{
+    m_outBuffer.clear();
+    if (!m_inBuffer.empty())
+    {
+        const size_t used = std::min(size, blockSize - m_inBuffer.size());
+        m_inBuffer.insert(m_inBuffer.end(), data, data + used);
+        data += used;
+        size -= used;
+        if (m_inBuffer.size() == blockSize)
+        {
+            CompressBlock(m_inBuffer.data(), m_inBuffer.size(), m_outBuffer);
+            m_inBuffer.clear();
+        }
+    }
+    for (; size >= blockSize; data += blockSize, size -= blockSize)
+    {
+        CompressBlock(data, blockSize, m_outBuffer);
+    }
+    m_inBuffer.insert(m_inBuffer.end(), data, data + size);
+    output.Take(m_outBuffer);
+}
+
+void StaticHuffman4Compressor::FinishBytes(ByteOutput& output)
+{
+    // the last block isn't full, it is empty when all blocks are full
+    m_outBuffer.clear();
+    CompressBlock(m_inBuffer.data(), m_inBuffer.size(), m_outBuffer);
+    m_inBuffer.clear();
+    output.Take(m_outBuffer);
+}
+
+
+
+StaticHuffman4DeCompressor::StaticHuffman4DeCompressor()
+    : m_lengths()
+    , m_codes()
+    , m_table()
+    , m_tableBits(0)
+    , m_inBuffer()
+    , m_outBuffer()
+    , m_position(0)
+    , m_eof(false)
+{
+}
+
+void StaticHuffman4DeCompressor::BuildTable()
+{
+    const auto keys = std::count_if(m_lengths.begin(), m_lengths.end(), [](const unsigned int length) { return length > 0; });
+    m_tableBits = *std::max_element(m_lengths.begin(), m_lengths.end());
+    if (keys == 0 || m_tableBits > codeLengthLimit)
+    {
+        throw std::runtime_error("Invalid data");
+    }
+    // the codes have to fill the table exactly, a single key fills all of it
+    size_t used = 0;
+    for (const auto length : m_lengths)
+    {
+        if (length > 0)
+        {
+            used += size_t(1) << (m_tableBits - length);
+        }
+    }
+    if (keys > 1 ? used != (size_t(1) << m_tableBits) : m_tableBits != 1)
+    {
+        throw std::runtime_error("Invalid data");
+    }
+    HuffmanCode::CanonicalCodes(m_lengths.data(), byteCount, m_codes.data());
+    for (unsigned int key = 0; key < byteCount; ++key)
+    {
+        const unsigned int length = m_lengths[key];
+        if (length == 0)
+        {
+            continue;
+        }
+        // the table is indexed by the next bits in the stream, which hold the code reversed
+        size_t bits = 0;
+        for (unsigned int bit = 0; bit < length; ++bit)
+        {
+            bits = (bits << 1) | ((m_codes[key] >> bit) & 1);
+        }
+        const size_t step = keys > 1 ? size_t(1) << length : 1;
+        for (size_t index = keys > 1 ? bits : 0; index < (size_t(1) << m_tableBits); index += step)
+        {
+            m_table[index].key = static_cast<uint8_t>(key);
+            m_table[index].length = static_cast<uint8_t>(length);
+        }
+    }
+}
+
+bool StaticHuffman4DeCompressor::DeCompressBlock(std::vector<unsigned char>& output)
+{
+    const unsigned char* data = m_inBuffer.data() + m_position;
+    const size_t size = m_inBuffer.size() - m_position;
+    BitReader reader(data, size);
+    if (reader.Available() < countBits)
+    {
+        return false;
+    }
+    const size_t count = static_cast<size_t>(reader.Pop(countBits));
+    if (count > blockSize)
+    {
+        throw std::runtime_error("Invalid data");
+    }
+    if (count == 0)
+    {
+        m_position += (countBits + 7) / 8;
+        m_eof = true;
+        return true;
+    }
+    if (!ReadLengths(reader, m_lengths.data(), byteCount))
+    {
+        return false;
+    }
+    const size_t header = (reader.Position() + 7) / 8;
+    if (size < header + jumpTableSize)
+    {
+        return false;
+    }
+    std::array<size_t, streamCount> streamSizes;
+    size_t total = header + jumpTableSize;
+    for (unsigned int stream = 0; stream < streamCount; ++stream)
+    {
+        streamSizes[stream] = data[header + 2 * stream] | (data[header + 2 * stream + 1] << 8);
+        total += streamSizes[stream];
+    }
+    if (size < total)
+    {
+        return false;
+    }
+    BuildTable();
+
+    const auto streamKeys = StreamKeys(count);
+    const unsigned char* streamData = data + header + jumpTableSize;
+    BitReader readers[streamCount] =
+    {
+        BitReader(streamData, streamSizes[0]),
+        BitReader(streamData + streamSizes[0], streamSizes[1]),
+        BitReader(streamData + streamSizes[0] + streamSizes[1], streamSizes[2]),
+        BitReader(streamData + streamSizes[0] + streamSizes[1] + streamSizes[2], streamSizes[3]),
+    };
+    const size_t start = output.size();
+    output.resize(start + count);
+    unsigned char* out[streamCount];
+    out[0] = output.data() + start;
+    for (unsigned int stream = 1; stream < streamCount; ++stream)
+    {
+        out[stream] = out[stream - 1] + streamKeys[stream - 1];
+    }
+
+    const TableEntry* table = m_table.data();
+    const unsigned int tableBits = m_tableBits;
+    auto Decode = [table, tableBits](BitReader& reader)
+    {
+        const TableEntry entry = table[reader.Peek(tableBits)];
+        reader.Skip(entry.length);
+        return entry.key;
+    };
+    // the last stream has the fewest keys. decode 4 keys from each stream per refill, as long as all
+    // streams have enough bits left for that.
+    size_t index = 0;
+    const size_t needed = 4 * codeLengthLimit;
+    for (; index + 4 <= streamKeys[streamCount - 1]; index += 4)
+    {
+        if (readers[0].Available() < needed || readers[1].Available() < needed ||
+            readers[2].Available() < needed || readers[3].Available() < needed)
+        {
+            break;
+        }
+        readers[0].Refill();
+        readers[1].Refill();
+        readers[2].Refill();
+        readers[3].Refill();
+        for (size_t i = index; i < index + 4; ++i)
+        {
+            out[0][i] = Decode(readers[0]);
+            out[1][i] = Decode(readers[1]);
+            out[2][i] = Decode(readers[2]);
+            out[3][i] = Decode(readers[3]);
+        }
+    }
+    for (unsigned int stream = 0; stream < streamCount; ++stream)
+    {
+        BitReader& streamReader = readers[stream];
+        for (size_t i = index; i < streamKeys[stream]; ++i)
+        {
+            streamReader.Refill();
+            const TableEntry entry = table[streamReader.Peek(tableBits)];
+            if (entry.length > streamReader.Available())
+            {
+                throw std::runtime_error("Invalid data");
+            }
+            streamReader.Skip(entry.length);
+            out[stream][i] = entry.key;
+        }
+        // only padding can be left
+        if ((streamReader.Position() + 7) / 8 != streamSizes[stream])
+        {
+            throw std::runtime_error("Invalid data");
+        }
+    }
+
+    m_position += total;
+    m_eof = count < blockSize;
+    return true;
+}
+
+void StaticHuffman4DeCompressor::DeCompressBytes(const unsigned char* data, const size_t size, ByteOutput& output)
+{
+    if (m_eof && size > 0)
+    {
+        throw std::runtime_error("Data after end");
+    }
+    m_inBuffer.insert(m_inBuffer.end(), data, data + size);
+    m_outBuffer.clear();
+    while (!m_eof && DeCompressBlock(m_outBuffer))
+    {
+    }
+    if (m_eof && m_position != m_inBuffer.size())
+    {
+        throw std::runtime_error("Data after end");
+    }
+    m_inBuffer.erase(m_inBuffer.begin(), m_inBuffer.begin() + m_position);
+    m_position = 0;
+    output.Take(m_outBuffer);
+}
+
+void StaticHuffman4DeCompressor::FinishBytes(ByteOutput&)
+{
+    if (!m_eof)
+    {
+        throw std::runtime_error("Incomplete data");
+    }
+}
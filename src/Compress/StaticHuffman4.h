@@ -0,0 +1,91 @@
+#pragma once
+
+#include "StaticHuffman.h"
+
+// static huffman with 4 streams per block, so the decoder can follow 4 bit streams at the same time.
+//
+// byte stream format, each block starts at a byte boundary:
+//   - repeat for each 'blocksize' keys, a block with fewer keys is the last one (an empty block when
+//     the last block is full)
+//     - count:15
+//     - when count > 0:
+//       - code lengths for the bytes 0..255, as in StaticHuffman.h
+//       - padding to the byte boundary
+//       - jump table: size:16 of each stream in bytes (lsb first)
+//       - 4 streams, stream n has the codes of keys [n*quarter,(n+1)*quarter), quarter = (count+3)/4.
+//         a stream is padded to the byte boundary.
+//
+// codes get canonical codes as in StaticHuffman.h, but no longer than 11 bits so a single table
+// decodes them.
+
+class StaticHuffman4Common : public StaticHuffmanCommon
+{
+protected:
+    // there is no end key, the block holds its key count
+    static const unsigned int byteCount = 256;
+    static const unsigned int countBits = 15;
+    static const unsigned int streamCount = 4;
+    static const unsigned int jumpTableSize = 2 * streamCount;
+    static const unsigned int codeLengthLimit = 11;
+
+    typedef std::array<unsigned int, byteCount> ByteLengths;
+    typedef std::array<uint32_t, byteCount> ByteCodes;
+
+    // number of keys in each stream of a block
+    static std::array<size_t, streamCount> StreamKeys(const size_t count);
+};
+
+class StaticHuffman4Compressor : public SpanCompressor, StaticHuffman4Common
+{
+public:
+    StaticHuffman4Compressor();
+
+    void CompressBytes(const unsigned char* data, const size_t size, ByteOutput& output) override;
+    void FinishBytes(ByteOutput& output) override;
+
+private:
+    // the encode table, code bits are reversed so they can be written lsb first
+    struct Code
+    {
+        uint32_t bits;
+        uint32_t length;
+    };
+
+    void CompressBlock(const unsigned char* data, const size_t size, std::vector<unsigned char>& output);
+
+    std::array<Code, byteCount> m_table;
+    std::vector<unsigned char> m_inBuffer;
+    std::vector<unsigned char> m_outBuffer;
+    BitWriter m_writer;
+};
+
+class StaticHuffman4DeCompressor : public SpanDeCompressor, StaticHuffman4Common
+{
+public:
+    StaticHuffman4DeCompressor();
+
+    void DeCompressBytes(const unsigned char* data, const size_t size, ByteOutput& output) override;
+    void FinishBytes(ByteOutput& output) override;
+
+private:
+    struct TableEntry
+    {
+        uint8_t key;
+        uint8_t length;
+    };
+
+    // returns false when the block isn't complete yet
+    bool DeCompressBlock(std::vector<unsigned char>& output);
+    void BuildTable();
+
+    ByteLengths m_lengths;
+    ByteCodes m_codes;
+    std::array<TableEntry, 1 << codeLengthLimit> m_table;
+    unsigned int m_tableBits;
+    std::vector<unsigned char> m_inBuffer;
+    std::vector<unsigned char> m_outBuffer;
+    // bytes used from the start of m_inBuffer
+    size_t m_position;
+    bool m_eof;
+};
+
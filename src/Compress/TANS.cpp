@@ -0,0 +1,425 @@
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <stdexcept>
+#include <string>
+
+#include "Histogram.h"
+#include "TANS.h"
+
+namespace
+{
+    // position of the highest set bit
+    unsigned int HighBit(uint32_t value)
+    {
+        assert(value > 0);
+        unsigned int res = 0;
+        while (value >>= 1)
+        {
+            ++res;
+        }
+        return res;
+    }
+}
+
+unsigned int TANSCommon::TableLog(const size_t count)
+{
+    unsigned int tableLog = minTableLog;
+    while (tableLog < maxTableLog && (size_t(1) << tableLog) < 2 * count)
+    {
+        ++tableLog;
+    }
+    return tableLog;
+}
+
+void TANSCommon::Normalize(const uint64_t* counts, const size_t count, const unsigned int tableLog, uint32_t* frequencies)
+{
+    const uint32_t total = 1u << tableLog;
+    uint32_t sum = 0;
+    unsigned int largest = 0;
+    for (unsigned int key = 0; key < byteCount; ++key)
+    {
+        frequencies[key] = counts[key] == 0 ? 0 : std::max<uint32_t>(1, static_cast<uint32_t>((counts[key] * total + count / 2) / count));
+        sum += frequencies[key];
+        if (frequencies[key] > frequencies[largest])
+        {
+            largest = key;
+        }
+    }
+    // rounding errors go to the most frequent byte, unless that takes more than half of its frequency
+    if (sum < total || frequencies[largest] > 2 * (sum - total))
+    {
+        frequencies[largest] += total - sum;
+        return;
+    }
+    while (sum > total)
+    {
+        for (unsigned int key = 0; key < byteCount && sum > total; ++key)
+        {
+            if (frequencies[key] > 1)
+            {
+                --frequencies[key];
+                --sum;
+            }
+        }
+    }
+}
+
+void TANSCommon::WriteFrequencies(BitWriter& writer, const uint32_t* frequencies)
+{
+    int32_t previous = 0;
+    for (unsigned int key = 0; key < byteCount; ++key)
+    {
+        const int32_t difference = static_cast<int32_t>(frequencies[key]) - previous;
+        const uint32_t value = (difference >= 0 ? 2 * static_cast<uint32_t>(difference) : 2 * static_cast<uint32_t>(-difference) - 1) + 1;
+        const unsigned int bits = HighBit(value);
+        writer.Write(uint64_t(1) << bits, bits + 1);
+        writer.Write(value & ((1u << bits) - 1), bits);
+        previous = static_cast<int32_t>(frequencies[key]);
+    }
+}
+
+bool TANSCommon::ReadFrequencies(BitReader& reader, const unsigned int tableLog, uint32_t* frequencies)
+{
+    const uint32_t total = 1u << tableLog;
+    uint32_t sum = 0;
+    int64_t previous = 0;
+    for (unsigned int key = 0; key < byteCount; ++key)
+    {
+        // the zigzag coded difference is at most 2 * total, so a code has at most 2 * (tableLog + 1) + 1 bits
+        reader.Refill();
+        const unsigned int available = static_cast<unsigned int>(std::min<size_t>(reader.Available(), 56));
+        const uint64_t peek = reader.Peek(available);
+        unsigned int bits = 0;
+        while (bits < available && ((peek >> bits) & 1) == 0)
+        {
+            ++bits;
+        }
+        if (bits > tableLog + 1)
+        {
+            throw std::runtime_error("Invalid data");
+        }
+        if (2 * bits + 1 > available)
+        {
+            return false;
+        }
+        reader.Skip(bits + 1);
+        const uint32_t value = static_cast<uint32_t>((uint64_t(1) << bits) | reader.Pop(bits)) - 1;
+        const int64_t frequency = previous + ((value & 1) == 0 ? int64_t(value / 2) : -int64_t((value + 1) / 2));
+        if (frequency < 0 || frequency > total)
+        {
+            throw std::runtime_error("Invalid data");
+        }
+        frequencies[key] = static_cast<uint32_t>(frequency);
+        sum += frequencies[key];
+        previous = frequency;
+    }
+    if (sum != total)
+    {
+        throw std::runtime_error("Invalid data");
+    }
+    return true;
+}
+
+void TANSCommon::Spread(const uint32_t* frequencies, const unsigned int tableLog, unsigned char* table)
+{
+    // an odd step visits all positions, and scatters the states of a byte over the table
+    const uint32_t total = 1u << tableLog;
+    const uint32_t step = (total >> 1) + (total >> 3) + 3;
+    uint32_t position = 0;
+    for (unsigned int key = 0; key < byteCount; ++key)
+    {
+        for (uint32_t i = 0; i < frequencies[key]; ++i)
+        {
+            table[position] = static_cast<unsigned char>(key);
+            position = (position + step) & (total - 1);
+        }
+    }
+    assert(position == 0);
+}
+
+
+
+TANSCompressor::TANSCompressor()
+    : m_symbols()
+    , m_states(1 << maxTableLog)
+    , m_spread(1 << maxTableLog)
+    , m_bits(blockSize)
+    , m_inBuffer()
+    , m_outBuffer()
+    , m_writer()
+{
+}
+
+void TANSCompressor::CompressBlock(const unsigned char* data, const size_t size, std::vector<unsigned char>& output)
+{
+    assert(size <= blockSize);
+    m_writer.Begin(output);
+    m_writer.Write(size, countBits);
+    if (size == 0)
+    {
+        m_writer.End(true);
+        return;
+    }
+
+    std::array<uint64_t, byteCount> counts = {};
+    Histogram::Count(data, size, counts.data());
+    const unsigned int tableLog = TableLog(size);
+    const uint32_t total = 1u << tableLog;
+    Frequencies frequencies;
+    Normalize(counts.data(), size, tableLog, frequencies.data());
+    m_writer.Write(tableLog, tableLogBits);
+    WriteFrequencies(m_writer, frequencies.data());
+    m_writer.End(true);
+
+    // the states of each byte, in the order of the table
+    Spread(frequencies.data(), tableLog, m_spread.data());
+    std::array<uint32_t, byteCount> next;
+    uint32_t start = 0;
+    for (unsigned int key = 0; key < byteCount; ++key)
+    {
+        next[key] = start;
+        const uint32_t frequency = frequencies[key];
+        if (frequency > 0)
+        {
+            const unsigned int high = HighBit(frequency);
+            const unsigned int bits = tableLog - high;
+            m_symbols[key].bitsDelta = (bits << 16) - (frequency << bits);
+            m_symbols[key].stateDelta = static_cast<int32_t>(start) - static_cast<int32_t>(frequency);
+        }
+        start += frequency;
+    }
+    for (uint32_t state = 0; state < total; ++state)
+    {
+        m_states[next[m_spread[state]]++] = static_cast<uint16_t>(total + state);
+    }
+
+    // encode from the last key to the first, the bits are written in key order
+    std::array<uint32_t, stateCount> states;
+    states.fill(total);
+    for (size_t i = size; i-- > 0; )
+    {
+        uint32_t& state = states[i % stateCount];
+        const Symbol& symbol = m_symbols[data[i]];
+        const uint32_t bits = (state + symbol.bitsDelta) >> 16;
+        m_bits[i].value = static_cast<uint16_t>(state & ((1u << bits) - 1));
+        m_bits[i].count = static_cast<uint16_t>(bits);
+        state = m_states[(state >> bits) + symbol.stateDelta];
+    }
+
+    const size_t sizePosition = output.size();
+    output.resize(sizePosition + 2);
+    m_writer.Begin(output);
+    m_writer.Reserve(tableLog * (size + stateCount));
+    for (const auto state : states)
+    {
+        m_writer.Write(state - total, tableLog);
+    }
+    // keys take at most maxTableLog bits, so four of them fit the writer between flushes
+    static_assert(4 * maxTableLog <= 56, "keys don't fit the writer");
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4)
+    {
+        m_writer.Add(m_bits[i].value, m_bits[i].count);
+        m_writer.Add(m_bits[i + 1].value, m_bits[i + 1].count);
+        m_writer.Add(m_bits[i + 2].value, m_bits[i + 2].count);
+        m_writer.Add(m_bits[i + 3].value, m_bits[i + 3].count);
+        m_writer.Flush();
+    }
+    for (; i < size; ++i)
+    {
+        m_writer.Write(m_bits[i].value, m_bits[i].count);
+    }
+    m_writer.End(true);
+    const size_t streamSize = output.size() - sizePosition - 2;
+    assert(streamSize <= 0xFFFF);
+    output[sizePosition] = static_cast<unsigned char>(streamSize);
+    output[sizePosition + 1] = static_cast<unsigned char>(streamSize >> 8);
+}
+
+void TANSCompressor::CompressBytes(const unsigned char* data, size_t size, ByteOutput& output)
+{
+    m_outBuffer.clear();
+    if (!m_inBuffer.empty())
+    {
+        const size_t used = std::min(size, blockSize - m_inBuffer.size());
+        m_inBuffer.insert(m_inBuffer.end(), data, data + used);
+        data += used;
+        size -= used;
+        if (m_inBuffer.size() == blockSize)
+        {
+            CompressBlock(m_inBuffer.data(), m_inBuffer.size(), m_outBuffer);
+            m_inBuffer.clear();
+        }
+    }
+    for (; size >= blockSize; data += blockSize, size -= blockSize)
+    {
+        CompressBlock(data, blockSize, m_outBuffer);
+    }
+    m_inBuffer.insert(m_inBuffer.end(), data, data + size);
+    output.Take(m_outBuffer);
+}
+
+void TANSCompressor::FinishBytes(ByteOutput& output)
+{
+    // the last block isn't full, it is empty when all blocks are full
+    m_outBuffer.clear();
+    CompressBlock(m_inBuffer.data(), m_inBuffer.size(), m_outBuffer);
+    m_inBuffer.clear();
+    output.Take(m_outBuffer);
+}
+
+
+
+TANSDeCompressor::TANSDeCompressor()
+    : m_frequencies()
+    , m_table(1 << maxTableLog)
+    , m_spread(1 << maxTableLog)
+    , m_inBuffer()
+    , m_outBuffer()
+    , m_position(0)
+    , m_eof(false)
+{
+}
+
+void TANSDeCompressor::BuildTable(const unsigned int tableLog)
+{
+    Spread(m_frequencies.data(), tableLog, m_spread.data());
+    Frequencies next = m_frequencies;
+    for (uint32_t state = 0; state < (1u << tableLog); ++state)
+    {
+        const unsigned char key = m_spread[state];
+        // x runs through [frequency, 2 * frequency) for the states of a key
+        const uint32_t x = next[key]++;
+        const unsigned int bits = tableLog - HighBit(x);
+        m_table[state].base = static_cast<uint16_t>((x << bits) - (1u << tableLog));
+        m_table[state].key = key;
+        m_table[state].bits = static_cast<uint8_t>(bits);
+    }
+}
+
+bool TANSDeCompressor::DeCompressBlock(std::vector<unsigned char>& output)
+{
+    const unsigned char* data = m_inBuffer.data() + m_position;
+    const size_t size = m_inBuffer.size() - m_position;
+    BitReader reader(data, size);
+    if (reader.Available() < countBits)
+    {
+        return false;
+    }
+    const size_t count = static_cast<size_t>(reader.Pop(countBits));
+    if (count > blockSize)
+    {
+        throw std::runtime_error("Invalid data");
+    }
+    if (count == 0)
+    {
+        m_position += (countBits + 7) / 8;
+        m_eof = true;
+        return true;
+    }
+    if (reader.Available() < tableLogBits)
+    {
+        return false;
+    }
+    const unsigned int tableLog = static_cast<unsigned int>(reader.Pop(tableLogBits));
+    if (tableLog < minTableLog || tableLog > maxTableLog)
+    {
+        throw std::runtime_error("Invalid data");
+    }
+    if (!ReadFrequencies(reader, tableLog, m_frequencies.data()))
+    {
+        return false;
+    }
+    const size_t header = (reader.Position() + 7) / 8;
+    if (size < header + 2)
+    {
+        return false;
+    }
+    const size_t streamSize = data[header] | (data[header + 1] << 8);
+    if (size - header - 2 < streamSize)
+    {
+        return false;
+    }
+    BuildTable(tableLog);
+
+    BitReader streamReader(data + header + 2, streamSize);
+    if (streamReader.Available() < stateCount * tableLog)
+    {
+        throw std::runtime_error("Invalid data");
+    }
+    uint32_t states[stateCount];
+    for (auto& state : states)
+    {
+        state = static_cast<uint32_t>(streamReader.Pop(tableLog));
+    }
+    const size_t start = output.size();
+    output.resize(start + count);
+    unsigned char* out = output.data() + start;
+    const TableEntry* table = m_table.data();
+    auto Decode = [table, &streamReader](uint32_t& state)
+    {
+        const TableEntry entry = table[state];
+        state = entry.base + static_cast<uint32_t>(streamReader.Peek(entry.bits));
+        streamReader.Skip(entry.bits);
+        return entry.key;
+    };
+    // keys take at most maxTableLog bits, so a refill has the bits of one key of each state
+    static_assert(stateCount * maxTableLog <= 56, "keys don't fit the reader");
+    size_t i = 0;
+    for (; i + stateCount <= count && streamReader.Available() >= stateCount * maxTableLog; i += stateCount)
+    {
+        streamReader.Refill();
+        out[i] = Decode(states[0]);
+        out[i + 1] = Decode(states[1]);
+        out[i + 2] = Decode(states[2]);
+        out[i + 3] = Decode(states[3]);
+    }
+    for (; i < count; ++i)
+    {
+        streamReader.Refill();
+        if (table[states[i % stateCount]].bits > streamReader.Available())
+        {
+            throw std::runtime_error("Invalid data");
+        }
+        out[i] = Decode(states[i % stateCount]);
+    }
+    // the encoder started with all states 0, only padding can be left
+    if (std::any_of(states, states + stateCount, [](const uint32_t state) { return state != 0; }) ||
+        (streamReader.Position() + 7) / 8 != streamSize)
+    {
+        throw std::runtime_error("Invalid data");
+    }
+
+    m_position += header + 2 + streamSize;
+    m_eof = count < blockSize;
+    return true;
+}
+
+void TANSDeCompressor::DeCompressBytes(const unsigned char* data, const size_t size, ByteOutput& output)
+{
+    if (m_eof && size > 0)
+    {
+        throw std::runtime_error("Data after end");
+    }
+    m_inBuffer.insert(m_inBuffer.end(), data, data + size);
+    m_outBuffer.clear();
+    while (!m_eof && DeCompressBlock(m_outBuffer))
+    {
+    }
+    if (m_eof && m_position != m_inBuffer.size())
+    {
+        throw std::runtime_error("Data after end");
+    }
+    m_inBuffer.erase(m_inBuffer.begin(), m_inBuffer.begin() + m_position);
+    m_position = 0;
+    output.Take(m_outBuffer);
+}
+
+void TANSDeCompressor::FinishBytes(ByteOutput&)
+{
+    if (!m_eof)
+    {
+        throw std::runtime_error("Incomplete data");
+    }
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "StaticHuffman.h"
+
+// block static tANS (table based asymmetric numeral systems), with the block size of StaticHuffman.
+// a key is decoded with a table lookup and a read of the bits the table entry asks for. key n of a
+// block uses state n % stateCount, so the decoder works on 4 keys at the same time.
+//
+// byte stream format, each block starts at a byte boundary:
+//   - repeat for each 'blocksize' keys, a block with fewer keys is the last one (an empty block when
+//     the last block is full)
+//     - count:15
+//     - when count > 0:
+//       - table log:4
+//       - frequencies of the bytes 0..255, which add up to 1 << table log. each is written as the
+//         difference with the frequency of the previous byte (0 for byte 0), see WriteFrequencies.
+//       - padding to the byte boundary
+//       - size:16 of the key stream in bytes (lsb first)
+//       - key stream: the first value of each state:table log, then the bits of each key. padded to
+//         the byte boundary.
+//
+// the encoder runs from the last key to the first, starting with all states 0, so the decoder reads
+// the key stream in order and ends with all states 0.
+
+class TANSCommon : public StaticHuffmanCommon
+{
+protected:
+    static const unsigned int byteCount = 256;
+    static const unsigned int countBits = 15;
+    static const unsigned int tableLogBits = 4;
+    static const unsigned int minTableLog = 5;
+    static const unsigned int maxTableLog = 11;
+    static const unsigned int stateCount = 4;
+
+    typedef std::array<uint32_t, byteCount> Frequencies;
+
+    // smallest table which has room for twice the keys of a block, up to maxTableLog
+    static unsigned int TableLog(const size_t count);
+    // scale counts of 'count' keys to frequencies which add up to 1 << tableLog, every byte with a
+    // count keeps a frequency
+    static void Normalize(const uint64_t* counts, const size_t count, const unsigned int tableLog, uint32_t* frequencies);
+    // the differences of the frequencies, zigzag coded + 1, as Elias gamma codes: n-1 zero bits, a
+    // one bit and the lowest n-1 bits of the n bit value
+    static void WriteFrequencies(BitWriter& writer, const uint32_t* frequencies);
+    // returns false when the header isn't complete yet, throws when the frequencies are invalid
+    static bool ReadFrequencies(BitReader& reader, const unsigned int tableLog, uint32_t* frequencies);
+    // the order of the states of the bytes in the table
+    static void Spread(const uint32_t* frequencies, const unsigned int tableLog, unsigned char* table);
+};
+
+class TANSCompressor : public SpanCompressor, TANSCommon
+{
+public:
+    TANSCompressor();
+
+    void CompressBytes(const unsigned char* data, const size_t size, ByteOutput& output) override;
+    void FinishBytes(ByteOutput& output) override;
+
+private:
+    // with state x in [L,2L), (x + bitsDelta) >> 16 bits are written and the next state is
+    // m_states[(x >> bits) + stateDelta]
+    struct Symbol
+    {
+        uint32_t bitsDelta;
+        int32_t stateDelta;
+    };
+    struct Bits
+    {
+        uint16_t value;
+        uint16_t count;
+    };
+
+    void CompressBlock(const unsigned char* data, const size_t size, std::vector<unsigned char>& output);
+
+    std::array<Symbol, byteCount> m_symbols;
+    std::vector<uint16_t> m_states;
+    std::vector<unsigned char> m_spread;
+    // bits of each key of a block, in the order of the keys
+    std::vector<Bits> m_bits;
+    std::vector<unsigned char> m_inBuffer;
+    std::vector<unsigned char> m_outBuffer;
+    BitWriter m_writer;
+};
+
+class TANSDeCompressor : public SpanDeCompressor, TANSCommon
+{
+public:
+    TANSDeCompressor();
+
+    void DeCompressBytes(const unsigned char* data, const size_t size, ByteOutput& output) override;
+    void FinishBytes(ByteOutput& output) override;
+
+private:
+    // the next state is base + the next 'bits' bits
+    struct TableEntry
+    {
+        uint16_t base;
+        uint8_t key;
+        uint8_t bits;
+    };
+
+    // returns false when the block isn't complete yet
+    bool DeCompressBlock(std::vector<unsigned char>& output);
+    void BuildTable(const unsigned int tableLog);
+
+    Frequencies m_frequencies;
+    std::vector<TableEntry> m_table;
+    std::vector<unsigned char> m_spread;
+    std::vector<unsigned char> m_inBuffer;
+    std::vector<unsigned char> m_outBuffer;
+    // bytes used from the start of m_inBuffer
+    size_t m_position;
+    bool m_eof;
+};
@@ -0,0 +1,71 @@
+#include <algorithm>
+
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+    : m_threads()
+    , m_tasks()
+    , m_mutex()
+    , m_condition()
+    , m_stop(false)
+{
+    if (threadCount == 0)
+    {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (unsigned int i = 0; i < threadCount; ++i)
+    {
+        m_threads.emplace_back([this]() { Run(); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_condition.notify_all();
+    for (auto& thread : m_threads)
+    {
+        thread.join();
+    }
+}
+
+void ThreadPool::Run()
+{
+    while (true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this]() { return m_stop || !m_tasks.empty(); });
+            if (m_tasks.empty())
+            {
+                return;
+            }
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+        task();
+    }
+}
+
+void ThreadPool::ParallelFor(const size_t count, const std::function<void(size_t)>& func)
+{
+    std::vector<std::future<void>> results;
+    results.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        results.emplace_back(Submit([&func, i]() { func(i); }));
+    }
+    // wait for all calls, func has to stay alive until then
+    for (auto& result : results)
+    {
+        result.wait();
+    }
+    for (auto& result : results)
+    {
+        result.get();
+    }
+}
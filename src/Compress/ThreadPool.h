@@ -0,0 +1,54 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// fixed number of worker threads which run submitted tasks in order of submission.
+// the destructor finishes all tasks which were submitted before it was called.
+
+class ThreadPool
+{
+public:
+    // threadCount 0 uses one thread per core
+    explicit ThreadPool(unsigned int threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator = (const ThreadPool&) = delete;
+
+    unsigned int ThreadCount() const { return static_cast<unsigned int>(m_threads.size()); }
+
+    // the future holds the result, or the exception thrown by the task
+    template<typename Func>
+    auto Submit(Func&& func) -> std::future<decltype(func())>
+    {
+        typedef decltype(func()) Result;
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Func>(func));
+        auto res = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_tasks.emplace_back([task]() { (*task)(); });
+        }
+        m_condition.notify_one();
+        return res;
+    }
+
+    // run func(0)..func(count-1) on the pool and wait for all of them. the first exception is
+    // rethrown after all calls are done.
+    void ParallelFor(const size_t count, const std::function<void(size_t)>& func);
+
+private:
+    void Run();
+
+    std::vector<std::thread> m_threads;
+    std::deque<std::function<void()>> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_stop;
+};
@@ -0,0 +1,85 @@
+#include <limits>
+#include <stdexcept>
+
+#include "ThreadedPipeLine.h"
+
+PipeLineThreads::PipeLineThreads(const size_t stageCount, const size_t chunkSize)
+    : m_chunkSize(chunkSize)
+    , m_queues()
+    , m_stages()
+    , m_failed(false)
+    , m_pool(static_cast<unsigned int>(stageCount))
+{
+    for (size_t i = 0; i < stageCount; ++i)
+    {
+        m_queues.emplace_back(new BoundedQueue<Chunk>(queueSize));
+    }
+    // the output is taken on each call, it doesn't hold back the last stage
+    m_queues.emplace_back(new BoundedQueue<Chunk>(std::numeric_limits<size_t>::max()));
+}
+
+PipeLineThreads::~PipeLineThreads()
+{
+    m_failed = true;
+    for (auto& queue : m_queues)
+    {
+        queue->Close();
+    }
+    for (auto& stage : m_stages)
+    {
+        stage.wait();
+    }
+}
+
+void PipeLineThreads::Push(const unsigned char* data, const size_t size, ByteOutput& output)
+{
+    Chunk chunk;
+    for (size_t offset = 0; offset < size; offset += m_chunkSize)
+    {
+        chunk.assign(data + offset, data + std::min(size, offset + m_chunkSize));
+        if (!m_queues.front()->Push(std::move(chunk)))
+        {
+            Stop();
+        }
+        while (m_queues.back()->TryPop(chunk))
+        {
+            output.Take(chunk);
+        }
+    }
+}
+
+void PipeLineThreads::Finish(ByteOutput& output)
+{
+    m_queues.front()->Close();
+    Chunk chunk;
+    while (m_queues.back()->Pop(chunk))
+    {
+        output.Take(chunk);
+    }
+    auto stages = std::move(m_stages);
+    m_stages.clear();
+    for (auto& stage : stages)
+    {
+        stage.get();
+    }
+}
+
+void PipeLineThreads::Stop()
+{
+    m_failed = true;
+    for (auto& queue : m_queues)
+    {
+        queue->Close();
+    }
+    auto stages = std::move(m_stages);
+    m_stages.clear();
+    for (auto& stage : stages)
+    {
+        stage.wait();
+    }
+    for (auto& stage : stages)
+    {
+        stage.get();
+    }
+    throw std::runtime_error("Pipeline stopped");
+}
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <atomic>
+#include <future>
+#include <memory>
+
+#include "BoundedQueue.h"
+#include "PipeLine.h"
+#include "ThreadPool.h"
+
+// run each stage of a pipeline on its own thread. the stages are connected by bounded queues of
+// chunks, so a stream takes as long as its slowest stage instead of the sum of all stages. the
+// chunks are the same as in PipeLineCompressor/PipeLineDeCompressor, which makes the output the same.
+
+class PipeLineThreads
+{
+public:
+    // chunks waiting in front of a stage
+    static const size_t queueSize = 4;
+
+    PipeLineThreads(const size_t stageCount, const size_t chunkSize);
+    // stops the stages, without waiting for the end of the data
+    ~PipeLineThreads();
+
+    // run stage 'stage' on the chunks of the stage before it: process(data, size, output) for each
+    // chunk, and end(output) at the end of the data
+    template<typename Process, typename End>
+    void Start(const size_t stage, Process process, End end);
+
+    // pass data to the first stage, and write the output which the last stage has ready
+    void Push(const unsigned char* data, const size_t size, ByteOutput& output);
+    // end the data, and write all output of the last stage. rethrows the exception of a stage
+    void Finish(ByteOutput& output);
+
+private:
+    typedef std::vector<unsigned char> Chunk;
+
+    // close all queues and rethrow the first exception of a stage
+    void Stop();
+
+    const size_t m_chunkSize;
+    // queue 0 is the input of the first stage, the last queue the output of the last stage
+    std::vector<std::unique_ptr<BoundedQueue<Chunk>>> m_queues;
+    std::vector<std::future<void>> m_stages;
+    std::atomic<bool> m_failed;
+    ThreadPool m_pool;
+};
+
+template<typename Process, typename End>
+void PipeLineThreads::Start(const size_t stage, Process process, End end)
+{
+    BoundedQueue<Chunk>& input = *m_queues[stage];
+    BoundedQueue<Chunk>& next = *m_queues[stage + 1];
+    const size_t chunkSize = m_chunkSize;
+    m_stages.emplace_back(m_pool.Submit([this, &input, &next, chunkSize, process, end]() mutable
+    {
+        try
+        {
+            ByteOutput output;
+            Chunk chunk;
+            while (input.Pop(chunk))
+            {
+                Chunk result;
+                result.reserve(chunkSize + chunkSize / 8);
+                output.Begin(result);
+                process(chunk.data(), chunk.size(), output);
+                output.End();
+                if (!result.empty() && !next.Push(std::move(result)))
+                {
+                    break;
+                }
+            }
+            // a queue is closed early when a stage stops, the data isn't complete then
+            if (!m_failed)
+            {
+                Chunk result;
+                output.Begin(result);
+                end(output);
+                output.End();
+                if (!result.empty())
+                {
+                    next.Push(std::move(result));
+                }
+            }
+        }
+        catch (...)
+        {
+            m_failed = true;
+            input.Close();
+            next.Close();
+            throw;
+        }
+        // the stage before this one might still wait for space
+        input.Close();
+        next.Close();
+    }));
+}
+
+template<class... Compressors>
+class ThreadedPipeLineCompressor : public SpanCompressor, PipeLineCommon<Compressors...>
+{
+private:
+    using Common = PipeLineCommon<Compressors...>;
+    template<size_t S>
+    using Stage = typename Common::template Stage<S>;
+
+public:
+    ThreadedPipeLineCompressor()
+        : m_threads(Common::count, Common::chunkSize)
+    {
+        StartStage(Stage<0>());
+    }
+
+    void SetLevel(CompressionLevel level) override
+    {
+        this->Apply([level](ICompressor& compressor) {compressor.SetLevel(level); }, true);
+    }
+    void CompressBytes(const unsigned char* data, const size_t size, ByteOutput& output) override
+    {
+        m_threads.Push(data, size, output);
+    }
+    void FinishBytes(ByteOutput& output) override
+    {
+        m_threads.Finish(output);
+    }
+
+private:
+    // stage S runs compressor count - 1 - S, like in PipeLineCompressor
+    template<size_t S>
+    void StartStage(Stage<S>)
+    {
+        using Type = typename Common::template Object<Common::count - 1 - S>;
+        Type& compressor = this->template Get<Common::count - 1 - S>();
+        m_threads.Start(S,
+            [&compressor](const unsigned char* data, const size_t size, ByteOutput& output) { compressor.Type::CompressBytes(data, size, output); },
+            [&compressor](ByteOutput& output) { compressor.Type::FinishBytes(output); });
+        StartStage(Stage<S + 1>());
+    }
+    void StartStage(Stage<Common::count>)
+    {}
+
+    PipeLineThreads m_threads;
+};
+
+template<class... DeCompressors>
+class ThreadedPipeLineDeCompressor : public SpanDeCompressor, PipeLineCommon<DeCompressors...>
+{
+private:
+    using Common = PipeLineCommon<DeCompressors...>;
+    template<size_t S>
+    using Stage = typename Common::template Stage<S>;
+
+public:
+    ThreadedPipeLineDeCompressor()
+        : m_threads(Common::count, Common::chunkSize)
+    {
+        StartStage(Stage<0>());
+    }
+
+    void DeCompressBytes(const unsigned char* data, const size_t size, ByteOutput& output) override
+    {
+        m_threads.Push(data, size, output);
+    }
+    void FinishBytes(ByteOutput& output) override
+    {
+        m_threads.Finish(output);
+    }
+
+private:
+    template<size_t S>
+    void StartStage(Stage<S>)
+    {
+        using Type = typename Common::template Object<S>;
+        Type& deCompressor = this->template Get<S>();
+        m_threads.Start(S,
+            [&deCompressor](const unsigned char* data, const size_t size, ByteOutput& output) { deCompressor.Type::DeCompressBytes(data, size, output); },
+            [&deCompressor](ByteOutput& output) { deCompressor.Type::FinishBytes(output); });
+        StartStage(Stage<S + 1>());
+    }
+    void StartStage(Stage<Common::count>)
+    {}
+
+    PipeLineThreads m_threads;
+};
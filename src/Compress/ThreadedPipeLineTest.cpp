@@ -0,0 +1,114 @@
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "CommonTestFunctionality.h"
+
+#include "ThreadedPipeLine.h"
+
+class ThreadedPipeLineTest : public Test
+{
+protected:
+    virtual void SetUp()
+    {
+    }
+
+    virtual void TearDown()
+    {
+    }
+
+    static std::vector<unsigned char> GetInput(const size_t size)
+    {
+        std::mt19937 rng;
+        rng.seed(0);
+        std::vector<unsigned char> res;
+        while (res.size() < size)
+        {
+            const unsigned char value = static_cast<unsigned char>(rng() % 20);
+            res.insert(res.end(), 1 + rng() % 10, value);
+        }
+        res.resize(size);
+        return res;
+    }
+};
+
+TEST_F(ThreadedPipeLineTest, BoundedQueue)
+{
+    BoundedQueue<size_t> queue(3);
+    std::thread producer([&queue]()
+    {
+        for (size_t i = 0; i < 1000; ++i)
+        {
+            queue.Push(std::move(i));
+        }
+        queue.Close();
+    });
+    size_t value = 0;
+    for (size_t i = 0; i < 1000; ++i)
+    {
+        ASSERT_TRUE(queue.Pop(value));
+        ASSERT_EQ(i, value);
+    }
+    EXPECT_FALSE(queue.Pop(value));
+    producer.join();
+
+    // a closed queue doesn't take values, and one closed by the consumer releases the producer
+    EXPECT_FALSE(queue.Push(1));
+    BoundedQueue<size_t> full(1);
+    EXPECT_TRUE(full.Push(1));
+    std::thread blocked([&full]() { EXPECT_FALSE(full.Push(2)); });
+    full.Close();
+    blocked.join();
+    EXPECT_TRUE(full.TryPop(value));
+    EXPECT_EQ(1u, value);
+    EXPECT_FALSE(full.TryPop(value));
+}
+
+TEST_F(ThreadedPipeLineTest, MatchesSerial)
+{
+    const auto input = GetInput(500000);
+    for (auto ca : { CompressionAlgo::RLE_DynamicHuffman, CompressionAlgo::RLE_StaticHuffman, CompressionAlgo::Window_DynamicHuffman, CompressionAlgo::Window_RLE_DynamicHuffman, CompressionAlgo::RLE_Range, CompressionAlgo::Window_Range })
+    {
+        for (size_t size : { size_t(0), size_t(1), size_t(65536), input.size() })
+        {
+            std::vector<unsigned char> serial(input.begin(), input.begin() + size);
+            CompressorFactory::Create(ca, CompressionLevel::Normal)->Finish(serial);
+
+            auto compressor = CompressorFactory::CreateThreaded(ca, CompressionLevel::Normal);
+            std::vector<unsigned char> compressed;
+            for (size_t offset = 0; offset < size; offset += 100000)
+            {
+                std::vector<unsigned char> chunk(input.begin() + offset, input.begin() + std::min(size, offset + 100000));
+                compressor->Compress(chunk);
+                compressed.insert(compressed.end(), chunk.begin(), chunk.end());
+            }
+            std::vector<unsigned char> chunk;
+            compressor->Finish(chunk);
+            compressed.insert(compressed.end(), chunk.begin(), chunk.end());
+            ASSERT_EQ(serial, compressed) << "Size: " << size;
+
+            DeCompressorFactory::CreateThreaded(ca)->Finish(compressed);
+            ASSERT_EQ(std::vector<unsigned char>(input.begin(), input.begin() + size), compressed) << "Size: " << size;
+        }
+    }
+}
+
+TEST_F(ThreadedPipeLineTest, InvalidData)
+{
+    auto data = GetInput(300000);
+    CompressorFactory::CreateThreaded(CompressionAlgo::Window_RLE_DynamicHuffman, CompressionLevel::Normal)->Finish(data);
+    {
+        auto incomplete = data;
+        incomplete.resize(incomplete.size() / 2);
+        auto deCompressor = DeCompressorFactory::CreateThreaded(CompressionAlgo::Window_RLE_DynamicHuffman);
+        EXPECT_THROW(deCompressor->Finish(incomplete), std::runtime_error);
+    }
+    {
+        // stopped without finishing
+        auto deCompressor = DeCompressorFactory::CreateThreaded(CompressionAlgo::Window_RLE_DynamicHuffman);
+        auto part = data;
+        part.resize(part.size() / 2);
+        deCompressor->DeCompress(part);
+    }
+}
@@ -1,168 +1,295 @@
 ﻿#include <algorithm>
+#include <cassert>
 #include <array>
-#include <map>
 #include <iterator>
 #include <stdexcept>
 
 #include "BitFiFo.h"
 #include "Window.h"
 
-class Attempt
+namespace
 {
-public:
-    Attempt()
-        : m_bits()
-        , m_len(0)
-    {}
-
-    void Set(unsigned char c)
+    // the ways to write a sequence: esc code:2 dist:distanceBits len:lengthBits
+    struct Form
     {
-        m_len = 1;
-        m_bits.Clear();
-        m_bits.Push(c, 8u);
-    }
-    void Set(unsigned char esc,unsigned char c)
+        unsigned int code;
+        unsigned int distanceBits;
+        unsigned int lengthBits;
+        unsigned int offset; // smallest distance and length
+
+        unsigned int Bits() const { return 8 + 2 + distanceBits + lengthBits; }
+        unsigned int MaxDistance() const { return offset - 1 + (1 << distanceBits); }
+        unsigned int MaxLength() const { return offset - 1 + (1 << lengthBits); }
+        bool Fits(unsigned int dist, unsigned int len) const { return dist >= offset && dist <= MaxDistance() && len >= offset; }
+    };
+    const std::array<Form, 3> forms =
+    { {
+        { 0, 10, 4, 4 }, //   esc 00    10:dist 4:len : dist(4..3 + 1<<10), len(4..3 + 1<<4)
+        { 1, 16, 6, 5 }, //   esc 01    16:dist 6:len : dist(5..4 + 1<<16), len(5..4 + 1<<6)
+        { 2, 22, 8, 6 }, //   esc 10    22:dist 8:len : dist(6..5 + 1<<22), len(6..5 + 1<<8)
+    } };
+}
+
+const uint32_t WindowCompressor::optimalBlockSize;
+
+void WindowCompressor::SetLevel(CompressionLevel level)
+{
+    assert(!m_matchFinder);
+    switch (level)
     {
-        m_len = 1;
-        m_bits.Clear();
-        m_bits.Push(esc, 8u);
-        m_bits.Push(c, 8u);
+    default:
+    case CompressionLevel::Fast:
+        m_matchFinderType = MatchFinderType::HashChain;
+        m_parser = WindowParser::Greedy;
+        break;
+    case CompressionLevel::Normal:
+        m_matchFinderType = MatchFinderType::HashChain;
+        m_parser = WindowParser::Lazy;
+        break;
+    case CompressionLevel::Max:
+        m_matchFinderType = MatchFinderType::BinaryTree;
+        m_parser = WindowParser::Optimal;
+        break;
     }
+}
 
-    void Clear()
+void WindowCompressor::CompressBytes(const unsigned char* data, const size_t size, ByteOutput& output)
+{
+    if (!m_matchFinder)
     {
-        m_len = 0;
-        m_bits.Clear();
+        m_matchFinder = IMatchFinder::Create(m_matchFinderType, minDistance, dictionarySize - maxLength);
     }
-
-    void Swap(Attempt& other)
+    const unsigned char* end = data + size;
+    while (data != end)
     {
-        other.m_bits.Swap(m_bits);
-        std::swap(other.m_len,m_len);
+        if (m_window.size() == bufferSize)
+        {
+            // everything up to the last maxLength bytes is encoded, drop the oldest half
+            assert(m_index >= dictionarySize);
+            Slide(dictionarySize);
+            m_matchFinder->Rebase(dictionarySize);
+            m_index -= dictionarySize;
+        }
+        const size_t used = std::min<size_t>(end - data, bufferSize - m_window.size());
+        m_window.insert(m_window.end(), data, data + used);
+        data += used;
+        Encode(output, false);
     }
+}
 
-    BitFiFo m_bits;
-    unsigned int m_len;
-};
-
-void WindowCompressor::Compress(std::vector<unsigned char>& ioBuffer)
+void WindowCompressor::Write(const Token& token, const uint32_t index)
 {
-    m_window.insert(m_window.end(), ioBuffer.begin(), ioBuffer.end());
-    ioBuffer.clear();
-    Attempt attempt;
-    Attempt choice;
-    auto UpdateChoice = [&attempt, &choice]()
+    if (token.distance == 0)
     {
-        if (choice.m_bits.Size() * attempt.m_len > attempt.m_bits.Size() * choice.m_len)
+        if (m_window[index] == escape)
         {
-            choice.Swap(attempt);
+            m_output.Push(escape | (255u << 8), 16u);
         }
-    };
-    auto SaveDistLen = [&attempt, &choice, &UpdateChoice](unsigned int dist, unsigned int len)
-    {
-        //   esc 00    10:dist 4:len : dist(4..3 + 1<<10), len(4..3 + 1<<4)
-        //   esc 01    16:dist 6:len : dist(5..4 + 1<<16), len(5..4 + 1<<6)
-        //   esc 10    22:dist 8:len : dist(6..5 + 1<<22), len(6..5 + 1<<8)
-        if (dist >= 4 && dist < 4 + (1 << 10) && len >= 4)
+        else
         {
-            attempt.Clear();
-            attempt.m_len = std::min(len, 3u + (1 << 4));
-            attempt.m_bits.Push(escape, 8u);
-            attempt.m_bits.Push(0, 2u);
-            attempt.m_bits.Push(dist-4, 10u);
-            attempt.m_bits.Push(attempt.m_len - 4, 4u);
-            UpdateChoice();
+            m_output.Push(m_window[index], 8u);
         }
-        if (dist >= 5 && dist < 5 + (1 << 16) && len >= 5)
+    }
+    else
+    {
+        // esc code:2 dist len, packed in one push
+        const Form& form = forms[token.form];
+        uint64_t bits = escape | (form.code << 8);
+        bits |= static_cast<uint64_t>(token.distance - form.offset) << 10;
+        bits |= static_cast<uint64_t>(token.length - form.offset) << (10 + form.distanceBits);
+        m_output.Push(bits, form.Bits());
+    }
+}
+
+void WindowCompressor::Encode(ByteOutput& output, const bool flush)
+{
+    const uint32_t end = static_cast<uint32_t>(flush ? m_window.size() : m_window.size() - std::min<size_t>(m_window.size(), maxLength));
+    auto FindMatches = [this](uint32_t index, Matches& matches)
+    {
+        matches.clear();
+        if (index + IMatchFinder::minLength <= m_window.size())
         {
-            attempt.Clear();
-            attempt.m_len = std::min(len, 4u + (1 << 6));
-            attempt.m_bits.Push(escape, 8u);
-            attempt.m_bits.Push(1, 2u);
-            attempt.m_bits.Push(dist - 5, 16u);
-            attempt.m_bits.Push(attempt.m_len - 5, 6u);
-            UpdateChoice();
+            const auto length = static_cast<unsigned int>(std::min<size_t>(maxLength, m_window.size() - index));
+            m_matchFinder->Find(m_window.data(), index, length, matches);
         }
-        if (dist >= 6 && dist < 6 + (1 << 22) && len >= 6)
+    };
+    auto SkipMatches = [this](uint32_t begin, uint32_t end)
+    {
+        for (auto index = begin; index < end && index + IMatchFinder::minLength <= m_window.size(); ++index)
         {
-            attempt.Clear();
-            attempt.m_len = std::min(len, 5u + (1 << 8));
-            attempt.m_bits.Push(escape, 8u);
-            attempt.m_bits.Push(2, 2u);
-            attempt.m_bits.Push(dist - 6, 22u);
-            attempt.m_bits.Push(attempt.m_len - 6, 8u);
-            UpdateChoice();
+            const auto length = static_cast<unsigned int>(std::min<size_t>(maxLength, m_window.size() - index));
+            m_matchFinder->Skip(m_window.data(), index, length);
         }
     };
-    while(m_index < m_window.size())
+    const Token literal = { 1, 0, 0 };
+    // pick the token with the least bits per byte, and return its cost in bits
+    auto Choose = [this, &literal](uint32_t index, const Matches& matches, Token& choice)
     {
-        // just write directly
-        if (m_window[m_index] == escape)
+        choice = literal;
+        unsigned int choiceBits = m_window[index] == escape ? 16 : 8;
+        for (const auto& match : matches)
         {
-            choice.Set(escape, 255u);
+            for (uint32_t f = 0; f < forms.size(); ++f)
+            {
+                const Form& form = forms[f];
+                if (form.Fits(match.distance, match.length))
+                {
+                    const unsigned int length = std::min(match.length, form.MaxLength());
+                    if (choiceBits * length > form.Bits() * choice.length)
+                    {
+                        choice = { length, match.distance, f };
+                        choiceBits = form.Bits();
+                    }
+                }
+            }
         }
-        else
+        return choiceBits;
+    };
+    // bits saved compared to writing the bytes directly
+    auto Savings = [](const Token& token, unsigned int bits)
+    {
+        return static_cast<int>(8 * token.length) - static_cast<int>(bits);
+    };
+    Token choice;
+    switch (m_parser)
+    {
+    case WindowParser::Greedy:
+        while (m_index < end)
         {
-            choice.Set(m_window[m_index]);
+            FindMatches(m_index, m_matches);
+            Choose(m_index, m_matches, choice);
+            SkipMatches(m_index + 1, m_index + choice.length);
+            Write(choice, m_index);
+            m_index += choice.length;
         }
-        // find sequence at some distance
-        if (m_index + 4 < m_window.size())
+        break;
+    case WindowParser::Lazy:
+        while (m_index < end)
         {
-            Key key;
-            key.Fill(m_window.begin()+m_index);
-            // get the indices where the key appears
-            auto indexIter = m_indices.find(key);
-            if (indexIter == m_indices.end())
+            if (!m_nextFound)
             {
-                indexIter = m_indices.emplace(key, std::vector<uint64_t>()).first;
+                FindMatches(m_index, m_matches);
             }
-            auto& indices = indexIter->second;
-            // remove all indices which are out of range
-            auto iter = std::partition(indices.begin(), indices.end(), [&](const auto& index) { return index + 5 + (1<<22) >= m_index; });
-            indices.erase(iter, indices.end());
-            // try the available indices.
-            for (const auto index : indices)
+            m_nextFound = false;
+            const unsigned int choiceBits = Choose(m_index, m_matches, choice);
+            if (choice.length > 1 && m_index + 1 < end)
             {
-                unsigned int maxlen = 5 + (1 << 8);
-                unsigned int len = 4;
-                unsigned int currlen = 0;
-                for (; currlen < maxlen && currlen + m_index < m_window.size(); ++currlen)
+                // see if starting one byte later gives a better sequence
+                Token next;
+                FindMatches(m_index + 1, m_nextMatches);
+                const unsigned int nextBits = Choose(m_index + 1, m_nextMatches, next);
+                m_nextFound = true;
+                if (Savings(next, nextBits) > Savings(choice, choiceBits))
+                {
+                    choice = literal;
+                    m_matches.swap(m_nextMatches);
+                }
+            }
+            SkipMatches(m_index + (m_nextFound ? 2 : 1), m_index + choice.length);
+            m_nextFound = m_nextFound && choice.length == 1;
+            Write(choice, m_index);
+            m_index += choice.length;
+        }
+        break;
+    case WindowParser::Optimal:
+        while (m_index < end)
+        {
+            // cheapest way to reach every position in the block
+            const uint32_t blockLength = std::min(optimalBlockSize, end - m_index);
+            m_nodes.assign(blockLength + 1, Node());
+            m_nodes[0].cost = 0;
+            uint32_t stop = 0;
+            for (; stop < blockLength; ++stop)
+            {
+                const uint32_t index = m_index + stop;
+                FindMatches(index, m_matches);
+                if (!m_matches.empty() && m_matches.back().length >= niceLength)
+                {
+                    // long enough, no need to look for alternatives
+                    break;
+                }
+                const Node& node = m_nodes[stop];
+                auto Relax = [&](const Token& token, uint32_t cost)
                 {
-                    if (m_window[m_index + currlen] != m_window[index + currlen])
+                    Node& target = m_nodes[stop + token.length];
+                    if (node.cost + cost < target.cost)
                     {
-                        break;
+                        target.cost = node.cost + cost;
+                        target.token = token;
                     }
-                }
-                if (currlen > len)
+                };
+                Relax(literal, m_window[index] == escape ? 16 : 8);
+                for (uint32_t f = 0; f < forms.size(); ++f)
                 {
-                    len = currlen;
-                    SaveDistLen((unsigned int)(m_index-index), len);
+                    const Form& form = forms[f];
+                    // every length is reached using the closest match which is long enough
+                    uint32_t length = form.offset;
+                    for (const auto& match : m_matches)
+                    {
+                        if (form.Fits(match.distance, match.length))
+                        {
+                            const uint32_t last = std::min(std::min(match.length, form.MaxLength()), blockLength - stop);
+                            for (; length <= last; ++length)
+                            {
+                                Relax({ length, match.distance, f }, form.Bits());
+                            }
+                        }
+                    }
                 }
             }
-            // add the new key
-            indices.emplace_back(m_index);
+            // walk back from the stop position to find the tokens to write
+            m_path.clear();
+            for (uint32_t pos = stop; pos > 0; pos -= m_nodes[pos].token.length)
+            {
+                m_path.emplace_back(pos);
+            }
+            for (auto iter = m_path.rbegin(); iter != m_path.rend(); ++iter)
+            {
+                const Token& token = m_nodes[*iter].token;
+                Write(token, m_index + *iter - token.length);
+            }
+            m_index += stop;
+            if (stop < blockLength)
+            {
+                // write the long sequence found at the stop position
+                Choose(m_index, m_matches, choice);
+                SkipMatches(m_index + 1, m_index + choice.length);
+                Write(choice, m_index);
+                m_index += choice.length;
+            }
         }
-        // write the best attempt
-        m_index += choice.m_len;
-        choice.m_bits.Pop(ioBuffer);
+        break;
     }
+    // every token is a whole number of bytes
+    m_bytes.clear();
+    m_output.Pop(m_bytes);
+    m_output.Optimize();
+    output.Take(m_bytes);
 }
 
-void WindowCompressor::Finish(std::vector<unsigned char>& ioBuffer)
+void WindowCompressor::FinishBytes(ByteOutput& output)
 {
-    Compress(ioBuffer);
+    if (!m_matchFinder)
+    {
+        m_matchFinder = IMatchFinder::Create(m_matchFinderType, minDistance, dictionarySize - maxLength);
+    }
+    Encode(output, true);
     // write EOF
-    BitFiFo bits;
-    bits.Push(escape, 8u);
-    bits.Push(3u, 8u);
-    bits.Pop(ioBuffer);
+    m_output.Push(escape | (3u << 8), 16u);
+    m_bytes.clear();
+    m_output.Pop(m_bytes);
+    output.Take(m_bytes);
 }
 
-void WindowDeCompressor::DeCompress(std::vector<unsigned char>& ioBuffer)
+void WindowDeCompressor::DeCompressBytes(const unsigned char* data, const size_t size, ByteOutput& output)
 {
     auto CopySequence = [&](unsigned int dist, unsigned int len)
     {
         auto index = m_window.size();
+        if (dist > index)
+        {
+            throw std::runtime_error("Invalid distance");
+        }
         for (unsigned int i = 0; i < len; ++i)
         {
             m_window.push_back(m_window[index-dist+i]);
@@ -241,20 +368,38 @@ void WindowDeCompressor::DeCompress(std::vector<unsigned char>& ioBuffer)
         }
         return false;
     };
-    m_input.Push(ioBuffer,8*ioBuffer.size());
-    ioBuffer.clear();
+    m_input.Reserve(8 * size);
+    for (size_t i = 0; i < size; ++i)
+    {
+        m_input.Push(data[i], 8u);
+    }
     assert(m_input.Size() % 8 == 0);
     while (ReadSequence())
     {
+        if (m_window.size() + maxLength > bufferSize)
+        {
+            Flush(output);
+        }
     }
     assert(m_input.Size() % 8 == 0);
-    // copy overflow from m_buffer
-    // todo
+    Flush(output);
+    m_input.Optimize();
+}
+
+void WindowDeCompressor::Flush(ByteOutput& output)
+{
+    output.Put(m_window.data() + m_flushed, m_window.size() - m_flushed);
+    m_flushed = m_window.size();
+    if (m_window.size() + maxLength > bufferSize)
+    {
+        // keep only what can still be referenced
+        Slide(m_window.size() - maxDistance);
+        m_flushed = m_window.size();
+    }
 }
 
-void WindowDeCompressor::Finish(std::vector<unsigned char>& ioBuffer)
+void WindowDeCompressor::FinishBytes(ByteOutput&)
 {
-    DeCompress(ioBuffer);
     if (!m_eof)
     {
         throw std::runtime_error("Incomplete data");
@@ -263,7 +408,5 @@ void WindowDeCompressor::Finish(std::vector<unsigned char>& ioBuffer)
     {
         throw std::runtime_error("Extra data after EOF");
     }
-    // copy everything from m_buffer
-    ioBuffer.insert(ioBuffer.end(), m_window.begin(), m_window.end());
     m_window.clear();
 }
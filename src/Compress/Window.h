@@ -1,6 +1,8 @@
 #pragma once
 
-#include "ICompress.h"
+#include "BitFiFo.h"
+#include "SpanCodec.h"
+#include "MatchFinder.h"
 
 // format (lsb->msb)
 //   esc 11 11 11 11         : esc
@@ -14,54 +16,111 @@ class WindowCommon : public IMPLEMENTS
 {
 protected:
     static const unsigned char escape = 255;
+    // largest distance and length which can be written
+    static const unsigned int maxDistance = 5 + (1 << 22);
+    static const unsigned int maxLength = 5 + (1 << 8);
+    // m_window never grows beyond bufferSize, the oldest data is dropped when it is full
+    static const unsigned int bufferSize = 1 << 23;
 
     WindowCommon()
         : m_window()
     {}
 
+    // remove 'count' bytes from the start of the window
+    void Slide(const size_t count)
+    {
+        m_window.erase(m_window.begin(), m_window.begin() + count);
+    }
+
     std::vector<unsigned char> m_window;
 };
 
-class WindowCompressor : public WindowCommon<ICompressor>
+template<typename IMPLEMENTS>
+const unsigned char WindowCommon<IMPLEMENTS>::escape;
+
+// how the compressor picks the sequences to write
+//   Greedy  : take the best match at every position
+//   Lazy    : skip a byte when the match at the next position is better
+//   Optimal : find the cheapest encoding for a block of positions
+enum class WindowParser
+{
+    Greedy,
+    Lazy,
+    Optimal
+};
+
+class WindowCompressor : public WindowCommon<SpanCompressor>
 {
 public:
-    WindowCompressor()
+    WindowCompressor(const MatchFinderType matchFinderType = MatchFinderType::HashChain, const WindowParser parser = WindowParser::Greedy)
         : WindowCommon()
-        , m_indices()
+        , m_matchFinderType(matchFinderType)
+        , m_parser(parser)
+        , m_matchFinder()
+        , m_matches()
+        , m_nextMatches()
+        , m_nodes()
+        , m_path()
+        , m_output()
+        , m_bytes()
     {}
 
-    void Compress(std::vector<unsigned char>& ioBuffer) override;
-    void Finish(std::vector<unsigned char>& ioBuffer) override;
+    // Fast = greedy + hash chain, Normal = lazy + hash chain, Max = optimal + binary tree
+    void SetLevel(CompressionLevel level) override;
+
+    void CompressBytes(const unsigned char* data, const size_t size, ByteOutput& output) override;
+    void FinishBytes(ByteOutput& output) override;
+
 private:
-    class Key
+    // positions the optimal parser looks at before writing
+    static const uint32_t optimalBlockSize = 1 << 12;
+    // matches this long are taken without looking for alternatives
+    static const unsigned int niceLength = 128;
+
+    // a literal (distance 0) or a sequence written with forms[form]
+    struct Token
+    {
+        unsigned int length;
+        unsigned int distance;
+        unsigned int form;
+    };
+    // cheapest way to reach a position: the last token written and the total cost in bits
+    struct Node
     {
-    public:
-        unsigned char operator[] (unsigned int index) { return m_data[index]; }
-
-        template<typename ITERATOR>
-        void Fill(ITERATOR iter)
-        {
-            for (auto& element : m_data)
-            {
-                element = *iter++;
-            }
-        }
-
-        bool operator < (const Key& other) const
-        {
-            return m_data < other.m_data;
-        }
-    private:
-        std::array<unsigned char, 4> m_data;
+        uint32_t cost = (uint32_t)-1;
+        Token token = { 0, 0, 0 };
     };
 
-    std::map<Key, std::vector<uint64_t>> m_indices;
+    // distances 4 and 5 are only usable for short matches, skip them so they don't hide longer ones.
+    static const unsigned int minDistance = 6;
+    // history used for matches, the window slides back this much at once.
+    static const unsigned int dictionarySize = bufferSize / 2;
 
-    uint64_t m_index = 0;
-    uint64_t m_offset = 0;
+    // write the data in the window, keep maxLength bytes back unless flushing
+    void Encode(ByteOutput& output, const bool flush);
+    // add the bits for the token at index to m_output
+    void Write(const Token& token, const uint32_t index);
+
+    MatchFinderType m_matchFinderType;
+    WindowParser m_parser;
+    // created on the first Compress, after the level is known
+    std::unique_ptr<IMatchFinder> m_matchFinder;
+    Matches m_matches;
+    // lazy parser: matches for the position after m_index
+    Matches m_nextMatches;
+    bool m_nextFound = false;
+    // optimal parser
+    std::vector<Node> m_nodes;
+    std::vector<uint32_t> m_path;
+    BitFiFo m_output;
+    // whole bytes taken from m_output
+    std::vector<unsigned char> m_bytes;
+
+    // position in m_window
+    uint32_t m_index = 0;
 };
 
-class WindowDeCompressor : public WindowCommon<IDeCompressor>
+class WindowDeCompressor : public WindowCommon<SpanDeCompressor>
 {
 public:
     WindowDeCompressor()
@@ -71,11 +130,17 @@ public:
         , m_escaped(false)
     {}
 
-    void DeCompress(std::vector<unsigned char>& ioBuffer) override;
-    void Finish(std::vector<unsigned char>& ioBuffer) override;
+    void DeCompressBytes(const unsigned char* data, const size_t size, ByteOutput& output) override;
+    void FinishBytes(ByteOutput& output) override;
+
 private:
+    // copy the decoded data to output, and drop what can't be referenced anymore
+    void Flush(ByteOutput& output);
+
     BitFiFo m_input;
     bool m_eof;
     bool m_escaped;
+    // bytes at the start of m_window which have been written to the output
+    size_t m_flushed = 0;
 };
 
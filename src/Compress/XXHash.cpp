@@ -0,0 +1,68 @@
+#include "XXHash.h"
+
+namespace
+{
+    const uint32_t prime1 = 2654435761u;
+    const uint32_t prime2 = 2246822519u;
+    const uint32_t prime3 = 3266489917u;
+    const uint32_t prime4 = 668265263u;
+    const uint32_t prime5 = 374761393u;
+
+    inline uint32_t RotateLeft(const uint32_t value, const unsigned int bits)
+    {
+        return (value << bits) | (value >> (32 - bits));
+    }
+
+    inline uint32_t Read32(const unsigned char* data)
+    {
+        return data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<uint32_t>(data[3]) << 24);
+    }
+
+    inline uint32_t Round(const uint32_t acc, const uint32_t lane)
+    {
+        return RotateLeft(acc + lane * prime2, 13) * prime1;
+    }
+}
+
+uint32_t XXHash32(const unsigned char* data, const size_t size, const uint32_t seed)
+{
+    const unsigned char* end = data + size;
+    uint32_t hash;
+    if (size >= 16)
+    {
+        // four independent lanes of 4 bytes
+        uint32_t v1 = seed + prime1 + prime2;
+        uint32_t v2 = seed + prime2;
+        uint32_t v3 = seed;
+        uint32_t v4 = seed - prime1;
+        const unsigned char* limit = end - 16;
+        do
+        {
+            v1 = Round(v1, Read32(data));
+            v2 = Round(v2, Read32(data + 4));
+            v3 = Round(v3, Read32(data + 8));
+            v4 = Round(v4, Read32(data + 12));
+            data += 16;
+        } while (data <= limit);
+        hash = RotateLeft(v1, 1) + RotateLeft(v2, 7) + RotateLeft(v3, 12) + RotateLeft(v4, 18);
+    }
+    else
+    {
+        hash = seed + prime5;
+    }
+    hash += static_cast<uint32_t>(size);
+    for (; data + 4 <= end; data += 4)
+    {
+        hash = RotateLeft(hash + Read32(data) * prime3, 17) * prime4;
+    }
+    for (; data < end; ++data)
+    {
+        hash = RotateLeft(hash + *data * prime5, 11) * prime1;
+    }
+    hash ^= hash >> 15;
+    hash *= prime2;
+    hash ^= hash >> 13;
+    hash *= prime3;
+    hash ^= hash >> 16;
+    return hash;
+}
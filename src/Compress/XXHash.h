@@ -0,0 +1,8 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// 32 bit xxHash (XXH32) by Yann Collet: a fast non-cryptographic checksum
+
+uint32_t XXHash32(const unsigned char* data, const size_t size, const uint32_t seed = 0);
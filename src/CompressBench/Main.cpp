@@ -0,0 +1,365 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Corpus.h"
+#include "Histogram.h"
+#include "ICompress.h"
+
+// throughput of the codecs: compress and decompress speed, ratio and peak memory for each algorithm,
+// input type and chunk size. each measurement is repeated, the median and the best run are reported.
+// the order-0 entropy of the input is the ratio a byte model without context can reach.
+
+namespace
+{
+    // heap use of the whole process, the peak can be reset before a measurement
+    std::atomic<size_t> heapInUse(0);
+    std::atomic<size_t> heapPeak(0);
+    // room in front of each allocation to store its size, keeps the alignment of malloc
+    const size_t heapHeader = 16;
+
+    void* Allocate(const size_t size)
+    {
+        unsigned char* block = static_cast<unsigned char*>(malloc(size + heapHeader));
+        if (block == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+        *reinterpret_cast<size_t*>(block) = size;
+        const size_t inUse = heapInUse += size;
+        size_t peak = heapPeak;
+        while (inUse > peak && !heapPeak.compare_exchange_weak(peak, inUse))
+        {
+        }
+        return block + heapHeader;
+    }
+
+    void Free(void* data)
+    {
+        if (data != nullptr)
+        {
+            unsigned char* block = static_cast<unsigned char*>(data) - heapHeader;
+            heapInUse -= *reinterpret_cast<size_t*>(block);
+            free(block);
+        }
+    }
+}
+
+void* operator new(size_t size) { return Allocate(size); }
+void* operator new[](size_t size) { return Allocate(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { try { return Allocate(size); } catch (...) { return nullptr; } }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { try { return Allocate(size); } catch (...) { return nullptr; } }
+void operator delete(void* data) noexcept { Free(data); }
+void operator delete[](void* data) noexcept { Free(data); }
+void operator delete(void* data, size_t) noexcept { Free(data); }
+void operator delete[](void* data, size_t) noexcept { Free(data); }
+
+namespace
+{
+    struct Options
+    {
+        std::vector<CompressionAlgo> algos = CompressionAlgoNames::All();
+        std::vector<CorpusType> inputs = Corpus::All();
+        // 0 passes all input at once
+        std::vector<size_t> chunkSizes = { 0, 65536 };
+        size_t size = 10000000;
+        uint32_t seed = 0;
+        size_t repetitions = 5;
+        CompressionLevel level = CompressionLevel::Normal;
+        std::string format = "text";
+    };
+
+    struct Result
+    {
+        CompressionAlgo algo;
+        CorpusType input;
+        size_t chunkSize;
+        size_t compressedSize;
+        // MB/s of the uncompressed data for each repetition
+        std::vector<double> compressSpeeds;
+        std::vector<double> deCompressSpeeds;
+        size_t compressPeak;
+        size_t deCompressPeak;
+        // order-0 entropy of the input, in percent of its size
+        double entropy;
+    };
+
+    std::vector<std::string> Split(const std::string& text)
+    {
+        std::vector<std::string> res;
+        std::stringstream stream(text);
+        std::string item;
+        while (std::getline(stream, item, ','))
+        {
+            res.emplace_back(item);
+        }
+        return res;
+    }
+
+    double EntropyPercent(const std::vector<unsigned char>& input)
+    {
+        std::vector<uint64_t> counts(Histogram::byteCount, 0);
+        Histogram::Count(input.data(), input.size(), counts.data());
+        double bits = 0;
+        for (const auto count : counts)
+        {
+            if (count > 0)
+            {
+                bits += count * std::log2(static_cast<double>(input.size()) / count);
+            }
+        }
+        return 100.0 * bits / 8 / std::max<size_t>(input.size(), 1);
+    }
+
+    double Median(std::vector<double> values)
+    {
+        std::sort(values.begin(), values.end());
+        const size_t middle = values.size() / 2;
+        return values.size() % 2 == 1 ? values[middle] : (values[middle - 1] + values[middle]) / 2;
+    }
+
+    double Best(const std::vector<double>& values)
+    {
+        return *std::max_element(values.begin(), values.end());
+    }
+
+    // pass the input in chunks through process(data, size, output, outputSize, written) and finish with
+    // finish(output, outputSize, written). returns the output size.
+    template<typename Process, typename Finish>
+    size_t Run(const std::vector<unsigned char>& input, const size_t chunkSize, std::vector<unsigned char>& output, Process process, Finish finish)
+    {
+        size_t used = 0;
+        size_t written = 0;
+        const auto space = [&output, &used]()
+        {
+            if (used == output.size())
+            {
+                output.resize(output.size() * 2);
+            }
+            return output.size() - used;
+        };
+        const size_t step = chunkSize == 0 ? std::max<size_t>(input.size(), 1) : chunkSize;
+        for (size_t offset = 0; offset < input.size(); offset += step)
+        {
+            CodecStatus status = process(input.data() + offset, std::min(step, input.size() - offset), output.data() + used, space(), written);
+            used += written;
+            while (status == CodecStatus::NeedsSpace)
+            {
+                status = process(nullptr, 0, output.data() + used, space(), written);
+                used += written;
+            }
+        }
+        CodecStatus status;
+        do
+        {
+            status = finish(output.data() + used, space(), written);
+            used += written;
+        } while (status == CodecStatus::NeedsSpace);
+        return used;
+    }
+
+    Result Measure(const Options& options, const CompressionAlgo algo, const CorpusType type, const std::vector<unsigned char>& input, const size_t chunkSize, const double entropy)
+    {
+        Result result = { algo, type, chunkSize, 0, {}, {}, 0, 0, entropy };
+        // allocated up front, so the peak is only the memory of the codec
+        std::vector<unsigned char> compressed(input.size() + input.size() / 8 + 65536);
+        std::vector<unsigned char> deCompressed(input.size() + 65536);
+        for (size_t repetition = 0; repetition < options.repetitions; ++repetition)
+        {
+            heapPeak = heapInUse.load();
+            size_t base = heapInUse;
+            auto start = std::chrono::steady_clock::now();
+            {
+                auto compressor = CompressorFactory::Create(algo, options.level);
+                result.compressedSize = Run(input, chunkSize, compressed,
+                    [&compressor](const unsigned char* data, size_t size, unsigned char* output, size_t space, size_t& written) { return compressor->Compress(data, size, output, space, written); },
+                    [&compressor](unsigned char* output, size_t space, size_t& written) { return compressor->Finish(output, space, written); });
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            result.compressSpeeds.emplace_back(input.size() / std::max(seconds, 1e-9) / 1e6);
+            result.compressPeak = std::max(result.compressPeak, heapPeak - base);
+
+            const std::vector<unsigned char> packed(compressed.begin(), compressed.begin() + result.compressedSize);
+            heapPeak = heapInUse.load();
+            base = heapInUse;
+            start = std::chrono::steady_clock::now();
+            size_t size;
+            {
+                auto deCompressor = DeCompressorFactory::Create(algo);
+                size = Run(packed, chunkSize, deCompressed,
+                    [&deCompressor](const unsigned char* data, size_t size, unsigned char* output, size_t space, size_t& written) { return deCompressor->DeCompress(data, size, output, space, written); },
+                    [&deCompressor](unsigned char* output, size_t space, size_t& written) { return deCompressor->Finish(output, space, written); });
+            }
+            seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            result.deCompressSpeeds.emplace_back(input.size() / std::max(seconds, 1e-9) / 1e6);
+            result.deCompressPeak = std::max(result.deCompressPeak, heapPeak - base);
+
+            if (size != input.size() || !std::equal(input.begin(), input.end(), deCompressed.begin()))
+            {
+                throw std::runtime_error("Round trip failed for " + CompressionAlgoNames::Name(algo) + " on " + Corpus::Name(type));
+            }
+        }
+        return result;
+    }
+
+    void Report(const Options& options, const std::vector<Result>& results)
+    {
+        char line[400];
+        if (options.format == "json")
+        {
+            std::cout << "[" << std::endl;
+            for (size_t i = 0; i < results.size(); ++i)
+            {
+                const Result& r = results[i];
+                snprintf(line, sizeof(line),
+                    "  {\"algo\": \"%s\", \"input\": \"%s\", \"size\": %zu, \"chunk\": %zu, \"repetitions\": %zu, \"ratio_percent\": %.4f, "
+                    "\"compress_mb_s\": %.2f, \"compress_mb_s_best\": %.2f, \"decompress_mb_s\": %.2f, \"decompress_mb_s_best\": %.2f, "
+                    "\"compress_peak_bytes\": %zu, \"decompress_peak_bytes\": %zu, \"entropy_percent\": %.4f}%s",
+                    CompressionAlgoNames::Name(r.algo).c_str(), Corpus::Name(r.input).c_str(), options.size, r.chunkSize, options.repetitions,
+                    100.0 * r.compressedSize / std::max<size_t>(options.size, 1),
+                    Median(r.compressSpeeds), Best(r.compressSpeeds), Median(r.deCompressSpeeds), Best(r.deCompressSpeeds),
+                    r.compressPeak, r.deCompressPeak, r.entropy, i + 1 < results.size() ? "," : "");
+                std::cout << line << std::endl;
+            }
+            std::cout << "]" << std::endl;
+        }
+        else if (options.format == "csv")
+        {
+            std::cout << "algo,input,size,chunk,repetitions,ratio_percent,compress_mb_s,compress_mb_s_best,decompress_mb_s,decompress_mb_s_best,compress_peak_bytes,decompress_peak_bytes,entropy_percent" << std::endl;
+            for (const auto& r : results)
+            {
+                snprintf(line, sizeof(line), "%s,%s,%zu,%zu,%zu,%.4f,%.2f,%.2f,%.2f,%.2f,%zu,%zu,%.4f",
+                    CompressionAlgoNames::Name(r.algo).c_str(), Corpus::Name(r.input).c_str(), options.size, r.chunkSize, options.repetitions,
+                    100.0 * r.compressedSize / std::max<size_t>(options.size, 1),
+                    Median(r.compressSpeeds), Best(r.compressSpeeds), Median(r.deCompressSpeeds), Best(r.deCompressSpeeds),
+                    r.compressPeak, r.deCompressPeak, r.entropy);
+                std::cout << line << std::endl;
+            }
+        }
+        else
+        {
+            snprintf(line, sizeof(line), "%-26s %-12s %8s %8s %12s %12s %10s %10s %9s", "algo", "input", "chunk", "ratio%", "comp MB/s", "decomp MB/s", "comp KiB", "decomp KiB", "entropy%");
+            std::cout << line << std::endl;
+            for (const auto& r : results)
+            {
+                snprintf(line, sizeof(line), "%-26s %-12s %8zu %8.2f %12.1f %12.1f %10zu %10zu %9.2f",
+                    CompressionAlgoNames::Name(r.algo).c_str(), Corpus::Name(r.input).c_str(), r.chunkSize,
+                    100.0 * r.compressedSize / std::max<size_t>(options.size, 1),
+                    Median(r.compressSpeeds), Median(r.deCompressSpeeds), r.compressPeak / 1024, r.deCompressPeak / 1024, r.entropy);
+                std::cout << line << std::endl;
+            }
+        }
+    }
+
+    void Usage()
+    {
+        std::cerr
+            << "usage: CompressBench [options]" << std::endl
+            << "  -a <algo,...>   algorithms, default all" << std::endl
+            << "  -i <input,...>  Random, RandomRange, Sequence, Sawtooth, Single, Text, Logs, Json, Numeric, default all" << std::endl
+            << "  -c <size,...>   chunk sizes passed to the codec, 0 is all at once, default 0,65536" << std::endl
+            << "  -s <size>       bytes per input, default 10000000" << std::endl
+            << "  -g <seed>       seed of the generated input, default 0" << std::endl
+            << "  -r <count>      repetitions, default 5" << std::endl
+            << "  -l <level>      fast, normal (default) or max" << std::endl
+            << "  -f <format>     text (default), json or csv" << std::endl;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    try
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string arg = argv[i];
+            if (i + 1 >= argc)
+            {
+                Usage();
+                return 2;
+            }
+            const std::string value = argv[++i];
+            if (arg == "-a")
+            {
+                options.algos.clear();
+                for (const auto& name : Split(value))
+                {
+                    options.algos.emplace_back(CompressionAlgoNames::Parse(name));
+                }
+            }
+            else if (arg == "-i")
+            {
+                options.inputs.clear();
+                for (const auto& name : Split(value))
+                {
+                    options.inputs.emplace_back(Corpus::Parse(name));
+                }
+            }
+            else if (arg == "-c")
+            {
+                options.chunkSizes.clear();
+                for (const auto& size : Split(value))
+                {
+                    options.chunkSizes.emplace_back(static_cast<size_t>(strtoull(size.c_str(), nullptr, 10)));
+                }
+            }
+            else if (arg == "-s")
+            {
+                options.size = static_cast<size_t>(strtoull(value.c_str(), nullptr, 10));
+            }
+            else if (arg == "-g")
+            {
+                options.seed = static_cast<uint32_t>(strtoul(value.c_str(), nullptr, 10));
+            }
+            else if (arg == "-r")
+            {
+                options.repetitions = std::max<size_t>(1, strtoull(value.c_str(), nullptr, 10));
+            }
+            else if (arg == "-l" && (value == "fast" || value == "normal" || value == "max"))
+            {
+                options.level = value == "fast" ? CompressionLevel::Fast : value == "max" ? CompressionLevel::Max : CompressionLevel::Normal;
+            }
+            else if (arg == "-f" && (value == "text" || value == "json" || value == "csv"))
+            {
+                options.format = value;
+            }
+            else
+            {
+                Usage();
+                return 2;
+            }
+        }
+
+        std::vector<Result> results;
+        for (auto type : options.inputs)
+        {
+            const auto input = Corpus::Generate(type, options.size, options.seed);
+            const double entropy = EntropyPercent(input);
+            for (auto algo : options.algos)
+            {
+                for (auto chunkSize : options.chunkSizes)
+                {
+                    results.emplace_back(Measure(options, algo, type, input, chunkSize, entropy));
+                }
+            }
+        }
+        Report(options, results);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,188 @@
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "FileIO.h"
+
+namespace
+{
+    void SetBinary(FILE* file)
+    {
+#ifdef _WIN32
+        _setmode(_fileno(file), _O_BINARY);
+#else
+        (void)file;
+#endif
+    }
+}
+
+InputFile::InputFile(const std::string& name)
+    : m_file(nullptr)
+    , m_close(false)
+    , m_mapped(nullptr)
+    , m_mappedSize(0)
+    , m_buffer()
+    , m_bytesRead(0)
+{
+    if (name == "-")
+    {
+        m_file = stdin;
+        SetBinary(m_file);
+    }
+    else
+    {
+        m_file = fopen(name.c_str(), "rb");
+        if (m_file == nullptr)
+        {
+            throw std::runtime_error("Can't open " + name);
+        }
+        m_close = true;
+    }
+#ifndef _WIN32
+    struct stat info;
+    if (fstat(fileno(m_file), &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0)
+    {
+        void* mapped = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fileno(m_file), 0);
+        if (mapped != MAP_FAILED)
+        {
+            madvise(mapped, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+            m_mapped = static_cast<const unsigned char*>(mapped);
+            m_mappedSize = static_cast<size_t>(info.st_size);
+        }
+    }
+#endif
+    if (m_mapped == nullptr)
+    {
+        m_buffer.resize(readSize);
+    }
+}
+
+InputFile::~InputFile()
+{
+#ifndef _WIN32
+    if (m_mapped != nullptr)
+    {
+        munmap(const_cast<unsigned char*>(m_mapped), m_mappedSize);
+    }
+#endif
+    if (m_close)
+    {
+        fclose(m_file);
+    }
+}
+
+bool InputFile::Read(const unsigned char*& data, size_t& size)
+{
+    if (m_mapped != nullptr)
+    {
+        // in parts, so the output is written while the input is read
+        size = std::min(readSize, m_mappedSize - m_bytesRead);
+        data = m_mapped + m_bytesRead;
+    }
+    else
+    {
+        size = fread(m_buffer.data(), 1, m_buffer.size(), m_file);
+        if (size == 0 && ferror(m_file))
+        {
+            throw std::runtime_error("Read failed");
+        }
+        data = m_buffer.data();
+    }
+    m_bytesRead += size;
+    return size > 0;
+}
+
+void InputFile::ReadAll(const unsigned char*& data, size_t& size)
+{
+    if (m_mapped != nullptr)
+    {
+        m_bytesRead = m_mappedSize;
+        data = m_mapped;
+        size = m_mappedSize;
+        return;
+    }
+    std::vector<unsigned char> all;
+    while (Read(data, size))
+    {
+        all.insert(all.end(), data, data + size);
+    }
+    m_buffer.swap(all);
+    data = m_buffer.data();
+    size = m_buffer.size();
+}
+
+
+
+OutputFile::OutputFile(const std::string& name)
+    : m_file(nullptr)
+    , m_close(false)
+    , m_buffer(bufferSize)
+    , m_used(0)
+    , m_bytesWritten(0)
+{
+    if (name == "-")
+    {
+        m_file = stdout;
+        SetBinary(m_file);
+    }
+    else
+    {
+        m_file = fopen(name.c_str(), "wb");
+        if (m_file == nullptr)
+        {
+            throw std::runtime_error("Can't create " + name);
+        }
+        m_close = true;
+    }
+    // the buffer is large enough already
+    setvbuf(m_file, nullptr, _IONBF, 0);
+}
+
+OutputFile::~OutputFile()
+{
+    if (m_close)
+    {
+        fclose(m_file);
+    }
+}
+
+unsigned char* OutputFile::Space(size_t& size)
+{
+    if (m_used == m_buffer.size())
+    {
+        Write();
+    }
+    size = m_buffer.size() - m_used;
+    return m_buffer.data() + m_used;
+}
+
+void OutputFile::Commit(const size_t size)
+{
+    m_used += size;
+    m_bytesWritten += size;
+}
+
+void OutputFile::Flush()
+{
+    Write();
+    if (fflush(m_file) != 0)
+    {
+        throw std::runtime_error("Write failed");
+    }
+}
+
+void OutputFile::Write()
+{
+    if (m_used > 0 && fwrite(m_buffer.data(), 1, m_used, m_file) != m_used)
+    {
+        throw std::runtime_error("Write failed");
+    }
+    m_used = 0;
+}
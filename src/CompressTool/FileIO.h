@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// file access for the command line tool. "-" is stdin/stdout.
+
+// a regular file is mapped in memory, when the platform allows it. other input is read in large blocks.
+class InputFile
+{
+public:
+    explicit InputFile(const std::string& name);
+    ~InputFile();
+
+    InputFile(const InputFile&) = delete;
+    InputFile& operator = (const InputFile&) = delete;
+
+    // the next part of the input, returns false at the end. the data stays valid until the next call.
+    bool Read(const unsigned char*& data, size_t& size);
+    // all of the input at once, the data stays valid while the file is open
+    void ReadAll(const unsigned char*& data, size_t& size);
+
+    // bytes returned by Read
+    size_t BytesRead() const { return m_bytesRead; }
+
+private:
+    static const size_t readSize = 1 << 20;
+
+    FILE* m_file;
+    bool m_close;
+    // the mapped file
+    const unsigned char* m_mapped;
+    size_t m_mappedSize;
+    std::vector<unsigned char> m_buffer;
+    size_t m_bytesRead;
+};
+
+// writes are collected in a large buffer. codecs can write in it directly with Space/Commit.
+class OutputFile
+{
+public:
+    explicit OutputFile(const std::string& name);
+    // doesn't write what is still buffered, call Flush
+    ~OutputFile();
+
+    OutputFile(const OutputFile&) = delete;
+    OutputFile& operator = (const OutputFile&) = delete;
+
+    // free space in the buffer, which is never empty
+    unsigned char* Space(size_t& size);
+    // 'size' bytes are written to the space
+    void Commit(const size_t size);
+    // write the buffer to the file
+    void Flush();
+
+    // bytes passed to Commit
+    size_t BytesWritten() const { return m_bytesWritten; }
+
+private:
+    static const size_t bufferSize = 4 << 20;
+
+    void Write();
+
+    FILE* m_file;
+    bool m_close;
+    std::vector<unsigned char> m_buffer;
+    size_t m_used;
+    size_t m_bytesWritten;
+};
@@ -0,0 +1,270 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "Container.h"
+#include "FileIO.h"
+#include "ICompress.h"
+#include "Parallel.h"
+
+// compress or decompress a file with any CompressionAlgo, and report the speed and ratio.
+// the output is the raw stream of the codec, decompress it with the same options. or it is a
+// container (-f), which knows its algorithm and allows decompressing a part of the data (-r).
+
+namespace
+{
+    void Usage()
+    {
+        std::cerr
+            << "usage: CompressTool -c|-d [options] [input [output]]" << std::endl
+            << "  -c          compress" << std::endl
+            << "  -d          decompress" << std::endl
+            << "  -a <algo>   algorithm, default StaticHuffman:" << std::endl;
+        for (auto ca : CompressionAlgoNames::All())
+        {
+            std::cerr << "                " << CompressionAlgoNames::Name(ca) << std::endl;
+        }
+        std::cerr
+            << "  -l <level>  fast, normal (default) or max" << std::endl
+            << "  -j <count>  compress blocks on 'count' threads, 0 is one per core" << std::endl
+            << "  -p          run the stages of a pipeline on their own threads" << std::endl
+            << "  -f          write a container with checksums and a block index" << std::endl
+            << "  -r <offset> <size>" << std::endl
+            << "              decompress a range of the data from a container" << std::endl
+            << "  -q          don't report speed and ratio" << std::endl
+            << "input and output default to stdin and stdout ('-')." << std::endl
+            << "-a and -j have to be the same when decompressing, except for a container." << std::endl;
+    }
+
+    CompressionLevel ParseLevel(const std::string& name)
+    {
+        if (name == "fast")
+        {
+            return CompressionLevel::Fast;
+        }
+        if (name == "normal")
+        {
+            return CompressionLevel::Normal;
+        }
+        if (name == "max")
+        {
+            return CompressionLevel::Max;
+        }
+        throw std::runtime_error("Unknown level " + name);
+    }
+
+    // pass all input through process(data, size, output, outputSize, written), and finish with
+    // finish(output, outputSize, written). both write to the output buffer directly.
+    template<typename Process, typename Finish>
+    void Run(InputFile& input, OutputFile& output, Process process, Finish finish)
+    {
+        const unsigned char* data;
+        size_t size;
+        size_t space;
+        size_t written;
+        while (input.Read(data, size))
+        {
+            unsigned char* buffer = output.Space(space);
+            CodecStatus status = process(data, size, buffer, space, written);
+            output.Commit(written);
+            while (status == CodecStatus::NeedsSpace)
+            {
+                buffer = output.Space(space);
+                status = process(nullptr, 0, buffer, space, written);
+                output.Commit(written);
+            }
+        }
+        CodecStatus status;
+        do
+        {
+            unsigned char* buffer = output.Space(space);
+            status = finish(buffer, space, written);
+            output.Commit(written);
+        } while (status == CodecStatus::NeedsSpace);
+        output.Flush();
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    bool compress = false;
+    bool deCompress = false;
+    bool quiet = false;
+    bool pipeLineThreads = false;
+    bool blocks = false;
+    bool container = false;
+    bool range = false;
+    uint64_t rangeOffset = 0;
+    size_t rangeSize = 0;
+    unsigned int threadCount = 0;
+    CompressionAlgo algo = CompressionAlgo::StaticHuffman;
+    CompressionLevel level = CompressionLevel::Normal;
+    std::string files[2] = { "-", "-" };
+    size_t fileCount = 0;
+    try
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string arg = argv[i];
+            const bool hasValue = i + 1 < argc;
+            if (arg == "-c")
+            {
+                compress = true;
+            }
+            else if (arg == "-d")
+            {
+                deCompress = true;
+            }
+            else if (arg == "-a" && hasValue)
+            {
+                algo = CompressionAlgoNames::Parse(argv[++i]);
+            }
+            else if (arg == "-l" && hasValue)
+            {
+                level = ParseLevel(argv[++i]);
+            }
+            else if (arg == "-j" && hasValue)
+            {
+                blocks = true;
+                threadCount = static_cast<unsigned int>(strtoul(argv[++i], nullptr, 10));
+            }
+            else if (arg == "-p")
+            {
+                pipeLineThreads = true;
+            }
+            else if (arg == "-f")
+            {
+                container = true;
+            }
+            else if (arg == "-r" && i + 2 < argc)
+            {
+                range = true;
+                rangeOffset = strtoull(argv[++i], nullptr, 10);
+                rangeSize = static_cast<size_t>(strtoull(argv[++i], nullptr, 10));
+            }
+            else if (arg == "-q")
+            {
+                quiet = true;
+            }
+            else if ((arg == "-" || arg[0] != '-') && fileCount < 2)
+            {
+                files[fileCount++] = arg;
+            }
+            else
+            {
+                Usage();
+                return 2;
+            }
+        }
+        if (compress == deCompress || (range && !deCompress))
+        {
+            Usage();
+            return 2;
+        }
+
+        InputFile input(files[0]);
+        OutputFile output(files[1]);
+        const auto start = std::chrono::steady_clock::now();
+        if (range)
+        {
+            const unsigned char* data;
+            size_t size;
+            input.ReadAll(data, size);
+            ContainerReader reader(data, size);
+            std::vector<unsigned char> part;
+            reader.Read(rangeOffset, rangeSize, part);
+            size_t space;
+            for (size_t offset = 0; offset < part.size(); )
+            {
+                unsigned char* buffer = output.Space(space);
+                const size_t count = std::min(space, part.size() - offset);
+                memcpy(buffer, part.data() + offset, count);
+                output.Commit(count);
+                offset += count;
+            }
+            output.Flush();
+        }
+        else if (compress)
+        {
+            std::shared_ptr<ICompressor> compressor;
+            if (container)
+            {
+                compressor = std::make_shared<ContainerCompressor>(algo);
+                compressor->SetLevel(level);
+            }
+            else if (blocks)
+            {
+                compressor = std::make_shared<ParallelCompressor>(algo, ParallelCommon::defaultBlockSize, threadCount);
+                compressor->SetLevel(level);
+            }
+            else if (pipeLineThreads)
+            {
+                compressor = CompressorFactory::CreateThreaded(algo, level);
+            }
+            else
+            {
+                compressor = CompressorFactory::Create(algo, level);
+            }
+            Run(input, output,
+                [&compressor](const unsigned char* data, size_t size, unsigned char* buffer, size_t space, size_t& written) { return compressor->Compress(data, size, buffer, space, written); },
+                [&compressor](unsigned char* buffer, size_t space, size_t& written) { return compressor->Finish(buffer, space, written); });
+        }
+        else
+        {
+            std::shared_ptr<IDeCompressor> deCompressor;
+            if (container)
+            {
+                deCompressor = std::make_shared<ContainerDeCompressor>();
+            }
+            else if (blocks)
+            {
+                deCompressor = std::make_shared<ParallelDeCompressor>(algo, threadCount);
+            }
+            else if (pipeLineThreads)
+            {
+                deCompressor = DeCompressorFactory::CreateThreaded(algo);
+            }
+            else
+            {
+                deCompressor = DeCompressorFactory::Create(algo);
+            }
+            Run(input, output,
+                [&deCompressor](const unsigned char* data, size_t size, unsigned char* buffer, size_t space, size_t& written) { return deCompressor->DeCompress(data, size, buffer, space, written); },
+                [&deCompressor](unsigned char* buffer, size_t space, size_t& written) { return deCompressor->Finish(buffer, space, written); });
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if (!quiet && range)
+        {
+            char line[200];
+            snprintf(line, sizeof(line), "decompressed %zu bytes at %llu, %.3f s", output.BytesWritten(), static_cast<unsigned long long>(rangeOffset), seconds);
+            std::cerr << line << std::endl;
+        }
+        else if (!quiet)
+        {
+            // speed and ratio are about the uncompressed data
+            const size_t plain = compress ? input.BytesRead() : output.BytesWritten();
+            const size_t packed = compress ? output.BytesWritten() : input.BytesRead();
+            char line[200];
+            snprintf(line, sizeof(line), "%s %zu -> %zu bytes, ratio %.2f%%, %.3f s, %.1f MB/s",
+                compress ? "compressed" : "decompressed",
+                input.BytesRead(), output.BytesWritten(),
+                plain > 0 ? 100.0 * packed / plain : 0.0,
+                seconds,
+                seconds > 0 ? plain / seconds / 1e6 : 0.0);
+            std::cerr << line << std::endl;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}